@@ -13,8 +13,12 @@
 	#include "cybsp.h"
 
 	#include "ak4954a.h"
+	#include "audio_stream.h"
 	#include "led.h"
 
+	/* Sample rate of the recorded data (128 samples = 8 msec) */
+	#define AUDIO_SAMPLE_RATE	16000u
+
 	/* Size of the recorded buffer */
 	#define BUFFER_SIZE     32000u // 8 msec = 128 // 32768
 
@@ -33,6 +37,9 @@
 	/* DMA Maximum loop transfer size */
 	#define DMA_LOOP_SIZE   256u
 
+	/* Priority of the PDM DMA interrupt in the streaming mode */
+	#define AUDIO_STREAM_INTR_PRIORITY	3u
+
 
 	/* Master I2C variables */
 	cyhal_i2c_t mi2c;
@@ -42,4 +49,7 @@
 	void record_audio(uint8_t active_button);
 	void play_record();
 
+	void start_audio_stream(struct audio_stream *stream);
+	void stop_audio_stream();
+
 #endif /* LIBS_FUNCTIONAL_HEADERS_AUDIO_H_ */
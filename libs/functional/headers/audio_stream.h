@@ -0,0 +1,50 @@
+/*
+ * audio_stream.h
+ *
+ *  Created on: 17 жовт. 2026 р.
+ *      Author: yabe
+ */
+
+#ifndef LIBS_FUNCTIONAL_HEADERS_AUDIO_STREAM_H_
+	#define LIBS_FUNCTIONAL_HEADERS_AUDIO_STREAM_H_
+
+	#include <stdint.h>
+	#include <stddef.h>
+
+	/*
+	 * Ring of capture blocks shared between a producer (the PDM DMA
+	 * interrupt on the board, a timer thread on the host) and a single
+	 * consumer. The producer only writes write_count and the consumer only
+	 * writes read_count, so no locking is needed. The code here knows
+	 * nothing about the hardware: audio.c binds it to the DMA descriptors.
+	 */
+
+	/* Maximum number of blocks in the ring (one DMA descriptor per block) */
+	#define AUDIO_STREAM_MAX_BLOCKS	8u
+
+	/* Called by the producer every time a block has been filled */
+	typedef void (*audio_stream_callback_t)(const int16_t *block, uint32_t block_size);
+
+	struct audio_stream{
+		int16_t *buffer;					// block_num * block_size samples
+		uint32_t block_size;				// samples per block
+		uint32_t block_num;					// blocks in the ring
+		volatile uint32_t write_count;		// blocks filled by the producer
+		volatile uint32_t read_count;		// blocks released by the consumer
+		volatile uint32_t overruns;			// blocks lost because the consumer was late
+		audio_stream_callback_t callback;
+	};
+
+	void audio_stream_init(struct audio_stream *stream, int16_t *buffer,
+						   uint32_t block_size, uint32_t block_num,
+						   audio_stream_callback_t callback);
+	void audio_stream_reset(struct audio_stream *stream);
+	int16_t *audio_stream_block(const struct audio_stream *stream, uint32_t count);
+	void audio_stream_block_done(struct audio_stream *stream);
+	uint32_t audio_stream_available(struct audio_stream *stream);
+	const int16_t *audio_stream_acquire(struct audio_stream *stream);
+	const int16_t *audio_stream_frame(const struct audio_stream *stream, uint32_t offset,
+									  uint32_t length, int16_t *copy);
+	void audio_stream_release(struct audio_stream *stream);
+
+#endif /* LIBS_FUNCTIONAL_HEADERS_AUDIO_STREAM_H_ */
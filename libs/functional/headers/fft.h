@@ -32,15 +32,81 @@
 //	uint8_t doBitReverse_ = 1;
 	//arm_status status;
 
-	int8_t number_of_bits_to_upscale(uint16_t frame_size);
-	void fft_q15				(const int16_t *input_data, int16_t * magnitude, uint16_t frame_num, uint16_t frame_size);
-	void fft_q15_sound			(const int16_t *input_data, int16_t *output_data, uint16_t frame_num, uint16_t frame_size);
-	void fft_q15_hamming_sound	(const int16_t *input_data, int16_t * magnitude, uint16_t frame_num, uint16_t frame_size);
-	void fft_q31				(const int16_t *input_data, int16_t * magnitude, uint16_t frame_num, uint16_t frame_size);
-	void fft_q31_sound			(const int16_t *input_data, int16_t *output_data, uint16_t frame_num, uint16_t frame_size);
-	void fft_q31_hamming_sound	(const int16_t *input_data, int16_t * magnitude, uint16_t frame_num, uint16_t frame_size);
-	void fft_q15_test_1khz_fft	(const int16_t *input_data, int16_t *data_output, uint16_t frame_num, uint16_t frame_size);
-	void fft_q15_test_1khz_sound(int16_t *input_data, int16_t *data_output, uint16_t frame_num, uint16_t frame_size);
+	/*
+	 * Scratch for the fft_* functions, in elements of their scratch type.
+	 * Frames are processed one at a time, so the working RAM depends on
+	 * frame_size only (the input frame and the complex spectrum).
+	 * At frame_size = 128: q15 - 768 B, q31 - 1536 B
+	 * (the old stack arrays took ~128 KB for fft_q15 on a BUFFER_SIZE record).
+	 */
+	#define FFT_Q15_SCRATCH_SIZE(frame_size)			(3u * (frame_size))
+	#define FFT_Q31_SCRATCH_SIZE(frame_size)			(3u * (frame_size))
+
+	/* Window applied to a frame before the FFT */
+	enum fft_window{
+		FFT_WINDOW_NONE,		// rectangular, the shipped model is trained without a window
+		FFT_WINDOW_HANN,
+		FFT_WINDOW_HAMMING,
+		FFT_WINDOW_BLACKMAN
+	};
+
+	/*
+	 * Frames of samples sound bits cut with frame_size and hop:
+	 * frame i starts at i * hop, so frames overlap when hop < frame_size.
+	 */
+	#define FFT_FRAME_NUM(samples, frame_size, hop)	\
+		((samples) < (frame_size) ? 0u : ((samples) - (frame_size)) / (hop) + 1u)
+
+	/*
+	 * Everything that depends on the frame size only, made once by
+	 * fft_context_init(): the rfft instances, the upscale shift and the q15
+	 * window. The per-frame path does no init work and no sinf()/cosf().
+	 * The hop is used by the analysis functions (fft_q15, the *_features
+	 * extractors, the spectrogram); the *_sound demos always use
+	 * frame_size, they have no overlap-add.
+	 */
+	struct fft_context{
+		uint16_t frame_size;					// number of sound bits for FFT
+		uint16_t hop;							// sound bits between the starts of two frames
+		int8_t upscale;							// bits to upscale the FFT output
+		enum fft_window window_type;
+		const q15_t *window;					// frame_size values, NULL for FFT_WINDOW_NONE
+		arm_rfft_instance_q15 rfft_q15;
+		arm_rfft_instance_q15 rifft_q15;
+		arm_rfft_instance_q31 rfft_q31;
+		arm_rfft_instance_q31 rifft_q31;
+	};
+
+	/*
+	 * Real feature value of one FFT magnitude step. The model was trained on
+	 * magnitude / 256 input steps of 0.354565 (zero point -128); the actual
+	 * input scale of the tensor is applied by fft_quant_init().
+	 */
+	#define FFT_FEATURE_SCALE	(0.354565f / 256.0f)
+
+	/* Feature to model input conversion, see fft_quant_init() */
+	struct fft_quant{
+		uint32_t multiplier;	// feature scale / input scale, Q16
+		int32_t zero_point;		// input zero point
+	};
+
+	int8_t get_number_of_bits_to_upscale(uint16_t frame_size);
+	void fft_context_init		(struct fft_context *context, uint16_t frame_size, uint16_t hop,
+								 enum fft_window window_type, q15_t *window);
+	void fft_q15_magnitudes		(const struct fft_context *context, const int16_t *frame, uint16_t bin_offset,
+								 uint16_t bin_count, q15_t *magnitude, q15_t *scratch);
+	void fft_q15				(const struct fft_context *context, const int16_t *input_data, int16_t * magnitude, uint16_t frame_num, q15_t *scratch);
+	void fft_quant_init			(struct fft_quant *quant, float feature_scale, float scale, int32_t zero_point);
+	void fft_quantize_magnitudes(const struct fft_quant *quant, const q15_t *magnitude, int8_t *features, uint16_t count);
+	void fft_q15_features		(const struct fft_context *context, const int16_t *input_data, int8_t *features, uint16_t frame_num,
+								 uint16_t bin_offset, uint16_t bin_count, const struct fft_quant *quant, q15_t *scratch);
+	void fft_q15_sound			(const struct fft_context *context, const int16_t *input_data, int16_t *output_data, uint16_t frame_num, q15_t *scratch);
+	void fft_q15_hamming_sound	(const struct fft_context *context, const int16_t *input_data, int16_t * magnitude, uint16_t frame_num, q15_t *scratch);
+	void fft_q31				(const struct fft_context *context, const int16_t *input_data, int16_t * magnitude, uint16_t frame_num, q31_t *scratch);
+	void fft_q31_sound			(const struct fft_context *context, const int16_t *input_data, int16_t *output_data, uint16_t frame_num, q31_t *scratch);
+	void fft_q31_hamming_sound	(const struct fft_context *context, const int16_t *input_data, int16_t * magnitude, uint16_t frame_num, q31_t *scratch);
+	void fft_q15_test_1khz_fft	(const struct fft_context *context, const int16_t *input_data, int16_t *data_output, uint16_t frame_num, q15_t *scratch);
+	void fft_q15_test_1khz_sound(const struct fft_context *context, int16_t *input_data, int16_t *data_output, uint16_t frame_num, q15_t *scratch);
 //	void fft_float(const int16_t *input_data, int16_t * output_data, uint16_t frame_num, uint16_t frame_size);
 
 
@@ -0,0 +1,50 @@
+/*
+ * mel.h
+ *
+ *  Created on: 17 жовт. 2026 р.
+ *      Author: yabe
+ */
+
+#ifndef LIBS_FUNCTIONAL_HEADERS_MEL_H_
+	#define LIBS_FUNCTIONAL_HEADERS_MEL_H_
+
+	#include "fft.h"
+
+	/*
+	 * Log-mel filterbank on top of the q15 FFT magnitudes.
+	 * Triangular filters evenly spaced on the mel scale are computed once
+	 * by mel_init() and kept sparse: every channel only stores the run of
+	 * bins where its weight is not zero. A channel is
+	 *		log2(sum(weight[k] * magnitude[k]))
+	 * with the q15 weights and magnitudes multiplied as integers (Q30 sum)
+	 * and log2 taken in Q8 by CLZ + a 33-entry table, so no float is used
+	 * per frame. Training has to compute the features the same way.
+	 */
+
+	/* Maximum number of mel channels */
+	#define MEL_MAX_CHANNELS	40u
+
+	/* Real feature value of one Q8 step of the log2 energy, see fft_quant_init() */
+	#define MEL_FEATURE_SCALE	(1.0f / 256.0f)
+
+	/* Weights needed by mel_init(): each bin is in at most two filters */
+	#define MEL_WEIGHTS_SIZE(frame_size)	(2u * ((frame_size) / 2u + 1u) + MEL_MAX_CHANNELS)
+
+	struct mel_filterbank{
+		uint16_t frame_size;					// samples per FFT frame
+		uint16_t bin_num;						// magnitudes used: frame_size / 2 + 1
+		uint16_t channel_num;					// mel channels
+		uint16_t start[MEL_MAX_CHANNELS];		// first bin of the channel
+		uint16_t width[MEL_MAX_CHANNELS];		// bins of the channel
+		uint16_t offset[MEL_MAX_CHANNELS];		// first weight of the channel
+		q15_t *weights;							// MEL_WEIGHTS_SIZE(frame_size)
+	};
+
+	void mel_init(struct mel_filterbank *mel, uint16_t frame_size, uint32_t sample_rate,
+				  uint16_t channel_num, float low_freq, float high_freq, q15_t *weights);
+	void mel_log_energies(const struct mel_filterbank *mel, const q15_t *magnitude, q15_t *log_energy);
+	void mel_q15_features(const struct fft_context *context, const int16_t *input_data, int8_t *features,
+						  uint16_t frame_num, const struct mel_filterbank *mel, const struct fft_quant *quant,
+						  q15_t *scratch);
+
+#endif /* LIBS_FUNCTIONAL_HEADERS_MEL_H_ */
@@ -0,0 +1,44 @@
+/*
+ * mfcc.h
+ *
+ *  Created on: 17 жовт. 2026 р.
+ *      Author: yabe
+ */
+
+#ifndef LIBS_FUNCTIONAL_HEADERS_MFCC_H_
+	#define LIBS_FUNCTIONAL_HEADERS_MFCC_H_
+
+	#include "mel.h"
+
+	/*
+	 * MFCC on top of the log-mel energies of mel.h: the first
+	 * coefficient_num coefficients of the orthonormal DCT-II of a frame.
+	 * The DCT is a q15 table computed once by mfcc_init(), one
+	 * arm_dot_prod_q15() per coefficient; arm_dct4_q15() only supports
+	 * 128 points and more, far from the 40 mel channels.
+	 * Coefficients are in Q7 (signed), training has to compute them the
+	 * same way.
+	 */
+
+	/* Maximum number of coefficients */
+	#define MFCC_MAX_COEFFICIENTS	20u
+
+	/* Real feature value of one Q7 step of a coefficient, see fft_quant_init() */
+	#define MFCC_FEATURE_SCALE		(1.0f / 128.0f)
+
+	/* DCT table needed by mfcc_init() */
+	#define MFCC_DCT_SIZE(coefficient_num, channel_num)	((coefficient_num) * (channel_num))
+
+	struct mfcc{
+		const struct mel_filterbank *mel;	// filterbank of the log-mel energies
+		uint16_t coefficient_num;			// coefficients kept per frame
+		q15_t *dct;							// coefficient_num rows of channel_num values
+	};
+
+	void mfcc_init(struct mfcc *mfcc, const struct mel_filterbank *mel, uint16_t coefficient_num, q15_t *dct);
+	void mfcc_coefficients(const struct mfcc *mfcc, const q15_t *log_energy, q15_t *coefficients);
+	void mfcc_q15_features(const struct fft_context *context, const int16_t *input_data, int8_t *features,
+						   uint16_t frame_num, const struct mfcc *mfcc, const struct fft_quant *quant,
+						   q15_t *scratch);
+
+#endif /* LIBS_FUNCTIONAL_HEADERS_MFCC_H_ */
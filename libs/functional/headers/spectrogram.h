@@ -0,0 +1,76 @@
+/*
+ * spectrogram.h
+ *
+ *  Created on: 17 жовт. 2026 р.
+ *      Author: yabe
+ */
+
+#ifndef LIBS_FUNCTIONAL_HEADERS_SPECTROGRAM_H_
+	#define LIBS_FUNCTIONAL_HEADERS_SPECTROGRAM_H_
+
+	#include "audio_stream.h"
+	#include "fft.h"
+	#include "mel.h"
+	#include "mfcc.h"
+	#include "vad.h"
+
+	/*
+	 * Incremental spectrogram for the streaming mode.
+	 * The FFT plan is shared (struct fft_context), only newly arrived frames are
+	 * transformed and their magnitudes, already converted to the model
+	 * input, go straight into a circular store of the last frame_num frames.
+	 * Per call cost is proportional to the new audio, not to the whole
+	 * window.
+	 *
+	 * Frames are the same as in fft_q15(): frame_size samples, one every hop
+	 * samples of the FFT context. spectrogram_push_stream() reads them in
+	 * place from the capture ring, overlapping samples are never duplicated;
+	 * only a frame that wraps the end of the ring is gathered in the scratch.
+	 * A frame of the store is width features, see enum feature_mode.
+	 * With a voice activity gate (spectrogram_use_vad()) quiet frames skip
+	 * the FFT and are stored as the features of a zero frame.
+	 */
+
+	enum feature_mode{
+		FEATURE_LINEAR,		// magnitudes bin_offset .. bin_offset + bin_count - 1
+		FEATURE_LOG_MEL,	// log-mel energies of spectrogram_use_mel()
+		FEATURE_MFCC		// MFCC of spectrogram_use_mfcc()
+	};
+
+	/* Scratch samples needed by spectrogram_init(): FFT input + complex output */
+	#define SPECTROGRAM_SCRATCH_SIZE(frame_size)	(3u * (frame_size))
+
+	struct spectrogram{
+		const struct fft_context *fft;	// FFT plan and window
+		uint16_t frame_size;	// samples per frame
+		uint16_t hop;			// samples between the starts of two frames
+		uint16_t bin_offset;	// first magnitude kept
+		uint16_t bin_count;		// magnitudes kept per frame
+		uint16_t frame_num;		// frames in the store
+		enum feature_mode mode;	// features of a frame
+		const struct mel_filterbank *mel;	// FEATURE_LOG_MEL and FEATURE_MFCC filterbank
+		const struct mfcc *mfcc;			// FEATURE_MFCC DCT
+		uint16_t width;			// features per frame
+		struct fft_quant quant;	// magnitude to model input conversion
+		struct vad *vad;		// gate of the frames, NULL - every frame is transformed
+		int8_t *store;			// frame_num * width model inputs
+		uint16_t head;			// slot of the oldest frame = slot of the next one
+		uint32_t frames;		// frames pushed since spectrogram_reset()
+		uint32_t offset;		// next frame start from the oldest unreleased stream block
+		q15_t *scratch;			// SPECTROGRAM_SCRATCH_SIZE(frame_size)
+	};
+
+	void spectrogram_init(struct spectrogram *spectrogram, const struct fft_context *fft,
+						  uint16_t frame_num, uint16_t bin_offset, uint16_t bin_count,
+						  const struct fft_quant *quant, int8_t *store, q15_t *scratch);
+	void spectrogram_use_mel(struct spectrogram *spectrogram, const struct mel_filterbank *mel,
+							 const struct fft_quant *quant);
+	void spectrogram_use_mfcc(struct spectrogram *spectrogram, const struct mfcc *mfcc,
+							  const struct fft_quant *quant);
+	void spectrogram_use_vad(struct spectrogram *spectrogram, struct vad *vad);
+	void spectrogram_reset(struct spectrogram *spectrogram);
+	void spectrogram_push(struct spectrogram *spectrogram, const int16_t *samples, uint16_t frame_count);
+	uint16_t spectrogram_push_stream(struct spectrogram *spectrogram, struct audio_stream *stream);
+	const int8_t *spectrogram_frame(const struct spectrogram *spectrogram, uint16_t age);
+
+#endif /* LIBS_FUNCTIONAL_HEADERS_SPECTROGRAM_H_ */
@@ -0,0 +1,57 @@
+/*
+ * vad.h
+ *
+ *  Created on: 17 жовт. 2026 р.
+ *      Author: yabe
+ */
+
+#ifndef LIBS_FUNCTIONAL_HEADERS_VAD_H_
+	#define LIBS_FUNCTIONAL_HEADERS_VAD_H_
+
+	#include "fft.h"
+
+	/*
+	 * Voice activity gate in front of the feature extractor and the model.
+	 * Only time domain values of a frame are used, so a quiet frame costs a
+	 * dot product and a sign count instead of an FFT:
+	 *		energy	-	mean square of the sound bits;
+	 *		ZCR		-	zero crossings per sample, high for hiss and fans;
+	 *		flux	-	rise of the energy since the previous frame (onsets
+	 *					of quiet words above a steady background).
+	 * A frame is active when its ZCR is not above zcr_max and its energy is
+	 * above the absolute threshold and the tracked noise floor, or on an
+	 * onset above the absolute threshold.
+	 * hangover frames after the last active one are active too, so word
+	 * endings are not cut.
+	 */
+
+	struct vad_config{
+		uint32_t energy_threshold;	// mean square, nothing below is speech
+		uint16_t noise_ratio;		// Q4, active above noise_floor * noise_ratio / 16
+		uint16_t zcr_max;			// Q8 crossings per sample, above is noise
+		uint16_t flux_ratio;		// Q4, onset above previous energy * flux_ratio / 16
+		uint16_t hangover;			// frames kept active after the last active one
+	};
+
+	/* RMS 200, 3x the noise floor, ZCR 0.45, 6 dB onset, 24 frames (~200 ms) */
+	#define VAD_CONFIG_DEFAULT	{40000u, 48u, 115u, 64u, 24u}
+
+	struct vad{
+		struct vad_config config;
+		uint16_t frame_size;		// sound bits per frame
+		uint32_t noise_floor;		// mean square of the quiet frames
+		uint32_t previous_energy;	// mean square of the previous frame
+		uint16_t hangover_left;		// frames still kept active
+		uint32_t quiet_frames;		// frames since the last active one
+		// Counters, reset by vad_init() only. Skipped model runs are
+		// counted by the model side, see model_counters().
+		uint32_t frames;			// frames checked
+		uint32_t active_frames;		// frames let through
+	};
+
+	void vad_init(struct vad *vad, uint16_t frame_size, const struct vad_config *config);
+	int vad_frame(struct vad *vad, const int16_t *frame);
+	int vad_detect(struct vad *vad, const int16_t *input_data, uint16_t frame_num, uint16_t hop);
+	int vad_active(const struct vad *vad, uint16_t window_frames);
+
+#endif /* LIBS_FUNCTIONAL_HEADERS_VAD_H_ */
@@ -0,0 +1,263 @@
+/*
+ * audio_stream_host.c
+ *
+ *  Created on: 17 жовт. 2026 р.
+ *      Author: yabe
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "audio_stream_host.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+
+static struct {
+	struct audio_stream *stream;
+	FILE *wav;
+	long data_start;
+	uint32_t data_size;
+	uint32_t data_left;
+	uint32_t sample_rate;
+	int loop;
+	volatile int running;
+	pthread_t thread;
+} host;
+
+
+/*******************************************************************************
+* Function Name: read_le
+***************************************
+* Summary:
+*	Read a little-endian unsigned integer of the given size from the file.
+*
+* Return:
+*	0 if succeeded, -1 at the end of the file.
+*
+*******************************************************************************/
+static int read_le(FILE *file, uint32_t *value, int size){
+	uint8_t bytes[4];
+
+	if (fread(bytes, 1, size, file) != (size_t) size)
+		return -1;
+
+	*value = 0;
+	for (int i = size - 1; i >= 0; i--)
+		*value = (*value << 8) | bytes[i];
+
+	return 0;
+}
+
+
+/*******************************************************************************
+* Function Name: open_wav
+***************************************
+* Summary:
+*	Open a PCM WAV file and position it at the first sample.
+*	Only 16-bit mono integer PCM is accepted, which is what the PDM block
+*	delivers on the board.
+*
+* Return:
+*	0 if succeeded, -1 otherwise.
+*
+*******************************************************************************/
+static int open_wav(const char *wav_path){
+	char id[4];
+	uint32_t size, value;
+	int have_format = 0;
+
+	host.wav = fopen(wav_path, "rb");
+	if (host.wav == NULL)
+		return -1;
+
+	if (fread(id, 1, 4, host.wav) != 4 || memcmp(id, "RIFF", 4) != 0 ||
+		read_le(host.wav, &size, 4) != 0 ||
+		fread(id, 1, 4, host.wav) != 4 || memcmp(id, "WAVE", 4) != 0)
+		goto error;
+
+	while (fread(id, 1, 4, host.wav) == 4 && read_le(host.wav, &size, 4) == 0){
+		long next = ftell(host.wav) + size + (size & 1);
+
+		if (memcmp(id, "fmt ", 4) == 0){
+			read_le(host.wav, &value, 2);
+			if (value != 1)		// integer PCM
+				goto error;
+			read_le(host.wav, &value, 2);
+			if (value != 1)		// mono
+				goto error;
+			read_le(host.wav, &host.sample_rate, 4);
+			if (host.sample_rate == 0)
+				goto error;
+			read_le(host.wav, &value, 4);	// byte rate
+			read_le(host.wav, &value, 2);	// block align
+			read_le(host.wav, &value, 2);
+			if (value != 16)
+				goto error;
+			have_format = 1;
+		}
+		else if (memcmp(id, "data", 4) == 0){
+			if (!have_format)
+				goto error;
+			host.data_start = ftell(host.wav);
+			host.data_size = size / sizeof(int16_t);
+			host.data_left = host.data_size;
+			return 0;
+		}
+
+		fseek(host.wav, next, SEEK_SET);
+	}
+
+error:
+	fclose(host.wav);
+	host.wav = NULL;
+	return -1;
+}
+
+
+/*******************************************************************************
+* Function Name: fill_block
+***************************************
+* Summary:
+*	Copy the next block_size samples of the file into the block the DMA
+*	would be writing now. The tail of the file is padded with silence.
+*
+* Return:
+*	0 if the block holds samples of the file, -1 at its end.
+*
+*******************************************************************************/
+static int fill_block(int16_t *block, uint32_t block_size){
+	uint32_t filled = 0;
+
+	while (filled < block_size){
+		if (host.data_left == 0){
+			if (!host.loop)
+				break;
+			fseek(host.wav, host.data_start, SEEK_SET);
+			host.data_left = host.data_size;
+		}
+
+		uint32_t count = block_size - filled;
+		if (count > host.data_left)
+			count = host.data_left;
+
+		size_t read = fread(block + filled, sizeof(int16_t), count, host.wav);
+		if (read == 0){
+			host.data_left = 0;
+			host.loop = 0;
+			break;
+		}
+		filled += read;
+		host.data_left -= read;
+	}
+
+	if (filled == 0)
+		return -1;
+
+	memset(block + filled, 0, (block_size - filled) * sizeof(int16_t));
+	return 0;
+}
+
+
+/*******************************************************************************
+* Function Name: producer_thread
+***************************************
+* Summary:
+*	Timer thread that plays the part of the PDM DMA: one block per
+*	block period, measured against an absolute clock so the rate does not
+*	drift with the time spent in the consumer callback.
+*
+*******************************************************************************/
+static void *producer_thread(void *argument){
+	struct audio_stream *stream = host.stream;
+	struct timespec next;
+	long period_ns = (long) ((1000000000ull * stream->block_size) / host.sample_rate);
+
+	(void) argument;
+	clock_gettime(CLOCK_MONOTONIC, &next);
+
+	while (host.running){
+		next.tv_nsec += period_ns;
+		while (next.tv_nsec >= 1000000000L){
+			next.tv_nsec -= 1000000000L;
+			next.tv_sec++;
+		}
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+		if (fill_block(audio_stream_block(stream, stream->write_count), stream->block_size) != 0)
+			break;
+
+		audio_stream_block_done(stream);
+	}
+
+	host.running = 0;
+	return NULL;
+}
+
+
+/*******************************************************************************
+* Function Name: audio_stream_host_start
+***************************************
+* Summary:
+*	Start feeding the ring of the stream from a WAV file.
+*
+* Parameters:
+*	*stream		-	ring initialized by audio_stream_init();
+*	*wav_path	-	16-bit mono PCM WAV file;
+*	loop		-	start the file over at its end instead of stopping.
+*
+* Return:
+*	0 if succeeded, -1 otherwise.
+*
+*******************************************************************************/
+int audio_stream_host_start(struct audio_stream *stream, const char *wav_path, int loop){
+	if (host.running || open_wav(wav_path) != 0)
+		return -1;
+
+	host.stream = stream;
+	host.loop = loop;
+	host.running = 1;
+	audio_stream_reset(stream);
+
+	if (pthread_create(&host.thread, NULL, producer_thread, NULL) != 0){
+		host.running = 0;
+		fclose(host.wav);
+		host.wav = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+
+/*******************************************************************************
+* Function Name: audio_stream_host_wait
+***************************************
+* Summary:
+*	Wait until the whole file has been streamed. Never returns for a looped
+*	file unless audio_stream_host_stop() is called from another thread.
+*
+*******************************************************************************/
+void audio_stream_host_wait(){
+	if (host.wav == NULL)
+		return;
+
+	pthread_join(host.thread, NULL);
+	fclose(host.wav);
+	host.wav = NULL;
+}
+
+
+/*******************************************************************************
+* Function Name: audio_stream_host_stop
+***************************************
+* Summary:
+*	Stop the producer thread, the host counterpart of stop_audio_stream().
+*
+*******************************************************************************/
+void audio_stream_host_stop(){
+	host.running = 0;
+	audio_stream_host_wait();
+}
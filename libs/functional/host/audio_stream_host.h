@@ -0,0 +1,32 @@
+/*
+ * audio_stream_host.h
+ *
+ *  Created on: 17 жовт. 2026 р.
+ *      Author: yabe
+ */
+
+#ifndef LIBS_FUNCTIONAL_HOST_AUDIO_STREAM_HOST_H_
+	#define LIBS_FUNCTIONAL_HOST_AUDIO_STREAM_HOST_H_
+
+	#include "audio_stream.h"
+
+	/*
+	 * Host (Linux) stand-in for the PDM DMA producer of audio.c.
+	 * A timer thread reads 16-bit mono PCM samples from a WAV file into the
+	 * blocks of the ring at the real-time rate of the file and calls
+	 * audio_stream_block_done() exactly like the DMA interrupt does, so
+	 * the consumer side can be run and debugged without the board.
+	 *
+	 * This directory is excluded from the firmware build (.cyignore).
+	 * Build together with the ring, e.g.:
+	 *	gcc -Ilibs/functional/headers -Ilibs/functional/host \
+	 *		libs/functional/source/audio_stream.c \
+	 *		libs/functional/host/audio_stream_host.c app.c -lpthread
+	 * The Makefile here builds and runs audio_stream_test.c the same way.
+	 */
+
+	int audio_stream_host_start(struct audio_stream *stream, const char *wav_path, int loop);
+	void audio_stream_host_wait();
+	void audio_stream_host_stop();
+
+#endif /* LIBS_FUNCTIONAL_HOST_AUDIO_STREAM_HOST_H_ */
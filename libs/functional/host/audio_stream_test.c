@@ -0,0 +1,309 @@
+/*
+ * audio_stream_test.c
+ *
+ *  Created on: 17 жовт. 2026 р.
+ *      Author: yabe
+ */
+
+/*
+ * Host test of the capture ring (audio_stream.c) fed by the WAV producer of
+ * audio_stream_host.c. The WAV holds a ramp, the value of every sample is its
+ * position in the file, so each frame the consumer gets tells which samples
+ * it holds:
+ *	1. the overrun accounting of audio_stream_available() and
+ *	   audio_stream_release() against a producer driven by hand;
+ *	2. a stream of the WAV in real time through audio_stream_available(),
+ *	   audio_stream_frame() and audio_stream_release(): overlapping frames
+ *	   that cross blocks and wrap the ring, and a consumer that stalls for
+ *	   longer than the ring, after which it must go on with the newest
+ *	   blocks in order and every lost block must be an overrun;
+ *	3. WAV files the producer must reject (stereo, 8-bit).
+ *
+ * Build and run with the Makefile of this directory: make run
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "audio_stream_host.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+
+#define BLOCK_SIZE		256u
+#define BLOCK_NUM		4u
+#define RING_SIZE		(BLOCK_SIZE * BLOCK_NUM)
+/* Frames of 1.5 blocks every half a block, as the spectrogram reads them */
+#define FRAME_LENGTH	(BLOCK_SIZE * 3u / 2u)
+#define FRAME_HOP		(BLOCK_SIZE / 2u)
+
+/* 0.5 s at a high rate keeps the test short and the ramp below 32768 */
+#define SAMPLE_RATE		64000u
+#define SAMPLE_NUM		32000u
+#define BLOCK_TOTAL		((SAMPLE_NUM + BLOCK_SIZE - 1u) / BLOCK_SIZE)
+/* Consumer stall after STALL_BLOCK blocks, several rings long */
+#define STALL_BLOCK		40u
+#define STALL_MS		60l
+
+
+static int16_t ring[RING_SIZE];
+static int16_t copy[FRAME_LENGTH];
+static volatile uint32_t callbacks;
+static int failures;
+
+
+#define CHECK(condition, ...) \
+	do { \
+		if (!(condition)){ \
+			printf("FAILED %s:%d: ", __FILE__, __LINE__); \
+			printf(__VA_ARGS__); \
+			printf("\n"); \
+			failures++; \
+		} \
+	} while (0)
+
+
+static void count_block(const int16_t *block, uint32_t block_size){
+	(void) block;
+	(void) block_size;
+	callbacks++;
+}
+
+
+static void sleep_ms(long ms){
+	struct timespec time = {ms / 1000, (ms % 1000) * 1000000l};
+
+	nanosleep(&time, NULL);
+}
+
+
+/*******************************************************************************
+* Function Name: ramp_sample
+***************************************
+* Summary:
+*	Value the WAV holds at position, the silence the producer pads its last
+*	block with after the end of the file.
+*
+*******************************************************************************/
+static int16_t ramp_sample(uint32_t position){
+	return position < SAMPLE_NUM ? (int16_t) position : 0;
+}
+
+
+static void write_le(FILE *file, uint32_t value, int size){
+	for (int i = 0; i < size; i++)
+		fputc((value >> (8 * i)) & 0xff, file);
+}
+
+
+/*******************************************************************************
+* Function Name: write_wav
+***************************************
+* Summary:
+*	Write a PCM WAV file of the ramp with the given format.
+*
+* Return:
+*	0 if succeeded, -1 otherwise.
+*
+*******************************************************************************/
+static int write_wav(const char *path, uint16_t channels, uint16_t bits){
+	const uint32_t data_size = SAMPLE_NUM * channels * (bits / 8u);
+	FILE *file = fopen(path, "wb");
+
+	if (file == NULL)
+		return -1;
+
+	fwrite("RIFF", 1, 4, file);
+	write_le(file, 36u + data_size, 4);
+	fwrite("WAVEfmt ", 1, 8, file);
+	write_le(file, 16, 4);
+	write_le(file, 1, 2);					// integer PCM
+	write_le(file, channels, 2);
+	write_le(file, SAMPLE_RATE, 4);
+	write_le(file, SAMPLE_RATE * channels * (bits / 8u), 4);
+	write_le(file, channels * (bits / 8u), 2);
+	write_le(file, bits, 2);
+	fwrite("data", 1, 4, file);
+	write_le(file, data_size, 4);
+
+	for (uint32_t i = 0; i < SAMPLE_NUM; i++)
+		for (uint16_t channel = 0; channel < channels; channel++)
+			write_le(file, (uint32_t) (uint16_t) ramp_sample(i), bits / 8u);
+
+	return fclose(file) == 0 ? 0 : -1;
+}
+
+
+/*******************************************************************************
+* Function Name: check_frame
+***************************************
+* Summary:
+*	Take length samples at offset from the oldest unreleased block and check
+*	they are the ramp from the position of that block on.
+*
+* Return:
+*	1 if the frame was copied because it wraps the end of the ring.
+*
+*******************************************************************************/
+static int check_frame(struct audio_stream *stream, uint32_t offset, uint32_t length){
+	const uint32_t position = stream->read_count * BLOCK_SIZE + offset;
+	const int16_t *frame = audio_stream_frame(stream, offset, length, copy);
+
+	for (uint32_t i = 0; i < length; i++)
+		if (frame[i] != ramp_sample(position + i)){
+			CHECK(0, "block %u offset %u sample %u: %d, expected %d",
+				  stream->read_count, offset, i, frame[i], ramp_sample(position + i));
+			break;
+		}
+
+	return frame == copy;
+}
+
+
+/*******************************************************************************
+* Function Name: test_overrun_accounting
+***************************************
+* Summary:
+*	Fill the ring by hand: the block the producer is writing is never
+*	available, older blocks are dropped by audio_stream_available() and a
+*	block overwritten while the consumer holds it is counted on release.
+*
+*******************************************************************************/
+static void test_overrun_accounting(){
+	struct audio_stream stream;
+
+	audio_stream_init(&stream, ring, BLOCK_SIZE, BLOCK_NUM, NULL);
+	CHECK(audio_stream_available(&stream) == 0, "empty ring has blocks");
+	CHECK(audio_stream_acquire(&stream) == NULL, "empty ring hands out a block");
+
+	for (uint32_t i = 0; i < BLOCK_NUM - 1; i++)
+		audio_stream_block_done(&stream);
+	CHECK(audio_stream_available(&stream) == BLOCK_NUM - 1, "full ring: %u blocks",
+		  audio_stream_available(&stream));
+	CHECK(stream.overruns == 0, "full ring: %u overruns", stream.overruns);
+
+	/* The producer moves into the oldest block: it is lost */
+	audio_stream_block_done(&stream);
+	CHECK(audio_stream_available(&stream) == BLOCK_NUM - 1, "wrapped ring: %u blocks",
+		  audio_stream_available(&stream));
+	CHECK(stream.overruns == 1, "wrapped ring: %u overruns", stream.overruns);
+	CHECK(stream.read_count == 1, "wrapped ring: read_count %u", stream.read_count);
+
+	/* Two more rings while nobody reads */
+	for (uint32_t i = 0; i < 2 * BLOCK_NUM; i++)
+		audio_stream_block_done(&stream);
+	CHECK(audio_stream_available(&stream) == BLOCK_NUM - 1, "late consumer: %u blocks",
+		  audio_stream_available(&stream));
+	CHECK(stream.overruns == 1 + 2 * BLOCK_NUM, "late consumer: %u overruns", stream.overruns);
+	CHECK(audio_stream_acquire(&stream) == audio_stream_block(&stream, stream.write_count + 1),
+		  "late consumer does not get the oldest block that is kept");
+
+	/* The producer overwrites the acquired block before it is released */
+	audio_stream_block_done(&stream);
+	audio_stream_release(&stream);
+	CHECK(stream.overruns == 2 + 2 * BLOCK_NUM, "overwritten block: %u overruns", stream.overruns);
+	CHECK(stream.write_count - stream.read_count == BLOCK_NUM - 1,
+		  "overwritten block: %u blocks", stream.write_count - stream.read_count);
+}
+
+
+/*******************************************************************************
+* Function Name: test_stream
+***************************************
+* Summary:
+*	Stream the ramp WAV in real time and read it as overlapping frames.
+*
+*******************************************************************************/
+static void test_stream(const char *wav_path){
+	struct audio_stream stream;
+	uint32_t released = 0, wrapped = 0, stalled = 0, overruns_before_stall = 0;
+
+	audio_stream_init(&stream, ring, BLOCK_SIZE, BLOCK_NUM, count_block);
+	callbacks = 0;
+	if (audio_stream_host_start(&stream, wav_path, 0) != 0){
+		CHECK(0, "can not stream %s", wav_path);
+		return;
+	}
+
+	while (stream.read_count < BLOCK_TOTAL){
+		uint32_t available = audio_stream_available(&stream);
+
+		if (available >= (FRAME_HOP + FRAME_LENGTH + BLOCK_SIZE - 1) / BLOCK_SIZE){
+			/* Both frames that start in the oldest block */
+			wrapped += check_frame(&stream, 0, FRAME_LENGTH);
+			wrapped += check_frame(&stream, FRAME_HOP, FRAME_LENGTH);
+		}
+		else if (available > 0 && stream.write_count == BLOCK_TOTAL)
+			check_frame(&stream, 0, BLOCK_SIZE);		// the end of the file
+		else {
+			sleep_ms(1);
+			continue;
+		}
+
+		audio_stream_release(&stream);
+		released++;
+
+		if (released == STALL_BLOCK && !stalled){
+			overruns_before_stall = stream.overruns;
+			sleep_ms(STALL_MS);
+			stalled = 1;
+		}
+	}
+
+	audio_stream_host_wait();
+
+	CHECK(stream.write_count == BLOCK_TOTAL, "%u blocks streamed, expected %u",
+		  stream.write_count, BLOCK_TOTAL);
+	CHECK(callbacks == stream.write_count, "%u callbacks for %u blocks", callbacks, stream.write_count);
+	CHECK(released + stream.overruns == stream.write_count,
+		  "%u released + %u overruns != %u blocks", released, stream.overruns, stream.write_count);
+	CHECK(stream.overruns > overruns_before_stall, "the stall of %ld ms lost no block", STALL_MS);
+	CHECK(wrapped > 0, "no frame wrapped the end of the ring");
+
+	printf("stream: %u blocks, %u released, %u overruns (%u before the stall), "
+		   "%u frames copied at the end of the ring\n",
+		   stream.write_count, released, stream.overruns, overruns_before_stall, wrapped);
+}
+
+
+/*******************************************************************************
+* Function Name: test_rejected_formats
+***************************************
+* Summary:
+*	The producer only streams what the PDM block delivers.
+*
+*******************************************************************************/
+static void test_rejected_formats(const char *wav_path){
+	struct audio_stream stream;
+
+	audio_stream_init(&stream, ring, BLOCK_SIZE, BLOCK_NUM, NULL);
+
+	if (write_wav(wav_path, 2, 16) != 0 || audio_stream_host_start(&stream, wav_path, 0) == 0){
+		CHECK(0, "stereo WAV accepted");
+		audio_stream_host_stop();
+	}
+	if (write_wav(wav_path, 1, 8) != 0 || audio_stream_host_start(&stream, wav_path, 0) == 0){
+		CHECK(0, "8-bit WAV accepted");
+		audio_stream_host_stop();
+	}
+	CHECK(audio_stream_host_start(&stream, "/nonexistent.wav", 0) != 0, "missing WAV accepted");
+}
+
+
+int main(int argc, char **argv){
+	const char *wav_path = argc > 1 ? argv[1] : "audio_stream_test.wav";
+
+	test_overrun_accounting();
+
+	if (write_wav(wav_path, 1, 16) != 0){
+		printf("FAILED: can not write %s\n", wav_path);
+		return 1;
+	}
+	test_stream(wav_path);
+	test_rejected_formats(wav_path);
+	remove(wav_path);
+
+	printf("%s\n", failures == 0 ? "PASSED" : "FAILED");
+	return failures == 0 ? 0 : 1;
+}
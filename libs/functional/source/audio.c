@@ -8,6 +8,15 @@
 #include "audio.h"
 
 
+/* One PDM DMA descriptor per block of the streaming ring */
+static cy_stc_dma_descriptor_t stream_descriptors[AUDIO_STREAM_MAX_BLOCKS];
+
+/* Ring that is filled by the PDM DMA in the streaming mode */
+static struct audio_stream *active_stream = NULL;
+
+static void audio_stream_isr();
+
+
 /*******************************************************************************
 * Function Name: initialize_audio
 ***************************************
@@ -22,6 +31,7 @@
 *
 * Parameters:
 *	*recorded_data	- array into which the sound will be recorded.
+*					  NULL if only the streaming mode is used.
 *
 * Return:
 *	cy_rslt_t - error status. Returns CY_RSLT_SUCCESS if succeeded.
@@ -129,10 +139,12 @@ void initialize_audio(int16_t *recorded_data){
 	Cy_I2S_EnableTx(CYBSP_I2S_HW);
 	Cy_PDM_PCM_Enable(CYBSP_PDM_HW);
 
-	// BUTTON2 is inverse (see led initialization).
-	change_led_status(BUTTON2);
-	// To avoid noise in first record.
-	record_audio(BUTTON2);
+	if (recorded_data != NULL){
+		// BUTTON2 is inverse (see led initialization).
+		change_led_status(BUTTON2);
+		// To avoid noise in first record.
+		record_audio(BUTTON2);
+	}
 
 	/* Reset the channel index for the next recording */
 	CYBSP_DMA_PDM_HW->CH_STRUCT[CYBSP_DMA_PDM_CHANNEL].CH_IDX = 0;
@@ -223,3 +235,133 @@ void play_record(){
 	/* Start playing the recorded data by enabling the I2S DMA */
 	Cy_DMA_Channel_Enable(CYBSP_DMA_I2S_HW, CYBSP_DMA_I2S_CHANNEL);
 }
+
+
+/*******************************************************************************
+* Function Name: start_audio_stream
+***************************************
+* Summary:
+* 	Start continuous capture into the ring of the stream. Every block gets
+* 	its own PDM DMA descriptor and the descriptors are chained into a loop,
+* 	so the DMA never stops and the CPU is only interrupted once per block.
+* 	Filled blocks are taken with audio_stream_acquire().
+*
+* 	record_audio() must not be called until stop_audio_stream().
+*
+* Parameters:
+*	*stream	-	ring initialized by audio_stream_init(). block_size must be
+*				a multiple of DMA_LOOP_SIZE and no bigger than
+*				DMA_LOOP_SIZE * 256.
+*
+* Return:
+*
+*******************************************************************************/
+void start_audio_stream(struct audio_stream *stream){
+	cy_en_dma_status_t result_DMA;
+	cy_stc_dma_descriptor_config_t descriptor_config = CYBSP_DMA_PDM_Descriptor_0_config;
+	cy_stc_dma_channel_config_t channel_config = CYBSP_DMA_PDM_channelConfig;
+
+	const cy_stc_sysint_t stream_interrupt_config = {
+		.intrSrc = CYBSP_DMA_PDM_IRQ,
+		.intrPriority = AUDIO_STREAM_INTR_PRIORITY,
+	};
+
+	if (stream->block_num < 2 || stream->block_num > AUDIO_STREAM_MAX_BLOCKS ||
+		stream->block_size % DMA_LOOP_SIZE != 0 ||
+		stream->block_size / DMA_LOOP_SIZE > 256)
+		halt_with_error("\tAudio.c -> start_audio_stream() ->"
+						"\n\r\t\t\t-> unsupported ring geometry");
+
+	Cy_DMA_Channel_Disable(CYBSP_DMA_PDM_HW, CYBSP_DMA_PDM_CHANNEL);
+	audio_stream_reset(stream);
+	active_stream = stream;
+
+	/* Interrupt after each descriptor, keep the channel running */
+	descriptor_config.interruptType = CY_DMA_DESCR;
+	descriptor_config.channelState = CY_DMA_CHANNEL_ENABLED;
+	descriptor_config.srcAddress = (void *) &CYBSP_PDM_HW->RX_FIFO_RD;
+	descriptor_config.yCount = stream->block_size / DMA_LOOP_SIZE;
+
+	for (uint32_t i = 0; i < stream->block_num; i++){
+		descriptor_config.dstAddress = (void *) audio_stream_block(stream, i);
+		descriptor_config.nextDescriptor = &stream_descriptors[(i + 1) % stream->block_num];
+
+		result_DMA = Cy_DMA_Descriptor_Init(&stream_descriptors[i], &descriptor_config);
+		if (CY_DMA_SUCCESS != result_DMA)
+			halt_with_error("\tAudio.c -> start_audio_stream() ->"
+							"\n\r\t\t\t-> Cy_DMA_Descriptor_Init()");
+	}
+
+	channel_config.descriptor = &stream_descriptors[0];
+	result_DMA = Cy_DMA_Channel_Init(CYBSP_DMA_PDM_HW, CYBSP_DMA_PDM_CHANNEL, &channel_config);
+	if (CY_DMA_SUCCESS != result_DMA)
+		halt_with_error("\tAudio.c -> start_audio_stream() ->"
+						"\n\r\t\t\t-> Cy_DMA_Channel_Init()");
+
+	Cy_SysInt_Init(&stream_interrupt_config, audio_stream_isr);
+	NVIC_ClearPendingIRQ(stream_interrupt_config.intrSrc);
+	NVIC_EnableIRQ(stream_interrupt_config.intrSrc);
+
+	Cy_DMA_Channel_ClearInterrupt(CYBSP_DMA_PDM_HW, CYBSP_DMA_PDM_CHANNEL);
+	Cy_DMA_Channel_SetInterruptMask(CYBSP_DMA_PDM_HW, CYBSP_DMA_PDM_CHANNEL, CY_DMA_INTR_MASK);
+
+	/* Drop whatever piled up in the FIFO while nobody was reading it */
+	Cy_PDM_PCM_ClearFifo(CYBSP_PDM_HW);
+	Cy_DMA_Channel_Enable(CYBSP_DMA_PDM_HW, CYBSP_DMA_PDM_CHANNEL);
+}
+
+
+/*******************************************************************************
+* Function Name: stop_audio_stream
+***************************************
+* Summary:
+* 	Stop the continuous capture and give the PDM DMA channel back to
+* 	record_audio().
+*
+* Parameters:
+*
+* Return:
+*
+*******************************************************************************/
+void stop_audio_stream(){
+	Cy_DMA_Channel_Disable(CYBSP_DMA_PDM_HW, CYBSP_DMA_PDM_CHANNEL);
+	Cy_DMA_Channel_SetInterruptMask(CYBSP_DMA_PDM_HW, CYBSP_DMA_PDM_CHANNEL, 0);
+	NVIC_DisableIRQ(CYBSP_DMA_PDM_IRQ);
+	active_stream = NULL;
+
+	Cy_DMA_Channel_Init(CYBSP_DMA_PDM_HW, CYBSP_DMA_PDM_CHANNEL, &CYBSP_DMA_PDM_channelConfig);
+
+	/* Reset the channel index for the next recording */
+	CYBSP_DMA_PDM_HW->CH_STRUCT[CYBSP_DMA_PDM_CHANNEL].CH_IDX = 0;
+}
+
+
+/*******************************************************************************
+* Function Name: audio_stream_isr
+***************************************
+* Summary:
+* 	PDM DMA descriptor completed. Descriptor-complete events of blocks that
+* 	end while the interrupt is still pending coalesce into one interrupt,
+* 	so the filled blocks are counted from the descriptor the channel is
+* 	working on now rather than one per interrupt: every block before it is
+* 	complete. The interrupt is cleared before the descriptor is read, a
+* 	block that completes in between is counted here and its interrupt then
+* 	finds nothing to do. Only a stall of a whole ring (block_num blocks)
+* 	can not be told from no block at all; the consumer loses those blocks
+* 	in any case.
+*
+*******************************************************************************/
+static void audio_stream_isr(){
+	Cy_DMA_Channel_ClearInterrupt(CYBSP_DMA_PDM_HW, CYBSP_DMA_PDM_CHANNEL);
+
+	if (active_stream == NULL)
+		return;
+
+	const uint32_t current = (uint32_t) (Cy_DMA_Channel_GetCurrentDescriptor(CYBSP_DMA_PDM_HW, CYBSP_DMA_PDM_CHANNEL) -
+										 stream_descriptors);
+	if (current >= active_stream->block_num)
+		return;
+
+	while (active_stream->write_count % active_stream->block_num != current)
+		audio_stream_block_done(active_stream);
+}
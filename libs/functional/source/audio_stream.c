@@ -0,0 +1,188 @@
+/*
+ * audio_stream.c
+ *
+ *  Created on: 17 жовт. 2026 р.
+ *      Author: yabe
+ */
+
+#include "audio_stream.h"
+
+/* Make the block contents visible before the counter that publishes them */
+#if defined(__GNUC__)
+	#define AUDIO_STREAM_BARRIER()	__sync_synchronize()
+#else
+	#define AUDIO_STREAM_BARRIER()
+#endif
+
+
+/*******************************************************************************
+* Function Name: audio_stream_init
+***************************************
+* Summary:
+*	Attach the ring to the buffer. Nothing is captured until the producer
+*	(start_audio_stream() or the host stand-in) is started.
+*
+* Parameters:
+*	*stream		-	ring to initialize;
+*	*buffer		-	block_num * block_size samples;
+*	block_size	-	samples per block;
+*	block_num	-	blocks in the ring, 2..AUDIO_STREAM_MAX_BLOCKS;
+*	callback	-	called after every filled block, may be NULL.
+*
+* Return:
+*
+*******************************************************************************/
+void audio_stream_init(struct audio_stream *stream, int16_t *buffer,
+					   uint32_t block_size, uint32_t block_num,
+					   audio_stream_callback_t callback){
+	stream->buffer = buffer;
+	stream->block_size = block_size;
+	stream->block_num = block_num;
+	stream->callback = callback;
+	audio_stream_reset(stream);
+}
+
+
+/*******************************************************************************
+* Function Name: audio_stream_reset
+***************************************
+* Summary:
+*	Forget all filled blocks. Must not race with the producer.
+*
+*******************************************************************************/
+void audio_stream_reset(struct audio_stream *stream){
+	stream->write_count = 0;
+	stream->read_count = 0;
+	stream->overruns = 0;
+}
+
+
+/*******************************************************************************
+* Function Name: audio_stream_block
+***************************************
+* Summary:
+*	Address of the block that holds the count-th block of the stream.
+*
+*******************************************************************************/
+int16_t *audio_stream_block(const struct audio_stream *stream, uint32_t count){
+	return stream->buffer + (count % stream->block_num) * stream->block_size;
+}
+
+
+/*******************************************************************************
+* Function Name: audio_stream_block_done
+***************************************
+* Summary:
+*	Producer side: the block audio_stream_block(write_count) is full.
+*	Safe to call from an interrupt.
+*
+*******************************************************************************/
+void audio_stream_block_done(struct audio_stream *stream){
+	const int16_t *block = audio_stream_block(stream, stream->write_count);
+
+	AUDIO_STREAM_BARRIER();
+	stream->write_count++;
+
+	if (stream->callback != NULL)
+		stream->callback(block, stream->block_size);
+}
+
+
+/*******************************************************************************
+* Function Name: audio_stream_available
+***************************************
+* Summary:
+*	Number of filled blocks the consumer has not released yet. The block
+*	the producer is writing into is never counted, so at most
+*	block_num - 1 blocks are available; older ones are dropped and counted
+*	as overruns.
+*
+*******************************************************************************/
+uint32_t audio_stream_available(struct audio_stream *stream){
+	uint32_t available = stream->write_count - stream->read_count;
+
+	if (available >= stream->block_num){
+		stream->overruns += available - (stream->block_num - 1);
+		stream->read_count += available - (stream->block_num - 1);
+		available = stream->block_num - 1;
+	}
+
+	return available;
+}
+
+
+/*******************************************************************************
+* Function Name: audio_stream_acquire
+***************************************
+* Summary:
+*	Hand out the oldest filled block in place, without copying.
+*	The block stays valid until audio_stream_release().
+*
+* Return:
+*	Pointer to block_size samples or NULL if nothing is ready.
+*
+*******************************************************************************/
+const int16_t *audio_stream_acquire(struct audio_stream *stream){
+	if (audio_stream_available(stream) == 0)
+		return NULL;
+
+	AUDIO_STREAM_BARRIER();
+	return audio_stream_block(stream, stream->read_count);
+}
+
+
+/*******************************************************************************
+* Function Name: audio_stream_frame
+***************************************
+* Summary:
+*	Hand out length samples that may cross block boundaries, e.g. an
+*	overlapping FFT frame. Samples are counted from the start of the oldest
+*	block that is not released; the caller makes sure they are filled
+*	(see audio_stream_available()) and releases a block only when no
+*	later frame needs it. The samples are given in place unless they wrap
+*	the end of the ring, only then they are copied.
+*
+* Parameters:
+*	*stream		-	ring;
+*	offset		-	first sample, counted from the oldest unreleased block;
+*	length		-	samples, not more than the ring;
+*	*copy		-	length samples used for a frame that wraps the ring.
+*
+* Return:
+*	Pointer to length samples.
+*
+*******************************************************************************/
+const int16_t *audio_stream_frame(const struct audio_stream *stream, uint32_t offset,
+								  uint32_t length, int16_t *copy){
+	const uint32_t ring_size = stream->block_size * stream->block_num;
+	const uint32_t start = ((stream->read_count % stream->block_num) * stream->block_size + offset) % ring_size;
+	const uint32_t head = ring_size - start;
+
+	AUDIO_STREAM_BARRIER();
+	if (length <= head)
+		return stream->buffer + start;
+
+	for (uint32_t i = 0; i < head; i++)
+		copy[i] = stream->buffer[start + i];
+	for (uint32_t i = head; i < length; i++)
+		copy[i] = stream->buffer[i - head];
+
+	return copy;
+}
+
+
+/*******************************************************************************
+* Function Name: audio_stream_release
+***************************************
+* Summary:
+*	Give the block returned by audio_stream_acquire() back to the producer.
+*	If the producer caught up with it in the meantime its contents were
+*	overwritten while in use; that is counted as an overrun.
+*
+*******************************************************************************/
+void audio_stream_release(struct audio_stream *stream){
+	if (stream->write_count - stream->read_count >= stream->block_num)
+		stream->overruns++;
+
+	stream->read_count++;
+}
@@ -8,6 +8,8 @@
 
 #include "fft.h"
 
+#include <string.h>
+
 /*******************************************************************************
 * Function Name: get_number_of_bits_to_upscale
 ***************************************
@@ -47,59 +49,143 @@ int8_t get_number_of_bits_to_upscale(uint16_t frame_size){
 }
 
 /*******************************************************************************
-* Function Name: fft_q15
+* Function Name: fft_context_init
 ***************************************
 * Summary:
-*	Made FFT transform with set frame_size.
+*	Make everything that depends on the frame size only: the forward and
+*	inverse rfft instances (q15 and q31), the upscale shift and the window.
+*	The window is computed here once in q15 (symmetric, like the old
+*	Hamming code), so the per-frame path is a single arm_mult_q15().
+*	If the frame size or the hop is not supported "halt_with_error(...)"
+*	is called.
 *
 * Parameters:
-* 	*input_data		-	array with input sound bits;
-*	*magnitude		- 	array into which the spectrogram will be recorded;
-*	frame_num		-	number FFT frames
-*	frame_size		-	number of sound bits for FFT.
+*	*context		-	context to initialize;
+*	frame_size		-	number of sound bits for FFT;
+*	hop				-	sound bits between the starts of two frames,
+*						1..frame_size (frame_size - no overlap);
+*	window_type		-	window applied to every frame;
+*	*window			-	frame_size values, may be NULL for FFT_WINDOW_NONE.
 *
 *******************************************************************************/
-void fft_q15(const int16_t *input_data, int16_t *magnitude, uint16_t frame_num, uint16_t frame_size){
-	uint32_t i, j;
-	uint16_t sample_lenght = frame_num * frame_size;
-	int8_t number_of_bits_to_upscale;
-
-	// q31 variables to fix q15 FFT problem (overflow). Not necessary.
-	q15_t buffer_out_complex[frame_size * 2];
-	q15_t magnitude_real[sample_lenght];
-	q15_t buffer_in_real[frame_num][frame_size];
-
-	arm_status status;
-	arm_rfft_instance_q15 Instance_q15_fft;
-
-	status = ARM_MATH_SUCCESS;
-	status = arm_rfft_init_q15(&Instance_q15_fft, frame_size, 0, 1);
-
-	number_of_bits_to_upscale = get_number_of_bits_to_upscale(frame_size);
-
-	// Copy TI's data arrays to the new FFT working buffers
-	for (i = 0; i < frame_num; i++){
-		for (j=0; j<frame_size; j++)
-			buffer_in_real[i][j] = (q15_t)input_data[j + frame_size*i];
+void fft_context_init(struct fft_context *context, uint16_t frame_size, uint16_t hop,
+					  enum fft_window window_type, q15_t *window){
+	float phase, value;
+
+	if (hop == 0 || hop > frame_size)
+		halt_with_error("\tFft.c -> fft_context_init() ->"
+						"\n\r\t\t\t-> bad hop");
+
+	context->frame_size = frame_size;
+	context->hop = hop;
+	context->upscale = get_number_of_bits_to_upscale(frame_size);
+	context->window_type = window_type;
+	context->window = NULL;
+
+	if (arm_rfft_init_q15(&context->rfft_q15, frame_size, 0, 1) != ARM_MATH_SUCCESS ||
+		arm_rfft_init_q15(&context->rifft_q15, frame_size, 1, 1) != ARM_MATH_SUCCESS ||
+		arm_rfft_init_q31(&context->rfft_q31, frame_size, 0, 1) != ARM_MATH_SUCCESS ||
+		arm_rfft_init_q31(&context->rifft_q31, frame_size, 1, 1) != ARM_MATH_SUCCESS)
+		halt_with_error("\tFft.c -> fft_context_init() ->"
+						"\n\r\t\t\t-> arm_rfft_init_q15/q31()");
+
+	if (window_type == FFT_WINDOW_NONE)
+		return;
+
+	if (window == NULL)
+		halt_with_error("\tFft.c -> fft_context_init() ->"
+						"\n\r\t\t\t-> no place for the window");
+
+	for (uint16_t j = 0; j < frame_size; j++){
+		phase = 2*PI*j/(frame_size-1);
+		switch (window_type){
+			case FFT_WINDOW_HANN:
+				value = 0.5f - 0.5f*cosf(phase);
+				break;
+			case FFT_WINDOW_HAMMING:
+				value = 0.54f - 0.46f*cosf(phase);
+				break;
+			default:	// FFT_WINDOW_BLACKMAN
+				value = 0.42f - 0.5f*cosf(phase) + 0.08f*cosf(2*phase);
+				break;
+		}
+		value = value < 0.0f ? 0.0f : value;
+		window[j] = (q15_t)(value * 32767.0f + 0.5f);
 	}
+	context->window = window;
+}
 
-	for (i=0; i<frame_num; i++){
-			//Compute real FFT
-			arm_rfft_q15(&Instance_q15_fft, buffer_in_real[i], buffer_out_complex);
 
-			// Upscale value in some number of bits
-			for (j= 0; j < frame_size * 2; j++)
-				buffer_out_complex[j] <<= number_of_bits_to_upscale;
+/*******************************************************************************
+* Function Name: fft_q15_magnitudes
+***************************************
+* Summary:
+*	FFT magnitudes of one frame: window (if the context has one), FFT,
+*	upscale and magnitude of the bins that are kept only. Shared by every
+*	feature extractor, so they all see the same spectrum.
+*
+* Parameters:
+*	*context		-	FFT context made by fft_context_init();
+*	*frame			-	frame_size sound bits, may be the scratch itself (e.g. a
+*						frame gathered from the two ends of a ring);
+*	bin_offset		-	first magnitude that is kept;
+*	bin_count		-	magnitudes kept;
+*	*magnitude		-	array into which bin_count magnitudes will be recorded,
+*						may be the scratch itself (the input frame is not
+*						needed after the FFT);
+*	*scratch		-	FFT_Q15_SCRATCH_SIZE(frame_size) values; the complex
+*						spectrum (scratch + frame_size) is free after the call.
+*
+*******************************************************************************/
+void fft_q15_magnitudes(const struct fft_context *context, const int16_t *frame, uint16_t bin_offset,
+						uint16_t bin_count, q15_t *magnitude, q15_t *scratch){
+	const uint16_t frame_size = context->frame_size;
+	q15_t *buffer_in_real = scratch;
+	q15_t *buffer_out_complex = scratch + frame_size;
+	q15_t *bins = buffer_out_complex + 2*bin_offset;
+
+	// Copy the frame to the FFT working buffer, arm_rfft_q15() changes it
+	if (context->window != NULL)
+		arm_mult_q15((q15_t *)frame, (q15_t *)context->window, buffer_in_real, frame_size);
+	else if (frame != buffer_in_real)
+		memcpy(buffer_in_real, frame, frame_size*sizeof(q15_t));
+
+	arm_rfft_q15(&context->rfft_q15, buffer_in_real, buffer_out_complex);
+
+	// Upscale value in some number of bits
+	for (uint32_t j = 0; j < 2*bin_count; j++)
+		bins[j] <<= context->upscale;
+
+	// Compute magnitude.
+	//		FFT output has real and imaginary parts, that is way
+	//		magnitude is equal sqrt(r^2 + i^2). This is optimized
+	//		function to compute magnitude.
+	arm_cmplx_mag_q15(bins, magnitude, bin_count);
+}
 
-			// Compute magnitude.
-			//		FFT output has real and imaginary parts, that is way
-			//		magnitude is equal sqrt(r^2 + i^2). This is optimized
-			//		function to compute magnitude.
-			arm_cmplx_mag_q15(buffer_out_complex, magnitude_real, frame_size);
 
-			// Record compute magnitude like 2-dimension array
-			for (j = 0; j < frame_size; j++)
-				magnitude[j + frame_size*i] = (int16_t)magnitude_real[j];
+/*******************************************************************************
+* Function Name: fft_q15
+***************************************
+* Summary:
+*	Made FFT transform with set frame_size. Frame i starts at i * hop of
+*	the context, overlapping frames are read in place.
+*
+* Parameters:
+*	*context		-	FFT context made by fft_context_init();
+* 	*input_data		-	(frame_num - 1) * hop + frame_size sound bits;
+*	*magnitude		- 	array into which the spectrogram will be recorded;
+*	frame_num		-	number FFT frames
+*	*scratch		-	FFT_Q15_SCRATCH_SIZE(frame_size) values.
+*
+*******************************************************************************/
+void fft_q15(const struct fft_context *context, const int16_t *input_data, int16_t *magnitude, uint16_t frame_num, q15_t *scratch){
+	const uint16_t frame_size = context->frame_size;
+
+	// The result is recorded like 2-dimension array.
+	for (uint32_t i=0; i<frame_num; i++)
+		fft_q15_magnitudes(context, input_data + context->hop*i, 0, frame_size,
+						   magnitude + frame_size*i, scratch);
 
 //		// in one cycle (not correct)
 //		q15_t real, imag;                              /* Temporary input variables */
@@ -118,6 +204,104 @@ void fft_q15(const int16_t *input_data, int16_t *magnitude, uint16_t frame_num,
 //			// To return magnitude to q15_t format.
 //			magnitude[j>>1 + frame_size*i] <<= 1;
 //		}
+}
+
+
+/*******************************************************************************
+* Function Name: fft_quant_init
+***************************************
+* Summary:
+*	Prepare the conversion of features to the model input.
+*	A feature step m (an FFT magnitude, a Q8 log-mel energy) is the real
+*	value m * feature_scale, it is quantized as
+*		zero_point + ceil(m * feature_scale / scale)
+*	with a Q16 multiplier, so no float is used per value. For the shipped
+*	model and FFT_FEATURE_SCALE this is exactly the old
+*	"(float)m / 256 - 128" conversion.
+*	If the input scale is finer than one feature step "halt_with_error(...)"
+*	is called.
+*
+* Parameters:
+*	*quant			-	conversion to initialize;
+*	feature_scale	-	FFT_FEATURE_SCALE or MEL_FEATURE_SCALE;
+*	scale			-	scale of the model input tensor;
+*	zero_point		-	zero point of the model input tensor.
+*
+*******************************************************************************/
+void fft_quant_init(struct fft_quant *quant, float feature_scale, float scale, int32_t zero_point){
+	float multiplier = feature_scale / scale * 65536.0f;
+
+	if (!(multiplier > 0.0f && multiplier <= 65536.0f))
+		halt_with_error("\tFft.c -> fft_quant_init() ->"
+						"\n\r\t\t\t-> bad input scale");
+
+	quant->multiplier = (uint32_t)(multiplier + 0.5f);
+	quant->zero_point = zero_point;
+}
+
+
+/*******************************************************************************
+* Function Name: fft_quantize_magnitudes
+***************************************
+* Summary:
+*	Convert FFT magnitudes or other features to the model input
+*	(see fft_quant_init()).
+*
+* Parameters:
+*	*quant		-	conversion;
+*	*magnitude	-	count magnitudes (or signed features, e.g. MFCC);
+*	*features	-	array into which count model inputs will be recorded;
+*	count		-	number of values.
+*
+*******************************************************************************/
+void fft_quantize_magnitudes(const struct fft_quant *quant, const q15_t *magnitude, int8_t *features, uint16_t count){
+	const int32_t multiplier = (int32_t)quant->multiplier;
+	const int32_t zero_point = quant->zero_point;
+	int32_t value;
+
+	for (uint16_t j = 0; j < count; j++){
+		// The multiplier is at most 1.0 in Q16, so the product fits int32,
+		// and the arithmetic shift rounds up for negative values too.
+		value = zero_point + ((magnitude[j] * multiplier + 0xFFFF) >> 16);
+		features[j] = (int8_t)(value > 127 ? 127 : (value < -128 ? -128 : value));
+	}
+}
+
+
+/*******************************************************************************
+* Function Name: fft_q15_features
+***************************************
+* Summary:
+*	FFT, magnitude and quantization in one pass: the model input is made
+*	straight from the sound, without an int16 spectrogram in between.
+*	Only the magnitudes that are kept are upscaled and computed.
+*	The magnitudes are the same as the ones of fft_q15(), frames follow the
+*	hop of the context.
+*
+* Parameters:
+*	*context		-	FFT context made by fft_context_init();
+* 	*input_data		-	(frame_num - 1) * hop + frame_size sound bits;
+*	*features		- 	frame_num * bin_count model inputs (the input tensor);
+*	frame_num		-	number FFT frames;
+*	bin_offset		-	first magnitude of a frame that is kept;
+*	bin_count		-	magnitudes kept per frame;
+*	*quant			-	conversion made by fft_quant_init();
+*	*scratch		-	FFT_Q15_SCRATCH_SIZE(frame_size) values.
+*
+*******************************************************************************/
+void fft_q15_features(const struct fft_context *context, const int16_t *input_data, int8_t *features, uint16_t frame_num,
+					  uint16_t bin_offset, uint16_t bin_count, const struct fft_quant *quant, q15_t *scratch){
+	const uint16_t frame_size = context->frame_size;
+	// The input frame is not needed after the FFT, its place is reused.
+	q15_t *magnitude = scratch;
+
+	if (bin_offset + bin_count > frame_size)
+		halt_with_error("\tFft.c -> fft_q15_features() ->"
+						"\n\r\t\t\t-> bins out of the frame");
+
+	for (uint32_t i=0; i<frame_num; i++){
+		fft_q15_magnitudes(context, input_data + context->hop*i, bin_offset, bin_count, magnitude, scratch);
+		fft_quantize_magnitudes(quant, magnitude, features + bin_count*i, bin_count);
 	}
 }
 
@@ -135,50 +319,38 @@ void fft_q15(const int16_t *input_data, int16_t *magnitude, uint16_t frame_num,
 *		To avoid this, set the first bit to the average of the previous and next bits.
 *
 * Parameters:
+*	*context		-	FFT context made by fft_context_init();
 * 	*input_data		-	array with input sound bits;
 *	*data_output	- 	array into which the IFFT sound will be recorded;
 *	frame_num		-	number FFT frames;
-*	frame_size		-	number of sound bits for FFT.
+*	*scratch		-	FFT_Q15_SCRATCH_SIZE(frame_size) values.
 *
 *******************************************************************************/
-void fft_q15_sound(const int16_t *input_data, int16_t *data_output, uint16_t frame_num, uint16_t frame_size){
+void fft_q15_sound(const struct fft_context *context, const int16_t *input_data, int16_t *data_output, uint16_t frame_num, q15_t *scratch){
+	const uint16_t frame_size = context->frame_size;
+	const int8_t number_of_bits_to_upscale = context->upscale;
 	uint32_t i, j;
-	uint16_t sample_lenght = frame_num * frame_size;
-	int8_t number_of_bits_to_upscale;
-
-	// q31 variables to fix q15 FFT problem (overflow). Not necessary.
-	q15_t buffer_out_complex[frame_size * 2];
-	q15_t buffer_in_real[frame_num][frame_size];
-
-	arm_status status;
-	arm_rfft_instance_q15 Instance_q15_fft;
-	arm_rfft_instance_q15 Instance_q15_ifft;
-
-	status = ARM_MATH_SUCCESS;
-	status = arm_rfft_init_q15(&Instance_q15_fft, frame_size, 0, 1);
-	status = arm_rfft_init_q15(&Instance_q15_ifft, frame_size, 1, 1);
 
-	number_of_bits_to_upscale = get_number_of_bits_to_upscale(frame_size);
+	q15_t *buffer_in_real = scratch;
+	q15_t *buffer_out_complex = scratch + frame_size;
 
-	// Copy input data arrays to the new FFT working buffers
-	for (i = 0; i < frame_num; i++){
+	for (i=0; i<frame_num; i++){
+		// Copy the frame to the FFT working buffer
 		for (j=0; j<frame_size; j++)
-			buffer_in_real[i][j] = (q15_t)input_data[j + frame_size*i];
-	}
+			buffer_in_real[j] = (q15_t)input_data[j + frame_size*i];
 
-	for (i=0; i<frame_num; i++){
 		//Compute real FFT
-		arm_rfft_q15(&Instance_q15_fft, buffer_in_real[i], buffer_out_complex);
+		arm_rfft_q15(&context->rfft_q15, buffer_in_real, buffer_out_complex);
 
 		// Upscale value in some number of bits
 		for (j= 0; j < frame_size * 2; j++)
 			buffer_out_complex[j] <<= number_of_bits_to_upscale;
 
 		//Compute inverse real FFT (IFFT) using the data from FFT
-		arm_rfft_q15(&Instance_q15_ifft, buffer_out_complex, buffer_in_real[i]);
+		arm_rfft_q15(&context->rifft_q15, buffer_out_complex, buffer_in_real);
 
 		for (j = 1; j < frame_size; j++)
-			data_output[j + frame_size*i] = (int16_t)buffer_in_real[i][j]<<1;
+			data_output[j + frame_size*i] = (int16_t)buffer_in_real[j]<<1;
 
 		// IFFT has problem with backward transform, first bit in each frame get noise.
 		//		To avoid this, set the first bit to the average of the previous and next bits.
@@ -195,69 +367,56 @@ void fft_q15_sound(const int16_t *input_data, int16_t *data_output, uint16_t fra
 ***************************************
 * Summary:
 * 	This function shows how FFT and IFFT work with pre-processing using the
-* 		Hamming window and gives some estimates:
+* 		window of the context (FFT_WINDOW_HAMMING) and gives some estimates:
 * 			* What is the quality of the output signal;
 * 			* Which noises are added;
 * 			* How much time spends to made FFT and IFFT;
 *
+* 	Like before, a bit is pre-processed as x + x * window.
+*
 * 	IFFT has problem with backward transform, first bit in each frame gets noise.
 *		To avoid this, set the first bit to the average of the previous and next bits.
 *
 * Parameters:
+*	*context		-	FFT context made by fft_context_init();
 * 	*input_data		-	array with input sound bits;
 *	*data_output	- 	array into which the IFFT sound will be recorded;
 *	frame_num		-	number FFT frames;
-*	frame_size		-	number of sound bits for FFT.
+*	*scratch		-	FFT_Q15_SCRATCH_SIZE(frame_size) values.
 *
 *******************************************************************************/
-void fft_q15_hamming_sound(const int16_t *input_data, int16_t *data_output, uint16_t frame_num, uint16_t frame_size){
+void fft_q15_hamming_sound(const struct fft_context *context, const int16_t *input_data, int16_t *data_output, uint16_t frame_num, q15_t *scratch){
+	const uint16_t frame_size = context->frame_size;
+	const int8_t number_of_bits_to_upscale = context->upscale;
+	const q15_t *window = context->window;
 	uint32_t i, j;
-	uint16_t sample_lenght = frame_num * frame_size;
-	int8_t number_of_bits_to_upscale;
-	float32_t temp;
-
-	arm_status status;
-	arm_rfft_instance_q15 Instance_q15_fft;
-	arm_rfft_instance_q15 Instance_q15_ifft;
-
-	// q31 variables to fix q15 FFT problem (overflow). Not necessary.
-	q15_t buffer_out_complex[frame_size * 2];
-	q15_t buffer_in_real[frame_num][frame_size];
-
-	float32_t hamming[frame_size];
+	q31_t temp;
 
-	status = ARM_MATH_SUCCESS;
-	status = arm_rfft_init_q15(&Instance_q15_fft, frame_size, 0, 1);
-	status = arm_rfft_init_q15(&Instance_q15_ifft, frame_size, 1, 1);
+	q15_t *buffer_in_real = scratch;
+	q15_t *buffer_out_complex = scratch + frame_size;
 
-	number_of_bits_to_upscale = get_number_of_bits_to_upscale(frame_size);
-
-	// Compute coefficient of Hamming window
-	for (j=0; j<frame_size; j++)
-		hamming[j] = 0.54 - 0.46*sinf((2*PI*j)/(frame_size-1));
-
-	// Copy TI's data arrays to the new FFT working buffers
-	for (i = 0; i < frame_num; i++){
+	for (i=0; i<frame_num; i++){
+		// Copy the windowed frame to the FFT working buffer
 		for (j=0; j<frame_size; j++){
-			temp = input_data[j + frame_size*i] * hamming[j];
-			buffer_in_real[i][j] = (q15_t)(temp + (q31_t)input_data[j + frame_size*i]);
+			temp = input_data[j + frame_size*i];
+			if (window != NULL)
+				temp += (temp * window[j]) >> 15;
+			buffer_in_real[j] = (q15_t)__SSAT(temp, 16);
 		}
-	}
 
-	for (i=0; i<frame_num; i++){
 		//Compute real FFT using the completed data buffer
-		arm_rfft_q15(&Instance_q15_fft, buffer_in_real[i], buffer_out_complex);
+		arm_rfft_q15(&context->rfft_q15, buffer_in_real, buffer_out_complex);
 
 		// Upscale value in some number of bits
 		for (j= 0; j < frame_size * 2; j++)
 			buffer_out_complex[j] <<= number_of_bits_to_upscale;
 
 		//Compute inverse real FFT using the data from fft
-		arm_rfft_q15(&Instance_q15_ifft, buffer_out_complex, buffer_in_real[i]);
+		arm_rfft_q15(&context->rifft_q15, buffer_out_complex, buffer_in_real);
 
 
 		for (j = 0; j < frame_size; j++)
-			data_output[j + frame_size*i] = (int16_t)buffer_in_real[i][j];
+			data_output[j + frame_size*i] = (int16_t)buffer_in_real[j];
 
 		// IFFT has problem with backward transform, first bit in each frame get noise.
 		//		To avoid this, set the first bit to the average of the previous and next bits.
@@ -277,39 +436,31 @@ void fft_q15_hamming_sound(const int16_t *input_data, int16_t *data_output, uint
 *	Made FFT transform with set frame_size.
 *
 * Parameters:
+*	*context		-	FFT context made by fft_context_init();
 * 	*input_data		-	array with input sound bits;
 *	*magnitude		- 	array into which the spectrogram will be recorded;
 *	frame_num		-	number FFT frames;
-*	frame_size		-	number of sound bits for FFT.
+*	*scratch		-	FFT_Q31_SCRATCH_SIZE(frame_size) values.
 *
 *******************************************************************************/
-void fft_q31(const int16_t *input_data, int16_t *magnitude, uint16_t frame_num, uint16_t frame_size){
+void fft_q31(const struct fft_context *context, const int16_t *input_data, int16_t *magnitude, uint16_t frame_num, q31_t *scratch){
+	const uint16_t frame_size = context->frame_size;
+	const int8_t number_of_bits_to_upscale = context->upscale;
 	uint32_t i, j;
-	uint16_t sample_lenght = frame_num * frame_size;
-	int8_t number_of_bits_to_upscale;
-
-	// q31 variables to fix q31 FFT problem (overflow). Not necessary.
-	q31_t buffer_out_complex[frame_size * 2];
-	q31_t magnitude_real[sample_lenght];
-	q31_t buffer_in_real[frame_num][frame_size];
-
-	arm_status status;
-	arm_rfft_instance_q31 Instance_q31_fft;
-
-	status = ARM_MATH_SUCCESS;
-	status = arm_rfft_init_q31(&Instance_q31_fft, frame_size, 0, 1);
 
-	number_of_bits_to_upscale = get_number_of_bits_to_upscale(frame_size);
+	q31_t *buffer_in_real = scratch;
+	q31_t *buffer_out_complex = scratch + frame_size;
 
-	// Copy TI's data arrays to the new FFT working buffers
-	for (i = 0; i < frame_num; i++){
-		for (j=0; j<frame_size; j++)
-			buffer_in_real[i][j] = (q31_t)input_data[j + frame_size*i];
-	}
+	// The input frame is not needed after the FFT, its place is reused.
+	q31_t *magnitude_real = buffer_in_real;
 
 	for (i=0; i<frame_num; i++){
+			// Copy the frame to the FFT working buffer, arm_rfft_q31() changes it
+			for (j=0; j<frame_size; j++)
+				buffer_in_real[j] = (q31_t)input_data[j + frame_size*i];
+
 			//Compute real FFT
-			arm_rfft_q31(&Instance_q31_fft, buffer_in_real[i], buffer_out_complex);
+			arm_rfft_q31(&context->rfft_q31, buffer_in_real, buffer_out_complex);
 
 			// Upscale value in some number of bits
 			for (j= 0; j < frame_size * 2; j++)
@@ -359,50 +510,38 @@ void fft_q31(const int16_t *input_data, int16_t *magnitude, uint16_t frame_num,
 *		To avoid this, set the first bit to the average of the previous and next bits.
 *
 * Parameters:
+*	*context		-	FFT context made by fft_context_init();
 * 	*input_data		-	array with input sound bits;
 *	*data_output	- 	array into which the IFFT sound will be recorded;
 *	frame_num		-	number FFT frames;
-*	frame_size		-	number of sound bits for FFT.
+*	*scratch		-	FFT_Q31_SCRATCH_SIZE(frame_size) values.
 *
 *******************************************************************************/
-void fft_q31_sound(const int16_t *input_data, int16_t *data_output, uint16_t frame_num, uint16_t frame_size){
+void fft_q31_sound(const struct fft_context *context, const int16_t *input_data, int16_t *data_output, uint16_t frame_num, q31_t *scratch){
+	const uint16_t frame_size = context->frame_size;
+	const int8_t number_of_bits_to_upscale = context->upscale;
 	uint32_t i, j;
-	uint16_t sample_lenght = frame_num * frame_size;
-	int8_t number_of_bits_to_upscale;
-
-	// q31 variables to fix q31 FFT problem (overflow). Not necessary.
-	q31_t buffer_out_complex[frame_size * 2];
-	q31_t buffer_in_real[frame_num][frame_size];
-
-	arm_status status;
-	arm_rfft_instance_q31 Instance_q31_fft;
-	arm_rfft_instance_q31 Instance_q31_ifft;
 
-	status = ARM_MATH_SUCCESS;
-	status = arm_rfft_init_q31(&Instance_q31_fft, frame_size, 0, 1);
-	status = arm_rfft_init_q31(&Instance_q31_ifft, frame_size, 1, 1);
+	q31_t *buffer_in_real = scratch;
+	q31_t *buffer_out_complex = scratch + frame_size;
 
-	number_of_bits_to_upscale = get_number_of_bits_to_upscale(frame_size);
-
-	// Copy input data arrays to the new FFT working buffers
-	for (i = 0; i < frame_num; i++){
+	for (i=0; i<frame_num; i++){
+		// Copy the frame to the FFT working buffer
 		for (j=0; j<frame_size; j++)
-			buffer_in_real[i][j] = (q31_t)input_data[j + frame_size*i];
-	}
+			buffer_in_real[j] = (q31_t)input_data[j + frame_size*i];
 
-	for (i=0; i<frame_num; i++){
 		//Compute real FFT
-		arm_rfft_q31(&Instance_q31_fft, buffer_in_real[i], buffer_out_complex);
+		arm_rfft_q31(&context->rfft_q31, buffer_in_real, buffer_out_complex);
 
 		// Upscale value in some number of bits
 		for (j= 0; j < frame_size * 2; j++)
 			buffer_out_complex[j] <<= number_of_bits_to_upscale;
 
 		//Compute inverse real FFT (IFFT) using the data from FFT
-		arm_rfft_q31(&Instance_q31_ifft, buffer_out_complex, buffer_in_real[i]);
+		arm_rfft_q31(&context->rifft_q31, buffer_out_complex, buffer_in_real);
 
 		for (j = 1; j < frame_size; j++)
-			data_output[j + frame_size*i] = (int16_t)buffer_in_real[i][j]<<1;
+			data_output[j + frame_size*i] = (int16_t)buffer_in_real[j]<<1;
 
 		// IFFT has problem with backward transform, first bit in each frame get noise.
 		//		To avoid this, set the first bit to the average of the previous and next bits.
@@ -419,69 +558,56 @@ void fft_q31_sound(const int16_t *input_data, int16_t *data_output, uint16_t fra
 ***************************************
 * Summary:
 * 	This function shows how FFT and IFFT work with pre-processing using the
-* 		Hamming window and gives some estimates:
+* 		window of the context (FFT_WINDOW_HAMMING) and gives some estimates:
 * 			* What is the quality of the output signal;
 * 			* Which noises are added;
 * 			* How much time spends to made FFT and IFFT;
 *
+* 	Like before, a bit is pre-processed as x + x * window.
+*
 * 	IFFT has problem with backward transform, first bit in each frame gets noise.
 *		To avoid this, set the first bit to the average of the previous and next bits.
 *
 * Parameters:
+*	*context		-	FFT context made by fft_context_init();
 * 	*input_data		-	array with input sound bits;
 *	*data_output	- 	array into which the IFFT sound will be recorded;
 *	frame_num		-	number FFT frames;
-*	frame_size		-	number of sound bits for FFT.
+*	*scratch		-	FFT_Q31_SCRATCH_SIZE(frame_size) values.
 *
 *******************************************************************************/
-void fft_q31_hamming_sound(const int16_t *input_data, int16_t *data_output, uint16_t frame_num, uint16_t frame_size){
+void fft_q31_hamming_sound(const struct fft_context *context, const int16_t *input_data, int16_t *data_output, uint16_t frame_num, q31_t *scratch){
+	const uint16_t frame_size = context->frame_size;
+	const int8_t number_of_bits_to_upscale = context->upscale;
+	const q15_t *window = context->window;
 	uint32_t i, j;
-	uint16_t sample_lenght = frame_num * frame_size;
-	int8_t number_of_bits_to_upscale;
-	float32_t temp;
-
-	arm_status status;
-	arm_rfft_instance_q31 Instance_q31_fft;
-	arm_rfft_instance_q31 Instance_q31_ifft;
-
-	// q31 variables to fix q31 FFT problem (overflow). Not necessary.
-	q31_t buffer_out_complex[frame_size * 2];
-	q31_t buffer_in_real[frame_num][frame_size];
+	q31_t temp;
 
-	float32_t hamming[frame_size];
+	q31_t *buffer_in_real = scratch;
+	q31_t *buffer_out_complex = scratch + frame_size;
 
-	status = ARM_MATH_SUCCESS;
-	status = arm_rfft_init_q31(&Instance_q31_fft, frame_size, 0, 1);
-	status = arm_rfft_init_q31(&Instance_q31_ifft, frame_size, 1, 1);
-
-	number_of_bits_to_upscale = get_number_of_bits_to_upscale(frame_size);
-
-	// Compute coefficient of Hamming window
-	for (j=0; j<frame_size; j++)
-		hamming[j] = 0.54 - 0.46*sinf((2*PI*j)/(frame_size-1));
-
-	// Copy TI's data arrays to the new FFT working buffers
-	for (i = 0; i < frame_num; i++){
+	for (i=0; i<frame_num; i++){
+		// Copy the windowed frame to the FFT working buffer
 		for (j=0; j<frame_size; j++){
-			temp = input_data[j + frame_size*i] * hamming[j];
-			buffer_in_real[i][j] = temp + input_data[j + frame_size*i];
+			temp = input_data[j + frame_size*i];
+			if (window != NULL)
+				temp += (temp * window[j]) >> 15;
+			buffer_in_real[j] = temp;
 		}
-	}
 
-	for (i=0; i<frame_num; i++){
 		//Compute real FFT using the completed data buffer
-		arm_rfft_q31(&Instance_q31_fft, buffer_in_real[i], buffer_out_complex);
+		arm_rfft_q31(&context->rfft_q31, buffer_in_real, buffer_out_complex);
 
 		// Upscale value in some number of bits
 		for (j= 0; j < frame_size * 2; j++)
 			buffer_out_complex[j] <<= number_of_bits_to_upscale;
 
 		//Compute inverse real FFT using the data from fft
-		arm_rfft_q31(&Instance_q31_ifft, buffer_out_complex, buffer_in_real[i]);
+		arm_rfft_q31(&context->rifft_q31, buffer_out_complex, buffer_in_real);
 
 
 		for (j = 0; j < frame_size; j++)
-			data_output[j + frame_size*i] = (int16_t)buffer_in_real[i][j];
+			data_output[j + frame_size*i] = (int16_t)buffer_in_real[j];
 
 		// IFFT has problem with backward transform, first bit in each frame get noise.
 		//		To avoid this, set the first bit to the average of the previous and next bits.
@@ -507,59 +633,48 @@ void fft_q31_hamming_sound(const int16_t *input_data, int16_t *data_output, uint
 *		To avoid this, set the first bit to the average of the previous and next bits.
 *
 * Parameters:
+*	*context		-	FFT context made by fft_context_init();
 * 	*input_data		-	array with input sound bits;
 *	*data_output	- 	array into which the IFFT sound will be recorded;
 *	frame_num		-	number FFT frames;
-*	frame_size		-	number of sound bits for FFT.
+*	*scratch		-	FFT_Q15_SCRATCH_SIZE(frame_size) values.
 *
 *******************************************************************************/
-void fft_q15_test_1khz_sound(int16_t *input_data, int16_t *data_output, uint16_t frame_num, uint16_t frame_size){
+void fft_q15_test_1khz_sound(const struct fft_context *context, int16_t *input_data, int16_t *data_output, uint16_t frame_num, q15_t *scratch){
+	const uint16_t frame_size = context->frame_size;
+	const int8_t number_of_bits_to_upscale = context->upscale;
 	uint32_t i, j;
-	uint16_t sample_lenght = frame_num * frame_size;
-	int8_t number_of_bits_to_upscale;
 
-	// q31 variables to fix q15 FFT problem (overflow). Not necessary.
-	q15_t buffer_out_complex[frame_size * 2];
-	q15_t buffer_in_real[frame_num][frame_size];
+	q15_t *buffer_in_real = scratch;
+	q15_t *buffer_out_complex = scratch + frame_size;
 
-	arm_status status;
-	arm_rfft_instance_q15 Instance_q15_fft;
-	arm_rfft_instance_q15 Instance_q15_ifft;
 
 	uint16_t freq = 1000;
 	uint16_t freq_d = 16384;
 	uint32_t t = 0;
 	float32_t temp;
 
-	status = ARM_MATH_SUCCESS;
-	status = arm_rfft_init_q15(&Instance_q15_fft, frame_size, 0, 1);
-	status = arm_rfft_init_q15(&Instance_q15_ifft, frame_size, 1, 1);
-
-	number_of_bits_to_upscale = get_number_of_bits_to_upscale(frame_size);
-
-	// Generate a 1000 Hz sine wave
-	for (i = 0; i < frame_num; i++){
+	for (i=0; i<frame_num; i++){
+		// Generate a 1000 Hz sine wave
 		for (j=0; j<frame_size; j++){
 			t = j + frame_size*i;
 			temp = 1000.0 * sinf(6.283185308 * t * (float)freq / (float)freq_d);
-			buffer_in_real[i][j] = (q15_t)temp;
-			input_data[t] = (uint16_t)buffer_in_real[i][j];
+			buffer_in_real[j] = (q15_t)temp;
+			input_data[t] = (uint16_t)buffer_in_real[j];
 		}
-	}
 
-	for (i=0; i<frame_num; i++){
 		//Compute real FFT using the completed data buffer
-		arm_rfft_q15(&Instance_q15_fft, buffer_in_real[i], buffer_out_complex);
+		arm_rfft_q15(&context->rfft_q15, buffer_in_real, buffer_out_complex);
 
 		// Upscale value in some number of bits
 		for (j= 0; j < frame_size * 2; j++)
 			buffer_out_complex[j] <<= number_of_bits_to_upscale;
 
 		//Compute inverse real FFT using the data from fft
-		arm_rfft_q15(&Instance_q15_ifft, buffer_out_complex, buffer_in_real[i]);
+		arm_rfft_q15(&context->rifft_q15, buffer_out_complex, buffer_in_real);
 
 		for (j = 0; j < frame_size; j++)
-			data_output[j + frame_size*i] = (int16_t)buffer_in_real[i][j];
+			data_output[j + frame_size*i] = (int16_t)buffer_in_real[j];
 
 		// IFFT has problem with backward transform, first bit in each frame get noise.
 		//		To avoid this, set the first bit to the average of the previous and next bits.
@@ -578,47 +693,37 @@ void fft_q15_test_1khz_sound(int16_t *input_data, int16_t *data_output, uint16_t
 *	This function shows how FFT work with one-wave signal
 *
 * Parameters:
+*	*context		-	FFT context made by fft_context_init();
 * 	*input_data		-	array with input sound bits;
 *	*magnitude		- 	array into which the spectrogram will be recorded;
 *	frame_num		-	number FFT frames;
-*	frame_size		-	number of sound bits for FFT.
+*	*scratch		-	FFT_Q15_SCRATCH_SIZE(frame_size) values.
 *
 *******************************************************************************/
-void fft_q15_test_1khz_fft(const int16_t *input_data, int16_t *data_output, uint16_t frame_num, uint16_t frame_size){
+void fft_q15_test_1khz_fft(const struct fft_context *context, const int16_t *input_data, int16_t *data_output, uint16_t frame_num, q15_t *scratch){
+	const uint16_t frame_size = context->frame_size;
+	const int8_t number_of_bits_to_upscale = context->upscale;
 	uint32_t i, j;
-	uint16_t sample_lenght = frame_num * frame_size;
-	int8_t number_of_bits_to_upscale;
 
-	// q31 variables to fix q15 FFT problem (overflow). Not necessary.
-	q15_t buffer_out_complex[frame_size * 2];
-	q15_t magnitude_real[sample_lenght];
-	q15_t buffer_in_real[frame_num][frame_size];
+	q15_t *buffer_in_real = scratch;
+	q15_t *buffer_out_complex = scratch + frame_size;
 
-	arm_status status;
-	arm_rfft_instance_q15 Instance_q15_fft;
 
 	uint16_t freq = 1000;
 	uint16_t freq_d = 16384;
 	uint32_t t = 0;
 	float32_t temp;
 
-	status = ARM_MATH_SUCCESS;
-	status = arm_rfft_init_q15(&Instance_q15_fft, frame_size, 0, 1);
-
-	number_of_bits_to_upscale = get_number_of_bits_to_upscale(frame_size);
-
-	// Generate a 1000 Hz sine wave
-	for (i = 0; i < frame_num; i++){
+	for (i=0; i<frame_num; i++){
+		// Generate a 1000 Hz sine wave
 		for (j=0; j<frame_size; j++){
 			t = j + frame_size*i;
 			temp = 1000.0 * sinf(6.283185308 * t * (float)freq / (float)freq_d);
-			buffer_in_real[i][j] = (q15_t)temp;
+			buffer_in_real[j] = (q15_t)temp;
 		}
-	}
 
-	for (i=0; i<frame_num; i++){
 		//Compute real FFT using the completed data buffer
-		arm_rfft_q15(&Instance_q15_fft, buffer_in_real[i], buffer_out_complex);
+		arm_rfft_q15(&context->rfft_q15, buffer_in_real, buffer_out_complex);
 
 		// Upscale value in some number of bits
 		for (j= 0; j < frame_size * 2; j++)
@@ -628,11 +733,8 @@ void fft_q15_test_1khz_fft(const int16_t *input_data, int16_t *data_output, uint
 		//		FFT output has real and imaginary parts, that is way
 		//		magnitude is equal sqrt(r^2 + i^2). This is optimized
 		//		function to compute magnitude.
-		arm_cmplx_mag_q15(buffer_out_complex, magnitude_real, frame_size);
-
-		// Record compute magnitude like 2-dimension array
-		for (j = 0; j < frame_size; j++)
-			data_output[j + frame_size*i] = (int16_t)magnitude_real[j];
+		//		The result is recorded like 2-dimension array.
+		arm_cmplx_mag_q15(buffer_out_complex, data_output + frame_size*i, frame_size);
 	}
 }
 
@@ -651,9 +753,7 @@ void fft_q15_test_1khz_fft(const int16_t *input_data, int16_t *data_output, uint
 //	float32_t buffer_out_complex[frame_size*2];
 //
 //
-//	status = ARM_MATH_SUCCESS;
-//	number_of_bits_to_upscale = get_number_of_bits_to_upscale(frame_size);
-//
+//////
 //	// Copy TI's data arrays to the new FFT working buffers
 //	for (i = 0; i < frame_num; i++){
 //		for (j=0; j<frame_size; j++)
@@ -664,16 +764,14 @@ void fft_q15_test_1khz_fft(const int16_t *input_data, int16_t *data_output, uint
 //	for (i=0; i<frame_num; i++){
 //		//Compute real FFT using the completed data buffer
 //		arm_rfft_fast_instance_f32 Instance_q15;
-//		status = arm_rfft_fast_init_f32(&Instance_q15, frame_size);
-//		arm_rfft_fast_f32(&Instance_q15, buffer_in_complex[i], buffer_out_complex, 0);
+//	//		arm_rfft_fast_f32(&Instance_q15, buffer_in_complex[i], buffer_out_complex, 0);
 //
 ////		for (j= 0; j < frame_size * 2; j++)
 ////			buffer_out_complex[j] <<= number_of_bits_to_upscale;
 //
 //		//Compute inverse real FFT using the data from fft
 //		arm_rfft_fast_instance_f32 Instance_q15;
-//		status = arm_rfft_fast_init_f32(&Instance_q15, frame_size);
-//		arm_rfft_fast_f32(&Instance_q15, buffer_out_complex, buffer_in_complex[i], 1);
+//	//		arm_rfft_fast_f32(&Instance_q15, buffer_out_complex, buffer_in_complex[i], 1);
 //
 //
 ////		arm_cmplx_mag_f32(buffer_in_complex[i], buffer_out_complex, frame_size);
@@ -699,9 +797,7 @@ void fft_q15_test_1khz_fft(const int16_t *input_data, int16_t *data_output, uint
 //	q15_t buffer_in_real[frame_num][frame_size*2];
 //
 //
-//	status = ARM_MATH_SUCCESS;
-//	number_of_bits_to_upscale = get_number_of_bits_to_upscale(frame_size);
-//
+//////
 //	// Copy TI's data arrays to the new FFT working buffers
 //	for (i = 0; i < frame_num; i++){
 //		for (j=0; j<frame_size; j++)
@@ -715,8 +811,7 @@ void fft_q15_test_1khz_fft(const int16_t *input_data, int16_t *data_output, uint
 //		//Compute real FFT using the completed data buffer
 //		const arm_cfft_instance_q15 *Instance_q15SS;
 //		Instance_q15 = &arm_cfft_sR_q15_len128;
-//		status = arm_cfft_init_q15(&Instance_q15, frame_size);
-//		arm_cfft_q15(&Instance_q15, buffer_in_real[i], 0, 1);
+//	//		arm_cfft_q15(&Instance_q15, buffer_in_real[i], 0, 1);
 //
 ////		for (j= 0; j < frame_size * 2; j++)
 ////			buffer_in_real[i][j] <<= number_of_bits_to_upscale;
@@ -724,8 +819,7 @@ void fft_q15_test_1khz_fft(const int16_t *input_data, int16_t *data_output, uint
 //		//Compute inverse real FFT using the data from fft
 //		const arm_cfft_instance_q15 *Instance_q15;
 //		Instance_q15 = &arm_cfft_sR_q15_len128;
-//		status = arm_cfft_init_q15(&Instance_q15, frame_size);
-//		arm_cfft_q15(&Instance_q15, buffer_in_real[i], 1, 1);
+//	//		arm_cfft_q15(&Instance_q15, buffer_in_real[i], 1, 1);
 //
 //
 //
@@ -0,0 +1,233 @@
+/*
+ * mel.c
+ *
+ *  Created on: 17 жовт. 2026 р.
+ *      Author: yabe
+ */
+
+#include "mel.h"
+
+#include <math.h>
+
+
+/* 256 * log2(1 + i / 32), i = 0..32 */
+static const uint16_t log2_table[33] = {
+	  0,  11,  22,  33,  44,  54,  63,  73,  82,  92, 100,
+	109, 118, 126, 134, 142, 150, 157, 165, 172, 179, 186,
+	193, 200, 207, 213, 220, 226, 232, 238, 244, 250, 256
+};
+
+
+/*******************************************************************************
+* Function Name: log2_q8
+***************************************
+* Summary:
+*	Integer log2 in Q8. The integer part is the position of the leading one
+*	(CLZ), the fraction is read from log2_table by the next 5 bits and
+*	linearly interpolated by the 8 bits after them.
+*
+* Parameters:
+*	value	-	number, log2(0) is taken as 0.
+*
+* Return:
+*	256 * log2(value).
+*
+*******************************************************************************/
+static uint16_t log2_q8(uint64_t value){
+	uint32_t high = (uint32_t)(value >> 32);
+	uint32_t exponent, mantissa, index, fraction, zeros;
+
+	if (value == 0)
+		return 0;
+
+	// Normalize so that the leading one is bit 31 of the mantissa.
+	if (high != 0){
+		zeros = __CLZ(high);
+		exponent = 63 - zeros;
+		mantissa = (uint32_t)(value >> (32 - zeros));
+	}
+	else{
+		zeros = __CLZ((uint32_t)value);
+		exponent = 31 - zeros;
+		mantissa = (uint32_t)value << zeros;
+	}
+
+	index = (mantissa >> 26) & 0x1F;
+	fraction = (mantissa >> 18) & 0xFF;
+
+	return (uint16_t)((exponent << 8) + log2_table[index] +
+					  (((log2_table[index + 1] - log2_table[index]) * fraction + 128) >> 8));
+}
+
+
+/*******************************************************************************
+* Function Name: hz_to_mel
+***************************************
+* Summary:
+*	Frequency on the mel scale.
+*
+*******************************************************************************/
+static float hz_to_mel(float hz){
+	return 2595.0f * log10f(1.0f + hz / 700.0f);
+}
+
+
+/*******************************************************************************
+* Function Name: mel_to_hz
+***************************************
+* Summary:
+*	Frequency of a point of the mel scale.
+*
+*******************************************************************************/
+static float mel_to_hz(float mel){
+	return 700.0f * (powf(10.0f, mel / 2595.0f) - 1.0f);
+}
+
+
+/*******************************************************************************
+* Function Name: mel_init
+***************************************
+* Summary:
+*	Compute the sparse triangular filters. Channel c rises from the centre of
+*	channel c - 1 to its own centre and falls to the centre of channel c + 1.
+*	A channel that is narrower than one bin (low channels of a short frame)
+*	gets its nearest bin with the full weight, so no channel is always zero.
+*	If the parameters are incorrect "halt_with_error(...)" is called.
+*
+* Parameters:
+*	*mel			-	filterbank to initialize;
+*	frame_size		-	number of sound bits for FFT;
+*	sample_rate		-	sample rate of the sound, Hz;
+*	channel_num		-	number of channels, 1..MEL_MAX_CHANNELS;
+*	low_freq		-	lower edge of the first channel, Hz;
+*	high_freq		-	upper edge of the last channel, Hz (<= sample_rate / 2);
+*	*weights		-	MEL_WEIGHTS_SIZE(frame_size) values.
+*
+* Return:
+*
+*******************************************************************************/
+void mel_init(struct mel_filterbank *mel, uint16_t frame_size, uint32_t sample_rate,
+			  uint16_t channel_num, float low_freq, float high_freq, q15_t *weights){
+	const float bins_per_hz = (float)frame_size / (float)sample_rate;
+	const float mel_low = hz_to_mel(low_freq);
+	const float mel_step = (hz_to_mel(high_freq) - mel_low) / (channel_num + 1);
+	float left, centre, right, weight;
+	uint16_t c, k, offset = 0;
+
+	if (channel_num == 0 || channel_num > MEL_MAX_CHANNELS ||
+		low_freq < 0.0f || high_freq <= low_freq || high_freq > sample_rate / 2.0f)
+		halt_with_error("\tMel.c -> mel_init() ->"
+						"\n\r\t\t\t-> bad filterbank parameters");
+
+	// Also checks the frame size.
+	get_number_of_bits_to_upscale(frame_size);
+
+	mel->frame_size = frame_size;
+	mel->bin_num = frame_size / 2 + 1;
+	mel->channel_num = channel_num;
+	mel->weights = weights;
+
+	for (c = 0; c < channel_num; c++){
+		// Edges and centre of the triangle as fractional bins.
+		left = mel_to_hz(mel_low + mel_step * c) * bins_per_hz;
+		centre = mel_to_hz(mel_low + mel_step * (c + 1)) * bins_per_hz;
+		right = mel_to_hz(mel_low + mel_step * (c + 2)) * bins_per_hz;
+
+		mel->start[c] = 0;
+		mel->width[c] = 0;
+		mel->offset[c] = offset;
+
+		for (k = (uint16_t)ceilf(left); k < mel->bin_num && k < right; k++){
+			if (k <= centre)
+				weight = (k - left) / (centre - left);
+			else
+				weight = (right - k) / (right - centre);
+
+			q15_t value = (q15_t)(weight * 32767.0f + 0.5f);
+			if (value <= 0){
+				// Only zero weights at the start are skipped, the run is contiguous.
+				if (mel->width[c] == 0)
+					continue;
+				break;
+			}
+
+			if (mel->width[c] == 0)
+				mel->start[c] = k;
+			weights[offset++] = value;
+			mel->width[c]++;
+		}
+
+		if (mel->width[c] == 0){
+			k = (uint16_t)(centre + 0.5f);
+			mel->start[c] = k < mel->bin_num ? k : mel->bin_num - 1;
+			mel->width[c] = 1;
+			weights[offset++] = 0x7FFF;
+		}
+	}
+}
+
+
+/*******************************************************************************
+* Function Name: mel_log_energies
+***************************************
+* Summary:
+*	Log-mel energies of one frame.
+*
+* Parameters:
+*	*mel			-	filterbank;
+*	*magnitude		-	bin_num FFT magnitudes, bins 0 .. frame_size / 2;
+*	*log_energy		-	array into which channel_num values (Q8 log2) will
+*						be recorded.
+*
+*******************************************************************************/
+void mel_log_energies(const struct mel_filterbank *mel, const q15_t *magnitude, q15_t *log_energy){
+	q63_t energy;
+
+	for (uint16_t c = 0; c < mel->channel_num; c++){
+		// Magnitudes and weights are not negative, the sum fits easily in q63.
+		arm_dot_prod_q15((q15_t *)magnitude + mel->start[c], mel->weights + mel->offset[c],
+						 mel->width[c], &energy);
+		log_energy[c] = (q15_t)log2_q8((uint64_t)energy);
+	}
+}
+
+
+/*******************************************************************************
+* Function Name: mel_q15_features
+***************************************
+* Summary:
+*	FFT, magnitude, log-mel and quantization in one pass, the log-mel
+*	counterpart of fft_q15_features().
+*
+* Parameters:
+*	*context		-	FFT context made by fft_context_init() for the same frame
+*						size, frames follow its hop;
+* 	*input_data		-	(frame_num - 1) * hop + frame_size sound bits;
+*	*features		- 	frame_num * channel_num model inputs (the input tensor);
+*	frame_num		-	number FFT frames;
+*	*mel			-	filterbank made by mel_init();
+*	*quant			-	conversion made by fft_quant_init() with MEL_FEATURE_SCALE;
+*	*scratch		-	FFT_Q15_SCRATCH_SIZE(frame_size) values.
+*
+*******************************************************************************/
+void mel_q15_features(const struct fft_context *context, const int16_t *input_data, int8_t *features,
+					  uint16_t frame_num, const struct mel_filterbank *mel, const struct fft_quant *quant,
+					  q15_t *scratch){
+	const uint16_t frame_size = mel->frame_size;
+	uint32_t i;
+
+	// The input frame is not needed after the FFT and the spectrum after
+	// the magnitude, their places are reused.
+	q15_t *magnitude = scratch;
+	q15_t *log_energy = scratch + frame_size;
+
+	if (context->frame_size != frame_size)
+		halt_with_error("\tMel.c -> mel_q15_features() ->"
+						"\n\r\t\t\t-> FFT context and filterbank frame sizes differ");
+
+	for (i=0; i<frame_num; i++){
+		fft_q15_magnitudes(context, input_data + context->hop*i, 0, mel->bin_num, magnitude, scratch);
+		mel_log_energies(mel, magnitude, log_energy);
+		fft_quantize_magnitudes(quant, log_energy, features + mel->channel_num*i, mel->channel_num);
+	}
+}
@@ -0,0 +1,123 @@
+/*
+ * mfcc.c
+ *
+ *  Created on: 17 жовт. 2026 р.
+ *      Author: yabe
+ */
+
+#include "mfcc.h"
+
+#include <math.h>
+
+
+/*******************************************************************************
+* Function Name: mfcc_init
+***************************************
+* Summary:
+*	Compute the DCT-II table:
+*		dct[k][n] = s(k) * cos(PI * k * (n + 0.5) / channel_num),
+*		s(0) = sqrt(1 / channel_num), s(k) = sqrt(2 / channel_num).
+*	If the number of coefficients is incorrect "halt_with_error(...)" is called.
+*
+* Parameters:
+*	*mfcc				-	MFCC to initialize;
+*	*mel				-	filterbank made by mel_init(), must outlive the MFCC;
+*	coefficient_num		-	coefficients per frame, 1..MFCC_MAX_COEFFICIENTS
+*							and not more than the mel channels;
+*	*dct				-	MFCC_DCT_SIZE(coefficient_num, channel_num) values.
+*
+* Return:
+*
+*******************************************************************************/
+void mfcc_init(struct mfcc *mfcc, const struct mel_filterbank *mel, uint16_t coefficient_num, q15_t *dct){
+	const uint16_t channel_num = mel->channel_num;
+	float scale, value;
+
+	if (coefficient_num == 0 || coefficient_num > MFCC_MAX_COEFFICIENTS ||
+		coefficient_num > channel_num)
+		halt_with_error("\tMfcc.c -> mfcc_init() ->"
+						"\n\r\t\t\t-> bad number of coefficients");
+
+	mfcc->mel = mel;
+	mfcc->coefficient_num = coefficient_num;
+	mfcc->dct = dct;
+
+	for (uint16_t k = 0; k < coefficient_num; k++){
+		scale = sqrtf((k == 0 ? 1.0f : 2.0f) / channel_num);
+		for (uint16_t n = 0; n < channel_num; n++){
+			value = scale * cosf(PI * k * (n + 0.5f) / channel_num) * 32768.0f;
+			value = value > 32767.0f ? 32767.0f : value;
+			dct[k * channel_num + n] = (q15_t)(value < 0.0f ? value - 0.5f : value + 0.5f);
+		}
+	}
+}
+
+
+/*******************************************************************************
+* Function Name: mfcc_coefficients
+***************************************
+* Summary:
+*	MFCC of one frame.
+*
+* Parameters:
+*	*mfcc			-	MFCC;
+*	*log_energy		-	channel_num log-mel energies (Q8) of mel_log_energies();
+*	*coefficients	-	array into which coefficient_num values (Q7) will be
+*						recorded.
+*
+*******************************************************************************/
+void mfcc_coefficients(const struct mfcc *mfcc, const q15_t *log_energy, q15_t *coefficients){
+	const uint16_t channel_num = mfcc->mel->channel_num;
+	q63_t sum;
+
+	for (uint16_t k = 0; k < mfcc->coefficient_num; k++){
+		// Q8 * Q15 = Q23, the coefficient is kept in Q7.
+		arm_dot_prod_q15((q15_t *)log_energy, mfcc->dct + k * channel_num, channel_num, &sum);
+		sum >>= 16;
+		coefficients[k] = (q15_t)(sum > 32767 ? 32767 : (sum < -32768 ? -32768 : sum));
+	}
+}
+
+
+/*******************************************************************************
+* Function Name: mfcc_q15_features
+***************************************
+* Summary:
+*	FFT, magnitude, log-mel, DCT and quantization in one pass, the MFCC
+*	counterpart of fft_q15_features().
+*
+* Parameters:
+*	*context		-	FFT context made by fft_context_init() for the same frame
+*						size, frames follow its hop;
+* 	*input_data		-	(frame_num - 1) * hop + frame_size sound bits;
+*	*features		- 	frame_num * coefficient_num model inputs (the input tensor);
+*	frame_num		-	number FFT frames;
+*	*mfcc			-	MFCC made by mfcc_init();
+*	*quant			-	conversion made by fft_quant_init() with MFCC_FEATURE_SCALE;
+*	*scratch		-	FFT_Q15_SCRATCH_SIZE(frame_size) values.
+*
+*******************************************************************************/
+void mfcc_q15_features(const struct fft_context *context, const int16_t *input_data, int8_t *features,
+					   uint16_t frame_num, const struct mfcc *mfcc, const struct fft_quant *quant,
+					   q15_t *scratch){
+	const struct mel_filterbank *mel = mfcc->mel;
+	const uint16_t frame_size = mel->frame_size;
+	uint32_t i;
+
+	// The input frame is not needed after the FFT and the spectrum after
+	// the magnitude, their places are reused.
+	q15_t *magnitude = scratch;
+	q15_t *log_energy = scratch + frame_size;
+	q15_t *coefficients = log_energy + MEL_MAX_CHANNELS;
+
+	if (context->frame_size != frame_size)
+		halt_with_error("\tMfcc.c -> mfcc_q15_features() ->"
+						"\n\r\t\t\t-> FFT context and filterbank frame sizes differ");
+
+	for (i=0; i<frame_num; i++){
+		fft_q15_magnitudes(context, input_data + context->hop*i, 0, mel->bin_num, magnitude, scratch);
+		mel_log_energies(mel, magnitude, log_energy);
+		mfcc_coefficients(mfcc, log_energy, coefficients);
+		fft_quantize_magnitudes(quant, coefficients, features + mfcc->coefficient_num*i, mfcc->coefficient_num);
+	}
+}
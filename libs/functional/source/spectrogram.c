@@ -0,0 +1,287 @@
+/*
+ * spectrogram.c
+ *
+ *  Created on: 17 жовт. 2026 р.
+ *      Author: yabe
+ */
+
+#include "spectrogram.h"
+
+#include <string.h>
+
+
+/*******************************************************************************
+* Function Name: spectrogram_init
+***************************************
+* Summary:
+*	Attach the FFT plan and the store.
+*	If the bins are out of the frame "halt_with_error(...)" is called.
+*
+* Parameters:
+*	*spectrogram	-	extractor to initialize;
+*	*fft			-	FFT context made by fft_context_init(), must outlive
+*						the extractor;
+*	frame_num		-	frames kept in the store;
+*	bin_offset		-	first magnitude of a frame that is kept;
+*	bin_count		-	magnitudes kept per frame;
+*	*quant			-	conversion made by fft_quant_init();
+*	*store			-	frame_num * bin_count values;
+*	*scratch		-	SPECTROGRAM_SCRATCH_SIZE(frame_size) values.
+*
+* Return:
+*
+*******************************************************************************/
+void spectrogram_init(struct spectrogram *spectrogram, const struct fft_context *fft,
+					  uint16_t frame_num, uint16_t bin_offset, uint16_t bin_count,
+					  const struct fft_quant *quant, int8_t *store, q15_t *scratch){
+	if (bin_offset + bin_count > fft->frame_size)
+		halt_with_error("\tSpectrogram.c -> spectrogram_init() ->"
+						"\n\r\t\t\t-> bins out of the frame");
+
+	spectrogram->fft = fft;
+	spectrogram->frame_size = fft->frame_size;
+	spectrogram->hop = fft->hop;
+	spectrogram->bin_offset = bin_offset;
+	spectrogram->bin_count = bin_count;
+	spectrogram->frame_num = frame_num;
+	spectrogram->mode = FEATURE_LINEAR;
+	spectrogram->mel = NULL;
+	spectrogram->mfcc = NULL;
+	spectrogram->vad = NULL;
+	spectrogram->width = bin_count;
+	spectrogram->quant = *quant;
+	spectrogram->store = store;
+	spectrogram->scratch = scratch;
+	spectrogram_reset(spectrogram);
+}
+
+
+/*******************************************************************************
+* Function Name: spectrogram_use_mel
+***************************************
+* Summary:
+*	Store log-mel energies instead of the magnitudes (FEATURE_LOG_MEL).
+*	The store must hold frame_num * channel_num values. Frames stored
+*	before are forgotten. If the filterbank is made for another frame size
+*	"halt_with_error(...)" is called.
+*
+* Parameters:
+*	*spectrogram	-	extractor made by spectrogram_init();
+*	*mel			-	filterbank made by mel_init(), must outlive the extractor;
+*	*quant			-	conversion made by fft_quant_init() with MEL_FEATURE_SCALE.
+*
+* Return:
+*
+*******************************************************************************/
+void spectrogram_use_mel(struct spectrogram *spectrogram, const struct mel_filterbank *mel,
+						 const struct fft_quant *quant){
+	if (mel->frame_size != spectrogram->frame_size)
+		halt_with_error("\tSpectrogram.c -> spectrogram_use_mel() ->"
+						"\n\r\t\t\t-> filterbank of another frame size");
+
+	spectrogram->mode = FEATURE_LOG_MEL;
+	spectrogram->mel = mel;
+	spectrogram->mfcc = NULL;
+	spectrogram->bin_offset = 0;
+	spectrogram->bin_count = mel->bin_num;
+	spectrogram->width = mel->channel_num;
+	spectrogram->quant = *quant;
+	spectrogram_reset(spectrogram);
+}
+
+
+/*******************************************************************************
+* Function Name: spectrogram_use_mfcc
+***************************************
+* Summary:
+*	Store MFCC instead of the magnitudes (FEATURE_MFCC).
+*	The store must hold frame_num * coefficient_num values. Frames stored
+*	before are forgotten.
+*
+* Parameters:
+*	*spectrogram	-	extractor made by spectrogram_init();
+*	*mfcc			-	MFCC made by mfcc_init(), must outlive the extractor;
+*	*quant			-	conversion made by fft_quant_init() with MFCC_FEATURE_SCALE.
+*
+* Return:
+*
+*******************************************************************************/
+void spectrogram_use_mfcc(struct spectrogram *spectrogram, const struct mfcc *mfcc,
+						  const struct fft_quant *quant){
+	spectrogram_use_mel(spectrogram, mfcc->mel, quant);
+	spectrogram->mode = FEATURE_MFCC;
+	spectrogram->mfcc = mfcc;
+	spectrogram->width = mfcc->coefficient_num;
+}
+
+
+/*******************************************************************************
+* Function Name: spectrogram_use_vad
+***************************************
+* Summary:
+*	Check every frame with the gate first. A quiet frame is not transformed,
+*	it is stored as the features of a zero frame: zero magnitude, log2 and
+*	MFCC are 0, so that is the zero point of the model input in every mode.
+*	If the gate is made for another frame size "halt_with_error(...)" is
+*	called.
+*
+* Parameters:
+*	*spectrogram	-	extractor made by spectrogram_init();
+*	*vad			-	gate made by vad_init(), NULL to transform every frame.
+*
+* Return:
+*
+*******************************************************************************/
+void spectrogram_use_vad(struct spectrogram *spectrogram, struct vad *vad){
+	if (vad != NULL && vad->frame_size != spectrogram->frame_size)
+		halt_with_error("\tSpectrogram.c -> spectrogram_use_vad() ->"
+						"\n\r\t\t\t-> gate of another frame size");
+
+	spectrogram->vad = vad;
+}
+
+
+/*******************************************************************************
+* Function Name: spectrogram_reset
+***************************************
+* Summary:
+*	Forget all frames, the plan is kept.
+*
+*******************************************************************************/
+void spectrogram_reset(struct spectrogram *spectrogram){
+	spectrogram->head = 0;
+	spectrogram->frames = 0;
+	spectrogram->offset = 0;
+}
+
+
+/*******************************************************************************
+* Function Name: spectrogram_push_frame
+***************************************
+* Summary:
+*	Transform one frame and put it into the store in place of the oldest.
+*
+*******************************************************************************/
+static void spectrogram_push_frame(struct spectrogram *spectrogram, const int16_t *samples){
+	// The input frame is not needed after the FFT and the spectrum after
+	// the magnitude, their places are reused.
+	q15_t *magnitude = spectrogram->scratch;
+	q15_t *log_energy = spectrogram->scratch + spectrogram->frame_size;
+	q15_t *coefficients = log_energy + MEL_MAX_CHANNELS;
+	int8_t *frame = spectrogram->store + spectrogram->head * spectrogram->width;
+	int32_t zero_point = spectrogram->quant.zero_point;
+
+	if (spectrogram->vad != NULL && !vad_frame(spectrogram->vad, samples)){
+		zero_point = zero_point > 127 ? 127 : (zero_point < -128 ? -128 : zero_point);
+		memset(frame, zero_point, spectrogram->width);
+	}
+	else{
+		// Upscale and magnitude only for the bins that are kept.
+		fft_q15_magnitudes(spectrogram->fft, samples, spectrogram->bin_offset,
+						   spectrogram->bin_count, magnitude, spectrogram->scratch);
+
+		if (spectrogram->mode == FEATURE_LOG_MEL){
+			mel_log_energies(spectrogram->mel, magnitude, log_energy);
+			fft_quantize_magnitudes(&spectrogram->quant, log_energy, frame, spectrogram->width);
+		}
+		else if (spectrogram->mode == FEATURE_MFCC){
+			mel_log_energies(spectrogram->mel, magnitude, log_energy);
+			mfcc_coefficients(spectrogram->mfcc, log_energy, coefficients);
+			fft_quantize_magnitudes(&spectrogram->quant, coefficients, frame, spectrogram->width);
+		}
+		else
+			fft_quantize_magnitudes(&spectrogram->quant, magnitude, frame, spectrogram->width);
+	}
+
+	spectrogram->head = (spectrogram->head + 1) % spectrogram->frame_num;
+	spectrogram->frames++;
+}
+
+
+/*******************************************************************************
+* Function Name: spectrogram_push
+***************************************
+* Summary:
+*	Transform the new frames and put them into the store in place of the
+*	oldest ones. Without a gate the result is bit-exact with
+*	fft_q15_features(), mel_q15_features() or mfcc_q15_features().
+*
+* Parameters:
+*	*spectrogram	-	extractor;
+*	*samples		-	(frame_count - 1) * hop + frame_size sound bits;
+*	frame_count		-	number of new frames.
+*
+* Return:
+*
+*******************************************************************************/
+void spectrogram_push(struct spectrogram *spectrogram, const int16_t *samples, uint16_t frame_count){
+	for (uint16_t i = 0; i < frame_count; i++)
+		spectrogram_push_frame(spectrogram, samples + spectrogram->hop * i);
+}
+
+
+/*******************************************************************************
+* Function Name: spectrogram_push_stream
+***************************************
+* Summary:
+*	Transform every frame that is complete in the capture ring and release
+*	the blocks no later frame needs. Overlapping frames are read in place,
+*	so a block is kept until the last frame that starts in it is done.
+*	If the ring overran, the frames are taken again from the oldest block
+*	left, the lost audio is simply missing from the store.
+*	A frame spans at most two blocks (frame_size <= block_size), so the ring
+*	needs three blocks or more: two held here and one being filled.
+*
+* Parameters:
+*	*spectrogram	-	extractor;
+*	*stream			-	capture ring, only this function may release its blocks.
+*
+* Return:
+*	Number of new frames, 0 if no frame is complete yet.
+*
+*******************************************************************************/
+uint16_t spectrogram_push_stream(struct spectrogram *spectrogram, struct audio_stream *stream){
+	const uint32_t read_count = stream->read_count;
+	const uint32_t samples = audio_stream_available(stream) * stream->block_size;
+	const int16_t *frame;
+	uint16_t frame_count = 0;
+
+	if (stream->read_count != read_count)
+		spectrogram->offset = 0;
+
+	while (spectrogram->offset + spectrogram->frame_size <= samples){
+		// A frame that wraps the ring is gathered in the FFT input buffer.
+		frame = audio_stream_frame(stream, spectrogram->offset, spectrogram->frame_size,
+								   spectrogram->scratch);
+		spectrogram_push_frame(spectrogram, frame);
+		spectrogram->offset += spectrogram->hop;
+		frame_count++;
+	}
+
+	while (spectrogram->offset >= stream->block_size){
+		audio_stream_release(stream);
+		spectrogram->offset -= stream->block_size;
+	}
+
+	return frame_count;
+}
+
+
+/*******************************************************************************
+* Function Name: spectrogram_frame
+***************************************
+* Summary:
+*	Frame of the store by its age.
+*
+* Parameters:
+*	*spectrogram	-	extractor;
+*	age				-	0 is the oldest frame, frame_num - 1 the newest one.
+*
+* Return:
+*	width model inputs.
+*
+*******************************************************************************/
+const int8_t *spectrogram_frame(const struct spectrogram *spectrogram, uint16_t age){
+	return spectrogram->store +
+		   ((spectrogram->head + age) % spectrogram->frame_num) * spectrogram->width;
+}
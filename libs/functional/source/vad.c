@@ -0,0 +1,146 @@
+/*
+ * vad.c
+ *
+ *  Created on: 17 жовт. 2026 р.
+ *      Author: yabe
+ */
+
+#include "vad.h"
+
+
+/*******************************************************************************
+* Function Name: vad_init
+***************************************
+* Summary:
+*	Start the gate with the noise floor at the absolute threshold and all
+*	counters at zero.
+*
+* Parameters:
+*	*vad			-	gate to initialize;
+*	frame_size		-	sound bits per frame, 2 and more;
+*	*config			-	thresholds, e.g. VAD_CONFIG_DEFAULT.
+*
+* Return:
+*
+*******************************************************************************/
+void vad_init(struct vad *vad, uint16_t frame_size, const struct vad_config *config){
+	if (frame_size < 2)
+		halt_with_error("\tVad.c -> vad_init() ->"
+						"\n\r\t\t\t-> bad frame size");
+
+	vad->config = *config;
+	vad->frame_size = frame_size;
+	vad->noise_floor = config->energy_threshold;
+	vad->previous_energy = 0;
+	vad->hangover_left = 0;
+	vad->quiet_frames = UINT32_MAX;
+	vad->frames = 0;
+	vad->active_frames = 0;
+}
+
+
+/*******************************************************************************
+* Function Name: vad_frame
+***************************************
+* Summary:
+*	Check one frame and update the noise floor (by the quiet frames only)
+*	and the counters.
+*
+* Parameters:
+*	*vad			-	gate;
+*	*frame			-	frame_size sound bits.
+*
+* Return:
+*	1 if the frame is active, 0 otherwise.
+*
+*******************************************************************************/
+int vad_frame(struct vad *vad, const int16_t *frame){
+	const struct vad_config *config = &vad->config;
+	const uint16_t frame_size = vad->frame_size;
+	uint32_t energy, level, crossings = 0;
+	q63_t sum;
+	int active;
+
+	// Sum of squares of q15 values, the mean fits uint32.
+	arm_power_q15((q15_t *)frame, frame_size, &sum);
+	energy = (uint32_t)(sum / frame_size);
+
+	for (uint16_t j = 1; j < frame_size; j++)
+		crossings += (frame[j - 1] ^ frame[j]) < 0;
+
+	level = (uint32_t)(((uint64_t)vad->noise_floor * config->noise_ratio) >> 4);
+	if (level < config->energy_threshold)
+		level = config->energy_threshold;
+
+	// Loud or rising, but not hiss.
+	active = (crossings << 8) <= (uint32_t)config->zcr_max * (frame_size - 1) &&
+			 (energy > level ||
+			  (energy > config->energy_threshold &&
+			   ((uint64_t)energy << 4) > (uint64_t)vad->previous_energy * config->flux_ratio));
+
+	if (active)
+		vad->hangover_left = config->hangover;
+	else{
+		// Track the background slowly, speech does not pull it up.
+		vad->noise_floor = vad->noise_floor - (vad->noise_floor >> 4) + (energy >> 4);
+		if (vad->hangover_left > 0){
+			vad->hangover_left--;
+			active = 1;
+		}
+	}
+
+	vad->previous_energy = energy;
+	vad->frames++;
+	if (active){
+		vad->active_frames++;
+		vad->quiet_frames = 0;
+	}
+	else if (vad->quiet_frames != UINT32_MAX)
+		vad->quiet_frames++;
+
+	return active;
+}
+
+
+/*******************************************************************************
+* Function Name: vad_detect
+***************************************
+* Summary:
+*	Check a whole record (the button mode). Stops at the first active frame.
+*
+* Parameters:
+*	*vad			-	gate;
+*	*input_data		-	(frame_num - 1) * hop + frame_size sound bits;
+*	frame_num		-	number of frames;
+*	hop				-	sound bits between the starts of two frames.
+*
+* Return:
+*	1 if some frame is active, 0 otherwise.
+*
+*******************************************************************************/
+int vad_detect(struct vad *vad, const int16_t *input_data, uint16_t frame_num, uint16_t hop){
+	for (uint32_t i = 0; i < frame_num; i++)
+		if (vad_frame(vad, input_data + hop*i))
+			return 1;
+
+	return 0;
+}
+
+
+/*******************************************************************************
+* Function Name: vad_active
+***************************************
+* Summary:
+*	Whether the model has anything to look at.
+*
+* Parameters:
+*	*vad			-	gate;
+*	window_frames	-	frames seen by the model.
+*
+* Return:
+*	1 if one of the last window_frames frames was active, 0 otherwise.
+*
+*******************************************************************************/
+int vad_active(const struct vad *vad, uint16_t window_frames){
+	return vad->quiet_frames < window_frames;
+}
@@ -34,6 +34,7 @@ AllOpsResolver::AllOpsResolver() {
   AddCeil();
   AddConcatenation();
   AddConv2D();
+  AddConv2DMaxPool2D();
   AddCos();
   AddDepthwiseConv2D();
   AddDequantize();
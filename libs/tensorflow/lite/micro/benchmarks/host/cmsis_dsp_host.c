@@ -0,0 +1,49 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// C versions of the CMSIS-DSP functions that the firmware takes from
+// arm_bitreversal2.S (Arm assembly). Each table entry pair holds the offsets
+// (in bytes / 2 of the element pairs, see cmsis_fft_tables.py) of two complex
+// values to swap.
+
+#include "arm_math.h"
+
+void arm_bitreversal_16(uint16_t* pSrc, const uint16_t bitRevLen,
+                        const uint16_t* pBitRevTab) {
+  for (uint32_t i = 0; i < bitRevLen; i += 2) {
+    const uint32_t a = pBitRevTab[i] >> 2;
+    const uint32_t b = pBitRevTab[i + 1] >> 2;
+    uint16_t tmp = pSrc[a];
+    pSrc[a] = pSrc[b];
+    pSrc[b] = tmp;
+    tmp = pSrc[a + 1];
+    pSrc[a + 1] = pSrc[b + 1];
+    pSrc[b + 1] = tmp;
+  }
+}
+
+void arm_bitreversal_32(uint32_t* pSrc, const uint16_t bitRevLen,
+                        const uint16_t* pBitRevTab) {
+  for (uint32_t i = 0; i < bitRevLen; i += 2) {
+    const uint32_t a = pBitRevTab[i] >> 2;
+    const uint32_t b = pBitRevTab[i + 1] >> 2;
+    uint32_t tmp = pSrc[a];
+    pSrc[a] = pSrc[b];
+    pSrc[b] = tmp;
+    tmp = pSrc[a + 1];
+    pSrc[a + 1] = pSrc[b + 1];
+    pSrc[b + 1] = tmp;
+  }
+}
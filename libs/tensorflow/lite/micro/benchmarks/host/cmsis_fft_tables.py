@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+# Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Writes the CMSIS-DSP tables of the q15/q31 real FFT for the host build.
+
+The CMSIS-DSP copy in libs/psoc6pdl has no arm_common_tables.c. The
+benchmark is built with ARM_DSP_CONFIG_TABLES, so it only needs the tables of
+one complex FFT length (half the real FFT length) and the real FFT split
+coefficients. They are computed the way CMSIS-DSP does: the values are
+floor(x * 2^(bits - 1)), clamped to the largest positive value.
+
+Usage: cmsis_fft_tables.py CFFT_LENGTH OUTPUT.c
+"""
+
+import math
+import sys
+
+# Length of the real FFT split tables of CMSIS-DSP, for all lengths.
+REAL_COEF_LENGTH = 8192
+
+
+def fixed(value, bits):
+  top = 1 << (bits - 1)
+  return max(-top, min(top - 1, math.floor(value * top)))
+
+
+def twiddles(length, bits):
+  values = []
+  for i in range(3 * length // 4):
+    angle = 2 * math.pi * i / length
+    values += [fixed(math.cos(angle), bits), fixed(math.sin(angle), bits)]
+  return values
+
+
+def bit_reversal(length):
+  """Swaps of the bit reversal as offsets of the complex values (x8)."""
+  bits = length.bit_length() - 1
+  values = []
+  for i in range(length):
+    j = int(format(i, '0%db' % bits)[::-1], 2)
+    if i < j:
+      values += [i * 8, j * 8]
+  return values
+
+
+def real_coefficients(name, bits):
+  half = REAL_COEF_LENGTH // 2
+  values = []
+  for i in range(half):
+    angle = 2 * math.pi * i / REAL_COEF_LENGTH
+    if name == 'A':
+      x, y = 0.5 * (1 - math.sin(angle)), -0.5 * math.cos(angle)
+    else:
+      x, y = 0.5 * (1 + math.sin(angle)), 0.5 * math.cos(angle)
+    values += [fixed(x, bits), fixed(y, bits)]
+  return values
+
+
+def array(ctype, name, size, values):
+  lines = []
+  for i in range(0, len(values), 12):
+    lines.append('    ' + ', '.join(str(v) for v in values[i:i + 12]) + ',')
+  return 'const %s %s[%s] = {\n%s\n};\n' % (ctype, name, size,
+                                           '\n'.join(lines))
+
+
+def main(argv):
+  if len(argv) != 3:
+    sys.exit(__doc__)
+  length = int(argv[1])
+  # The tables of the radix-4by2 lengths are not plain bit reversals.
+  if length < 16 or length & (length - 1) or (length.bit_length() - 1) % 2:
+    sys.exit('CFFT length %d: only powers of 4 are supported' % length)
+
+  out = [
+      '// Generated by cmsis_fft_tables.py, do not edit.\n',
+      '#include "arm_math.h"\n#include "arm_common_tables.h"\n',
+      array('q15_t', 'twiddleCoef_%d_q15' % length, 3 * length // 2,
+            twiddles(length, 16)),
+      array('q31_t', 'twiddleCoef_%d_q31' % length, 3 * length // 2,
+            twiddles(length, 32)),
+      array('uint16_t', 'armBitRevIndexTable_fixed_%d' % length,
+            'ARMBITREVINDEXTABLE_FIXED_%d_TABLE_LENGTH' % length,
+            bit_reversal(length)),
+      array('q15_t', 'realCoefAQ15', REAL_COEF_LENGTH,
+            real_coefficients('A', 16)),
+      array('q15_t', 'realCoefBQ15', REAL_COEF_LENGTH,
+            real_coefficients('B', 16)),
+      array('q31_t', 'realCoefAQ31', REAL_COEF_LENGTH,
+            real_coefficients('A', 32)),
+      array('q31_t', 'realCoefBQ31', REAL_COEF_LENGTH,
+            real_coefficients('B', 32)),
+  ]
+  with open(argv[2], 'w') as f:
+    f.write('\n'.join(out))
+
+
+if __name__ == '__main__':
+  main(sys.argv)
@@ -0,0 +1,360 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Host (Linux) benchmark of the keyword pipeline: the feature extractors of
+// libs/functional and Invoke() of the bundled models, end to end and per
+// operator. See the Makefile next to this file for the build.
+//
+// One CSV row per measurement on stdout:
+//   suite,name,iterations,ns_per_op,cycles_per_op,arena_bytes
+// ns_per_op is the best of the repeats of `iterations` runs (the least
+// disturbed one), cycles_per_op is ns_per_op at the --mhz reference clock
+// (100 MHz, the CM4 of the kit, by default), so it tracks relative changes
+// of a kernel, not the cycles the board will take. arena_bytes is 0 for the
+// rows that use no arena. Diagnostics go to stderr.
+//
+// Usage: keyword_benchmark [--iterations N] [--repeats N] [--mhz F]
+//                          [--filter SUBSTRING]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "tensorflow/lite/core/api/profiler.h"
+#include "tensorflow/lite/micro/all_ops_resolver.h"
+#include "tensorflow/lite/micro/benchmarks/keyword_scrambled_model_data.h"
+#include "tensorflow/lite/micro/examples/hello_world/model.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+#include "tensorflow/lite/version.h"
+
+extern "C" {
+#include "fft.h"
+#include "mel.h"
+#include "mfcc.h"
+}
+
+namespace {
+
+// The record and the features of main.c.
+constexpr int kSampleRate = 16000;
+constexpr int kRecordSize = 32000;
+constexpr int kFrameSize = 128;
+constexpr int kHopSize = 128;
+constexpr int kFrameNum = (kRecordSize - kFrameSize) / kHopSize + 1;
+constexpr int kMelChannels = 40;
+constexpr float kMelLowFreq = 125.0f;
+constexpr float kMelHighFreq = 7500.0f;
+constexpr int kMfccCoefficients = 13;
+
+constexpr int kTensorArenaSize = 100 * 1024;
+constexpr int kMaxNodes = 64;
+
+struct Options {
+  int iterations = 20;
+  int repeats = 5;
+  double mhz = 100.0;
+  const char* filter = nullptr;
+};
+
+Options options;
+
+double NowNs() {
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void Report(const char* suite, const char* name, int iterations,
+            double ns_per_op, size_t arena_bytes) {
+  printf("%s,%s,%d,%.0f,%.0f,%zu\n", suite, name, iterations, ns_per_op,
+         ns_per_op * options.mhz / 1000.0, arena_bytes);
+}
+
+bool Selected(const char* suite, const char* name) {
+  if (options.filter == nullptr) return true;
+  char full[128];
+  snprintf(full, sizeof(full), "%s/%s", suite, name);
+  return strstr(full, options.filter) != nullptr;
+}
+
+// Best time per run of `run` over the repeats.
+template <typename Run>
+double Measure(Run run) {
+  double best = 0;
+  for (int r = 0; r < options.repeats; r++) {
+    const double start = NowNs();
+    for (int i = 0; i < options.iterations; i++) run();
+    const double ns = (NowNs() - start) / options.iterations;
+    if (r == 0 || ns < best) best = ns;
+  }
+  return best;
+}
+
+// Accumulates the time of every node of Invoke(), the interpreter reports
+// them through ScopedOperatorProfile (builds without NDEBUG only).
+class NodeProfiler : public tflite::Profiler {
+ public:
+  uint32_t BeginEvent(const char* tag, EventType event_type,
+                      int64_t event_metadata1,
+                      int64_t event_metadata2) override {
+    if (event_type != EventType::OPERATOR_INVOKE_EVENT ||
+        event_metadata1 < 0 || event_metadata1 >= kMaxNodes) {
+      return kNoEvent;
+    }
+    const int node = static_cast<int>(event_metadata1);
+    tags_[node] = tag;
+    if (node >= node_count_) node_count_ = node + 1;
+    start_ = NowNs();
+    return static_cast<uint32_t>(node);
+  }
+
+  void EndEvent(uint32_t event_handle) override {
+    if (event_handle == kNoEvent) return;
+    const double ns = NowNs() - start_;
+    if (runs_[event_handle] == 0 || ns < best_[event_handle]) {
+      best_[event_handle] = ns;
+    }
+    runs_[event_handle]++;
+  }
+
+  int node_count() const { return node_count_; }
+  const char* tag(int node) const { return tags_[node]; }
+  double best_ns(int node) const { return best_[node]; }
+  int runs(int node) const { return runs_[node]; }
+
+ private:
+  static constexpr uint32_t kNoEvent = 0xffffffff;
+  const char* tags_[kMaxNodes] = {};
+  double best_[kMaxNodes] = {};
+  int runs_[kMaxNodes] = {};
+  int node_count_ = 0;
+  double start_ = 0;
+};
+
+alignas(16) uint8_t tensor_arena[kTensorArenaSize];
+
+void FillInput(TfLiteTensor* input, int seed) {
+  uint32_t state = 2166136261u + seed;
+  for (size_t i = 0; i < input->bytes; i++) {
+    state = state * 1664525u + 1013904223u;
+    input->data.int8[i] = static_cast<int8_t>(state >> 24);
+  }
+}
+
+void BenchmarkModel(const char* name, const unsigned char* model_data,
+                    tflite::ErrorReporter* error_reporter) {
+  static tflite::AllOpsResolver resolver;
+  const tflite::Model* model = tflite::GetModel(model_data);
+  if (model->version() != TFLITE_SCHEMA_VERSION) {
+    TF_LITE_REPORT_ERROR(error_reporter, "%s: schema version %d not supported",
+                         name, model->version());
+    return;
+  }
+
+  char row[128];
+  snprintf(row, sizeof(row), "%s/invoke", name);
+  if (Selected("model", row)) {
+    tflite::MicroInterpreter interpreter(model, resolver, tensor_arena,
+                                         kTensorArenaSize, error_reporter);
+    if (interpreter.AllocateTensors() != kTfLiteOk) {
+      TF_LITE_REPORT_ERROR(error_reporter, "%s: AllocateTensors() failed",
+                           name);
+      return;
+    }
+    FillInput(interpreter.input(0), 0);
+    // The first invoke and its lazy work are not timed.
+    interpreter.Invoke();
+    // Kernels may reuse the input buffer, it is refilled before every run
+    // so all of them see the same data.
+    const double fill_ns =
+        Measure([&]() { FillInput(interpreter.input(0), 0); });
+    const double ns = Measure([&]() {
+      FillInput(interpreter.input(0), 0);
+      interpreter.Invoke();
+    });
+    Report("model", row, options.iterations, ns - fill_ns,
+           interpreter.arena_used_bytes());
+  }
+
+  snprintf(row, sizeof(row), "%s/op", name);
+  if (Selected("model", row)) {
+    NodeProfiler profiler;
+    tflite::MicroInterpreter interpreter(model, resolver, tensor_arena,
+                                         kTensorArenaSize, error_reporter,
+                                         &profiler);
+    if (interpreter.AllocateTensors() != kTfLiteOk) return;
+    for (int i = 0; i < options.iterations * options.repeats; i++) {
+      FillInput(interpreter.input(0), 0);
+      interpreter.Invoke();
+    }
+    if (profiler.node_count() == 0) {
+      TF_LITE_REPORT_ERROR(error_reporter,
+                           "%s: no per-operator events, build without NDEBUG",
+                           name);
+    }
+    for (int node = 0; node < profiler.node_count(); node++) {
+      if (profiler.runs(node) == 0) continue;
+      snprintf(row, sizeof(row), "%s/op/%d:%s", name, node,
+               profiler.tag(node));
+      Report("model", row, profiler.runs(node), profiler.best_ns(node), 0);
+    }
+  }
+}
+
+// A record of two tones and noise, the same for every run.
+int16_t record[kRecordSize];
+
+void FillRecord() {
+  uint32_t state = 12345u;
+  for (int i = 0; i < kRecordSize; i++) {
+    state = state * 1664525u + 1013904223u;
+    const float t = static_cast<float>(i) / kSampleRate;
+    const float value = 6000.0f * sinf(2.0f * PI * 440.0f * t) +
+                        3000.0f * sinf(2.0f * PI * 2500.0f * t) +
+                        static_cast<float>(static_cast<int32_t>(state) >> 20);
+    record[i] = static_cast<int16_t>(value);
+  }
+}
+
+void BenchmarkFeatures() {
+  static q15_t window[kFrameSize];
+  static q15_t mel_weights[MEL_WEIGHTS_SIZE(kFrameSize)];
+  static q15_t mfcc_dct[MFCC_DCT_SIZE(kMfccCoefficients, kMelChannels)];
+  static q15_t scratch_q15[FFT_Q15_SCRATCH_SIZE(kFrameSize)];
+  static q31_t scratch_q31[FFT_Q31_SCRATCH_SIZE(kFrameSize)];
+  static int16_t magnitude[kFrameNum * kFrameSize];
+  static int8_t features[kFrameNum * kFrameSize / 2];
+
+  struct fft_context fft;
+  struct fft_context fft_hann;
+  struct fft_quant quant;
+  struct fft_quant mel_quant;
+  struct fft_quant mfcc_quant;
+  struct mel_filterbank mel;
+  struct mfcc mfcc;
+
+  // The input scale and zero point of the shipped model.
+  fft_context_init(&fft, kFrameSize, kHopSize, FFT_WINDOW_NONE, nullptr);
+  fft_context_init(&fft_hann, kFrameSize, kHopSize, FFT_WINDOW_HANN, window);
+  fft_quant_init(&quant, FFT_FEATURE_SCALE, 0.354565f, -128);
+  mel_init(&mel, kFrameSize, kSampleRate, kMelChannels, kMelLowFreq,
+           kMelHighFreq, mel_weights);
+  fft_quant_init(&mel_quant, MEL_FEATURE_SCALE, 0.354565f, -128);
+  mfcc_init(&mfcc, &mel, kMfccCoefficients, mfcc_dct);
+  fft_quant_init(&mfcc_quant, MFCC_FEATURE_SCALE, 0.354565f, -128);
+
+  FillRecord();
+
+  if (Selected("features", "fft_q15_magnitudes")) {
+    Report("features", "fft_q15_magnitudes", options.iterations,
+           Measure([&]() {
+             fft_q15_magnitudes(&fft, record, 0, kFrameSize / 2, magnitude,
+                                scratch_q15);
+           }),
+           0);
+  }
+  if (Selected("features", "fft_q15")) {
+    Report("features", "fft_q15", options.iterations, Measure([&]() {
+             fft_q15(&fft, record, magnitude, kFrameNum, scratch_q15);
+           }),
+           0);
+  }
+  if (Selected("features", "fft_q15_hann")) {
+    Report("features", "fft_q15_hann", options.iterations, Measure([&]() {
+             fft_q15(&fft_hann, record, magnitude, kFrameNum, scratch_q15);
+           }),
+           0);
+  }
+  if (Selected("features", "fft_q31")) {
+    Report("features", "fft_q31", options.iterations, Measure([&]() {
+             fft_q31(&fft, record, magnitude, kFrameNum, scratch_q31);
+           }),
+           0);
+  }
+  if (Selected("features", "fft_q15_features")) {
+    Report("features", "fft_q15_features", options.iterations, Measure([&]() {
+             fft_q15_features(&fft, record, features, kFrameNum,
+                              kFrameSize / 2, kFrameSize / 2, &quant,
+                              scratch_q15);
+           }),
+           0);
+  }
+  if (Selected("features", "mel_q15_features")) {
+    Report("features", "mel_q15_features", options.iterations, Measure([&]() {
+             mel_q15_features(&fft, record, features, kFrameNum, &mel,
+                              &mel_quant, scratch_q15);
+           }),
+           0);
+  }
+  if (Selected("features", "mfcc_q15_features")) {
+    Report("features", "mfcc_q15_features", options.iterations,
+           Measure([&]() {
+             mfcc_q15_features(&fft, record, features, kFrameNum, &mfcc,
+                               &mfcc_quant, scratch_q15);
+           }),
+           0);
+  }
+}
+
+bool ParseOptions(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) return false;
+    if (!strcmp(argv[i], "--iterations")) {
+      options.iterations = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--repeats")) {
+      options.repeats = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--mhz")) {
+      options.mhz = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--filter")) {
+      options.filter = argv[++i];
+    } else {
+      return false;
+    }
+  }
+  return options.iterations > 0 && options.repeats > 0 && options.mhz > 0;
+}
+
+}  // namespace
+
+// libs/functional reports fatal errors through halt_with_error(), the board
+// stops there; here the benchmark does.
+extern "C" void halt_with_error(char message[]) {
+  fprintf(stderr, "halt: %s\n", message);
+  exit(1);
+}
+
+extern "C" void DebugLog(const char* s) { fputs(s, stderr); }
+
+int main(int argc, char** argv) {
+  if (!ParseOptions(argc, argv)) {
+    fprintf(stderr,
+            "usage: %s [--iterations N] [--repeats N] [--mhz F] "
+            "[--filter SUBSTRING]\n",
+            argv[0]);
+    return 2;
+  }
+  tflite::MicroErrorReporter micro_error_reporter;
+
+  printf("suite,name,iterations,ns_per_op,cycles_per_op,arena_bytes\n");
+  BenchmarkFeatures();
+  BenchmarkModel("g_model", g_model, &micro_error_reporter);
+  BenchmarkModel("keyword_scrambled", g_keyword_scrambled_model_data,
+                 &micro_error_reporter);
+  return 0;
+}
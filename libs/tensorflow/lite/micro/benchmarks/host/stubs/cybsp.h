@@ -0,0 +1,23 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+// Host stand-in for the ModusToolbox header of the same name, only what the
+// headers of libs/functional used by the benchmark need.
+#ifndef TENSORFLOW_LITE_MICRO_BENCHMARKS_HOST_STUBS_CYBSP_H_
+#define TENSORFLOW_LITE_MICRO_BENCHMARKS_HOST_STUBS_CYBSP_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#endif  // TENSORFLOW_LITE_MICRO_BENCHMARKS_HOST_STUBS_CYBSP_H_
@@ -15,9 +15,13 @@ limitations under the License.
 
 #include "tensorflow/lite/micro/examples/hello_world/main_functions.h"
 
-#include "tensorflow/lite/micro/all_ops_resolver.h"
+#include <math.h>
+#include <string.h>
+
 #include "tensorflow/lite/micro/examples/hello_world/constants.h"
 #include "tensorflow/lite/micro/examples/hello_world/model.h"
+#include "tensorflow/lite/micro/examples/hello_world/model_arena_size.h"
+#include "tensorflow/lite/micro/examples/hello_world/model_op_resolver.h"
 #include "tensorflow/lite/micro/examples/hello_world/output_handler.h"
 #include "tensorflow/lite/micro/micro_error_reporter.h"
 #include "tensorflow/lite/micro/micro_interpreter.h"
@@ -31,17 +35,99 @@ const tflite::Model* model = nullptr;
 tflite::MicroInterpreter* interpreter = nullptr;
 TfLiteTensor* input = nullptr;
 TfLiteTensor* output = nullptr;
+// Argmax-only mode: the input of the final SOFTMAX, see setup_argmax().
+TfLiteTensor* logits = nullptr;
+float softmax_beta = 1.0f;
 int inference_count = 0;
+// Runs the voice activity gate saved, see skip_model().
+int skipped_count = 0;
+// setup() got to the end, the pointers above are set.
+bool setup_done = false;
 
 // Create an area of memory to use for input, output, and intermediate arrays.
-// Minimum arena size, at the time of writing. After allocating tensors
-// you can retrieve this value by invoking interpreter.arena_used_bytes().
-const int kModelArenaSize = 1024 * 50;
-// Extra headroom for model + alignment + future interpreter changes.
-const int kExtraArenaSize = 1024 + 1024*45;
+// kModelArenaSize is the smallest arena of the model, model_arena_size.h is
+// generated from model.cc, regenerate it with
+// `make -C libs/tensorflow/lite/micro/tools/host arena_size` after changing
+// the model. It is measured on a 64-bit host, the persistent data of this
+// target is smaller.
+// Extra headroom for kernel and interpreter changes that do not regenerate
+// the header.
+const int kExtraArenaSize = 1024;
 const int kTensorArenaSize = kModelArenaSize + kExtraArenaSize;
-//const int kTensorArenaSize = 1024;
-uint8_t tensor_arena[kTensorArenaSize];
+// MicroAllocator skips the bytes before the first 16-byte aligned one.
+alignas(16) uint8_t tensor_arena[kTensorArenaSize];
+
+// Always-on mode: the rolling spectrogram itself lives in the feature
+// extractor, here we only count frames to know when to run the model.
+uint16_t window_frames = 0;
+uint16_t window_frame_size = 0;
+uint16_t window_filled = 0;
+uint16_t window_stride = 1;
+uint16_t frames_since_check = 0;
+
+// Converts one FFT magnitude to the model input.
+inline int8_t QuantizeMagnitude(int16_t magnitude) {
+  return int8_t((float)magnitude / 256 - 128);
+}
+
+// A probability in the quantization of the model output, which the skipped
+// SOFTMAX would have written (its tensor keeps its parameters).
+int8_t QuantizeProbability(float probability) {
+  const int32_t value =
+      (int32_t)lroundf(probability / output->params.scale) +
+      output->params.zero_point;
+  return (int8_t)(value < -128 ? -128 : (value > 127 ? 127 : value));
+}
+
+// exp(beta * (logit - best logit)) of class i, softmax without the sum.
+float LogitExp(int i, int best) {
+  const int8_t* values = logits->data.int8;
+  const float scale = softmax_beta * logits->params.scale;
+  return expf(scale * (values[i] - values[best]));
+}
+
+// Sets *best to the best class and returns the sum of LogitExp() over all
+// classes, so that the probability of class i is LogitExp(i, *best) / sum.
+float SumLogitExps(int* best) {
+  const int8_t* values = logits->data.int8;
+  const int count = logits->dims->data[logits->dims->size - 1];
+  *best = 0;
+  for (int i = 1; i < count; i++) {
+    if (values[i] > values[*best]) *best = i;
+  }
+  float sum = 0.0f;
+  for (int i = 0; i < count; i++) {
+    sum += LogitExp(i, *best);
+  }
+  return sum;
+}
+
+// Best class and its probability from the logits: the softmax is only
+// needed for the best class, p = 1 / sum(exp(beta * (logit - best logit))).
+void ScoreLogits(struct model_score* score) {
+  int best;
+  const float sum = SumLogitExps(&best);
+  score->best = best;
+  score->probability = QuantizeProbability(1.0f / sum);
+}
+
+// Runs the model on the current input tensor and scores the output.
+bool RunInference(struct model_score* score) {
+  TfLiteStatus invoke_status = interpreter->Invoke();
+  if (invoke_status != kTfLiteOk) {
+    TF_LITE_REPORT_ERROR(error_reporter, "Invoke failed");
+    return false;
+  }
+
+  if (logits != nullptr) {
+    ScoreLogits(score);
+  } else {
+    score_answer(output->data.int8, output->dims->data[output->dims->size - 1],
+                 score);
+  }
+  inference_count++;
+  return true;
+}
 }  // namespace
 
 void setup(uint16_t SliceCount, uint16_t SliceSize) {
@@ -50,6 +136,7 @@ void setup(uint16_t SliceCount, uint16_t SliceSize) {
   // NOLINTNEXTLINE(runtime-global-variables)
   static tflite::MicroErrorReporter micro_error_reporter;
   error_reporter = &micro_error_reporter;
+  setup_done = false;
 
   // Map the model into a usable data structure. This doesn't involve any
   // copying or parsing, it's a very lightweight operation.
@@ -62,9 +149,12 @@ void setup(uint16_t SliceCount, uint16_t SliceSize) {
     return;
   }
 
-  // This pulls in all the operation implementations we need.
+  // This pulls in only the operation implementations the model uses.
+  // model_op_resolver.h is generated from model.cc, regenerate it with
+  // `make -C libs/tensorflow/lite/micro/tools/host op_resolver` after
+  // changing the model.
   // NOLINTNEXTLINE(runtime-global-variables)
-  static tflite::AllOpsResolver resolver;
+  static tflite::ModelOpResolver resolver(error_reporter);
 
   // Build an interpreter to run the model with.
   static tflite::MicroInterpreter static_interpreter(
@@ -101,9 +191,95 @@ void setup(uint16_t SliceCount, uint16_t SliceSize) {
 //	                             "Bad model_input_buffer pointer");
 
   output = interpreter->output(0);
+  logits = nullptr;
+
+  window_frames = SliceCount;
+  window_frame_size = SliceSize;
+  window_filled = 0;
+  frames_since_check = 0;
 
   // Keep track of how many inferences we have performed.
   inference_count = 0;
+  skipped_count = 0;
+  setup_done = true;
+}
+
+/******************************************************************************
+ * 	Function name: setup_argmax
+ **************************************
+ *	Summary:
+ * 		Argmax-only mode, call after setup(). The decision only needs the
+ * 		best class and its probability, so the final SOFTMAX of the model is
+ * 		not run and run_model() and push_frames() score the logits instead.
+ * 		check() computes its answer from the logits in this mode.
+ *
+ * 	Return:
+ *		1 if the model ends with a SOFTMAX and the mode is on, 0 otherwise
+ *		(also if setup() failed).
+ *
+ */
+int setup_argmax(void) {
+  if (!setup_done) return 0;
+  // nullptr unless the model ends with a SOFTMAX over int8 logits.
+  logits = interpreter->SkipOutputSoftmax(0, &softmax_beta);
+  return logits != nullptr ? 1 : 0;
+}
+
+/******************************************************************************
+ * 	Function name: model_input
+ **************************************
+ *	Summary:
+ * 		Gives the model input tensor to the feature extractor, so that the
+ * 		features are written there directly (see fft_quant_init()).
+ *
+ * 	Parameters:
+ *		*scale		-	set to the scale of the input tensor, may be NULL;
+ *		*zero_point	-	set to the zero point of the input tensor, may be NULL.
+ *
+ * 	Return:
+ *		SliceCount * SliceSize int8 inputs of the model.
+ *
+ */
+int8_t *model_input(float *scale, int32_t *zero_point) {
+  if (scale != nullptr) *scale = input->params.scale;
+  if (zero_point != nullptr) *zero_point = input->params.zero_point;
+  return input->data.int8;
+}
+
+/******************************************************************************
+ * 	Function name: run_model
+ **************************************
+ *	Summary:
+ * 		Runs the model on the input filled through model_input().
+ *
+ * 	Parameters:
+ *		*score		-	best class of the model output.
+ *
+ * 	Return:
+ *		1 if the model ran, 0 otherwise.
+ *
+ */
+int run_model(struct model_score *score) {
+  return RunInference(score) ? 1 : 0;
+}
+
+/******************************************************************************
+ * 	Function name: setup_stream
+ **************************************
+ *	Summary:
+ * 		Sets how often push_frames() runs the model in the always-on mode.
+ *
+ * 	Parameters:
+ *		stride	-	number of new frames between two inferences. Detection
+ *					latency is one stride, the cost is one Invoke() per stride.
+ *
+ * 	Return:
+ *
+ */
+void setup_stream(uint16_t stride) {
+  window_stride = stride > 0 ? stride : 1;
+  window_filled = 0;
+  frames_since_check = 0;
 }
 
 #include "cy_pdl.h"
@@ -121,6 +297,10 @@ void setup(uint16_t SliceCount, uint16_t SliceSize) {
  *		frame_num	-	number FFT frames
  *		frame_size	-	number of sound bits for FFT.
  *		*answer		-	2D array indicates the probability: [0] - Tak, [1] - Ni.
+ *						In argmax mode (setup_argmax()) the SOFTMAX does not
+ *						run, the probabilities are computed from the logits
+ *						then and may differ from the kernel's by 1 LSB.
+ *						Unchanged if the model did not run.
  *
  * 	Return:
  *
@@ -137,7 +317,7 @@ void check(const int16_t *data, uint16_t frame_num, uint16_t frame_size, int8_t
   for (int i=0; i<frame_num; i++){
     t_pos = pos;
     for (int j=frame_size/2; j<frame_size; j++){
-      temp = int8_t((float) data[t_pos]/256 - 128);
+      temp = QuantizeMagnitude(data[t_pos]);
       //printf("%d ", temp);
       input->data.int8[data_pos] = temp;
       t_pos++;
@@ -148,20 +328,140 @@ void check(const int16_t *data, uint16_t frame_num, uint16_t frame_size, int8_t
 
   printf("\n\r");
   // Run inference, and report any error
-  TfLiteStatus invoke_status = interpreter->Invoke();
-  if (invoke_status != kTfLiteOk) {
-    TF_LITE_REPORT_ERROR(error_reporter, "Invoke failed on x_val: %f\n");
-    return;
+  struct model_score score;
+  if (!RunInference(&score)) return;
+  if (logits != nullptr) {
+    int best;
+    const float sum = SumLogitExps(&best);
+    for (int i = 0; i < words_count; i++) {
+      answer[i] = QuantizeProbability(LogitExp(i, best) / sum);
+    }
+  } else {
+    for (int i = 0; i < words_count; i++) {
+      answer[i] = output->data.int8[i];
+    }
   }
 
-  // Read the predicted y value from the model's output tensor
-  //printf("%d\n", output->data.int8[0]);
-  //printf("%d\n", output->data.int8[1]);
-  for (size_t i = 0; i < words_count; i++) {
-	answer[i] = output->data.int8[i];
-  }
-	
   // Output the results. A custom HandleOutput function can be implemented
   // for each supported hardware target.
   // HandleOutput(error_reporter, x_val, y_val);
 }
+
+/******************************************************************************
+ * 	Function name: push_frames
+ **************************************
+ *	Summary:
+ * 		Always-on mode. Called after new frames were added to the rolling
+ * 		spectrogram. Runs the model once every stride frames (see
+ * 		setup_stream()) as soon as the window has been filled for the first
+ * 		time.
+ *
+ * 	Parameters:
+ *		*store		-	circular spectrogram, SliceCount frames of SliceSize
+ *						quantized model inputs (struct spectrogram);
+ *		oldest		-	slot of the oldest frame in the store;
+ *		new_frames	-	number of frames added since the previous call;
+ *		speech		-	0 if the voice activity gate found nothing in the
+ *						window (vad_active()), the run is skipped then;
+ *		*score		-	best class of the model output, updated only if the
+ *						model ran.
+ *
+ * 	Return:
+ *		1 if the model ran and score holds a new prediction, -1 if the run
+ *		was due but skipped as silence, 0 otherwise.
+ *
+ */
+int push_frames(const int8_t *store, uint16_t oldest, uint16_t new_frames, int speech,
+                struct model_score *score){
+  window_filled = window_filled + new_frames < window_frames ?
+                  window_filled + new_frames : window_frames;
+  frames_since_check += new_frames;
+
+  if (window_filled < window_frames || frames_since_check < window_stride)
+    return 0;
+  frames_since_check = 0;
+
+  if (!speech) {
+    skip_model();
+    return -1;
+  }
+
+  // Unroll the ring into the input tensor, oldest frame first. The frames
+  // are already quantized, so this is two block copies.
+  const size_t frame_bytes = window_frame_size;
+  const size_t tail = (window_frames - oldest) * frame_bytes;
+  memcpy(input->data.int8, store + oldest * frame_bytes, tail);
+  memcpy(input->data.int8 + tail, store, oldest * frame_bytes);
+
+  return RunInference(score) ? 1 : 0;
+}
+
+/******************************************************************************
+ * 	Function name: score_answer
+ **************************************
+ *	Summary:
+ * 		Best class of a softmax output, e.g. of check().
+ *
+ * 	Parameters:
+ *		*answer		-	model output, words_count values;
+ *		*score		-	set to the first class with the highest probability.
+ *
+ */
+void score_answer(const int8_t *answer, int words_count, struct model_score *score) {
+  int best = 0;
+  for (int i = 1; i < words_count; i++) {
+    if (answer[i] > answer[best]) best = i;
+  }
+  score->best = best;
+  score->probability = answer[best];
+}
+
+/******************************************************************************
+ * 	Function name: score_word
+ **************************************
+ *	Summary:
+ * 		The word decision: the best class if its probability is above
+ * 		SCORE_WORD_MIN, silence if it is below SCORE_SILENCE_MAX (then all
+ * 		classes are).
+ *
+ * 	Parameters:
+ *		*score		-	result of run_model(), push_frames() or score_answer().
+ *
+ * 	Return:
+ *		The class, SCORE_SILENCE or SCORE_UNKNOWN.
+ *
+ */
+int score_word(const struct model_score *score) {
+  if (score->probability > SCORE_WORD_MIN) return score->best;
+  if (score->probability < SCORE_SILENCE_MAX) return SCORE_SILENCE;
+  return SCORE_UNKNOWN;
+}
+
+/******************************************************************************
+ * 	Function name: skip_model
+ **************************************
+ *	Summary:
+ * 		Counts a run of the model that was not needed (silence), see
+ * 		model_counters().
+ *
+ */
+void skip_model(void) {
+  skipped_count++;
+}
+
+/******************************************************************************
+ * 	Function name: model_counters
+ **************************************
+ *	Summary:
+ * 		How often the model ran and how often the voice activity gate saved
+ * 		a run since setup().
+ *
+ * 	Parameters:
+ *		*runs		-	set to the number of Invoke() calls, may be NULL;
+ *		*skipped	-	set to the number of skipped runs, may be NULL.
+ *
+ */
+void model_counters(uint32_t *runs, uint32_t *skipped) {
+  if (runs != nullptr) *runs = inference_count;
+  if (skipped != nullptr) *skipped = skipped_count;
+}
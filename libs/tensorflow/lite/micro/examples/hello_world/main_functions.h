@@ -26,8 +26,33 @@ limitations under the License.
 extern "C" {
 #endif
 
+// One model run reduced to what the word decision needs, see score_word().
+struct model_score {
+  int best;            // class with the highest probability
+  int8_t probability;  // its probability in the quantization of the
+                       // softmax output, p * 256 - 128 for int8
+};
+
+// The best class is the word if its probability is above 0.75.
+#define SCORE_WORD_MIN 64
+// Every class is below 0.375 if the best one is: silence.
+#define SCORE_SILENCE_MAX (-32)
+// score_word() results other than a class.
+#define SCORE_UNKNOWN (-1)
+#define SCORE_SILENCE (-2)
+
 void setup(uint16_t SliceCount, uint16_t SliceSize);
+int setup_argmax(void);
 void check(const int16_t *data, uint16_t frame_num, uint16_t frame_size, int8_t *answer, int words_count);
+int8_t *model_input(float *scale, int32_t *zero_point);
+int run_model(struct model_score *score);
+void setup_stream(uint16_t stride);
+int push_frames(const int8_t *store, uint16_t oldest, uint16_t new_frames, int speech,
+                struct model_score *score);
+void score_answer(const int8_t *answer, int words_count, struct model_score *score);
+int score_word(const struct model_score *score);
+void skip_model(void);
+void model_counters(uint32_t *runs, uint32_t *skipped);
 
 #ifdef __cplusplus
 }
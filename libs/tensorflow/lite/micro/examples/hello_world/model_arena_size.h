@@ -0,0 +1,14 @@
+// Generated by tensorflow/lite/micro/tools/host/generate_arena_size from
+// model.cc, do not edit.
+
+#ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_HELLO_WORLD_MODEL_ARENA_SIZE_H_
+#define TENSORFLOW_LITE_MICRO_EXAMPLES_HELLO_WORLD_MODEL_ARENA_SIZE_H_
+
+// The smallest tensor arena the setup of model.cc succeeds in, on a
+// 64-bit host: 19984 bytes of head (planned tensors and scratch
+// buffers), 2616 bytes of tail (persistent data) and 0 bytes the
+// planner works in during AllocateTensors(). The tail is smaller on the
+// 32-bit target, so this is an upper bound there.
+constexpr int kModelArenaSize = 22600;
+
+#endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_HELLO_WORLD_MODEL_ARENA_SIZE_H_
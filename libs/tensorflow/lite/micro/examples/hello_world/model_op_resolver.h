@@ -0,0 +1,33 @@
+// Generated by tensorflow/lite/micro/tools/host/generate_op_resolver from
+// model.cc, do not edit.
+
+#ifndef TENSORFLOW_LITE_MICRO_EXAMPLES_HELLO_WORLD_MODEL_OP_RESOLVER_H_
+#define TENSORFLOW_LITE_MICRO_EXAMPLES_HELLO_WORLD_MODEL_OP_RESOLVER_H_
+
+#include "tensorflow/lite/core/api/error_reporter.h"
+#include "tensorflow/lite/micro/compatibility.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+
+namespace tflite {
+
+// The 7 ops of model.cc.
+class ModelOpResolver : public MicroMutableOpResolver<7> {
+ public:
+  explicit ModelOpResolver(ErrorReporter* error_reporter = nullptr)
+      : MicroMutableOpResolver<7>(error_reporter) {
+    AddConv2D();
+    AddFullyConnected();
+    AddMaxPool2D();
+    AddRelu();
+    AddReshape();
+    AddSoftmax();
+    AddConv2DMaxPool2D();
+  }
+
+ private:
+  TF_LITE_REMOVE_VIRTUAL_DELETE
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_MICRO_EXAMPLES_HELLO_WORLD_MODEL_OP_RESOLVER_H_
@@ -18,11 +18,16 @@ limitations under the License.
 
 #include <algorithm>
 #include <cmath>
+#include <limits>
 
 #include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/kernels/internal/common.h"
 #include "tensorflow/lite/kernels/internal/cppmath.h"
 #include "tensorflow/lite/kernels/internal/max.h"
 #include "tensorflow/lite/kernels/internal/min.h"
+#include "tensorflow/lite/kernels/internal/quantization_util.h"
+#include "tensorflow/lite/kernels/internal/types.h"
 
 namespace tflite {
 namespace ops {
@@ -50,6 +55,47 @@ inline float ActivationValFloat(TfLiteFusedActivation act, float a) {
                 // activation is added to the enum and not handled here).
 }
 
+// Computes the parameters of a quantized RELU from input to output, shared
+// by the RELU kernel and the kernels RELU is fused into.
+template <typename T>
+inline void CalculateReluParams(const TfLiteTensor* input,
+                                const TfLiteTensor* output,
+                                ReluParams* params) {
+  float act_min = 0.0;
+  float act_max = std::numeric_limits<float>::infinity();
+  double real_multiplier =
+      static_cast<double>(input->params.scale / output->params.scale);
+
+  QuantizeMultiplier(real_multiplier, &params->output_multiplier,
+                     &params->output_shift);
+
+  params->quantized_activation_min = std::max(
+      static_cast<int32_t>(std::numeric_limits<T>::min()),
+      output->params.zero_point +
+          static_cast<int32_t>(roundf(act_min / output->params.scale)));
+  params->quantized_activation_max =
+      act_max == std::numeric_limits<float>::infinity()
+          ? static_cast<int32_t>(std::numeric_limits<T>::max())
+          : std::min(static_cast<int32_t>(std::numeric_limits<T>::max()),
+                     output->params.zero_point +
+                         static_cast<int32_t>(
+                             roundf(act_max / output->params.scale)));
+  params->input_offset = input->params.zero_point;
+  params->output_offset = output->params.zero_point;
+}
+
+// Quantized RELU of a single value.
+inline int32_t ReluQuantizedValue(const ReluParams& params, int32_t val) {
+  int32_t clamped =
+      params.output_offset +
+      MultiplyByQuantizedMultiplier(val - params.input_offset,
+                                    params.output_multiplier,
+                                    params.output_shift);
+  clamped = std::max(params.quantized_activation_min, clamped);
+  clamped = std::min(params.quantized_activation_max, clamped);
+  return clamped;
+}
+
 }  // namespace micro
 }  // namespace ops
 }  // namespace tflite
@@ -23,7 +23,9 @@ limitations under the License.
 #include "tensorflow/lite/kernels/internal/tensor_ctypes.h"
 #include "tensorflow/lite/kernels/kernel_util.h"
 #include "tensorflow/lite/kernels/padding.h"
+#include "tensorflow/lite/micro/kernels/activation_utils.h"
 #include "tensorflow/lite/micro/kernels/kernel_util.h"
+#include "tensorflow/lite/micro/micro_graph_fusion.h"
 
 namespace tflite {
 namespace ops {
@@ -62,6 +64,16 @@ struct OpData {
   // uint8_t these would be 0 and 255.
   int32_t output_activation_min;
   int32_t output_activation_max;
+
+  // int8 with constant weights where every output reads all filter taps,
+  // nullptr otherwise: per output channel part of the accumulator that does
+  // not depend on the input, see FoldInputOffsetIntoBias().
+  // EvalQuantizedPerChannelFolded() runs instead of the reference kernel.
+  int32_t* folded_bias;
+
+  // Also int8 3x3 filter over a single input channel with stride 1 and no
+  // dilation: runs EvalConv3x3SingleChannel().
+  bool single_channel_3x3;
 };
 
 inline PaddingType RuntimePaddingType(TfLitePadding padding) {
@@ -80,7 +92,8 @@ TfLiteStatus CalculateOpData(TfLiteContext* context, TfLiteNode* node,
                              const TfLiteConvParams* params, int width,
                              int height, int filter_width, int filter_height,
                              int out_width, int out_height,
-                             const TfLiteType data_type, OpData* data) {
+                             const TfLiteType data_type, TfLiteTensor* output,
+                             OpData* data) {
   bool has_bias = node->inputs->size == 3;
   // Check number of inputs/outputs
   TF_LITE_ENSURE(context, has_bias || node->inputs->size == 2);
@@ -100,7 +113,6 @@ TfLiteStatus CalculateOpData(TfLiteContext* context, TfLiteNode* node,
     const TfLiteTensor* filter = GetInput(context, node, kFilterTensor);
     const TfLiteTensor* bias =
         GetOptionalInputTensor(context, node, kBiasTensor);
-    TfLiteTensor* output = GetOutput(context, node, kOutputTensor);
     int output_channels = filter->dims->data[kConvQuantizedDimension];
 
     TF_LITE_ENSURE_STATUS(tflite::PopulateConvolutionQuantizationParams(
@@ -119,14 +131,11 @@ void* Init(TfLiteContext* context, const char* buffer, size_t length) {
   return context->AllocatePersistentBuffer(context, sizeof(OpData));
 }
 
-TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
-  TFLITE_DCHECK(node->user_data != nullptr);
-  TFLITE_DCHECK(node->builtin_data != nullptr);
-
-  OpData* data = static_cast<OpData*>(node->user_data);
-  const auto params = static_cast<const TfLiteConvParams*>(node->builtin_data);
-
-  TfLiteTensor* output = GetOutput(context, node, kOutputTensor);
+// Prepare() with the convolution output given, the fused CONV_2D +
+// MAX_POOL_2D kernel passes the tensor it does not write.
+TfLiteStatus PrepareOpData(TfLiteContext* context, TfLiteNode* node,
+                           const TfLiteConvParams* params, TfLiteTensor* output,
+                           OpData* data) {
   const TfLiteTensor* input = GetInput(context, node, kInputTensor);
   const TfLiteTensor* filter = GetInput(context, node, kFilterTensor);
 
@@ -167,14 +176,49 @@ TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
 
   TF_LITE_ENSURE_STATUS(CalculateOpData(
       context, node, params, input_width, input_height, filter_width,
-      filter_height, output_width, output_height, input->type, data));
+      filter_height, output_width, output_height, input->type, output, data));
 
   data->input_zero_point = input->params.zero_point;
   data->filter_zero_point = filter->params.zero_point;
   data->output_zero_point = output->params.zero_point;
 
+  const TfLiteTensor* bias = GetOptionalInputTensor(context, node, kBiasTensor);
+  data->folded_bias = nullptr;
+  if (input->type == kTfLiteInt8 &&
+      tflite::micro::CanFoldInputOffset(filter, bias) &&
+      tflite::micro::ConvWindowsInside(
+          input_width, filter_width, params->stride_width,
+          params->dilation_width_factor, data->padding.width, output_width) &&
+      tflite::micro::ConvWindowsInside(
+          input_height, filter_height, params->stride_height,
+          params->dilation_height_factor, data->padding.height,
+          output_height)) {
+    // Per-channel int8 weights are symmetric, the filter offset is not used.
+    TF_LITE_ENSURE_STATUS(tflite::micro::FoldInputOffsetIntoBias(
+        context, filter, bias, kConvQuantizedDimension,
+        -data->input_zero_point, 0, &data->folded_bias));
+  }
+
+  data->single_channel_3x3 =
+      data->folded_bias != nullptr && input->dims->data[3] == 1 &&
+      filter_width == 3 && filter_height == 3 && params->stride_width == 1 &&
+      params->stride_height == 1 && params->dilation_width_factor == 1 &&
+      params->dilation_height_factor == 1 && output_width == input_width - 2 &&
+      output_height == input_height - 2;
+
   return kTfLiteOk;
-}  // namespace conv
+}
+
+TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
+  TFLITE_DCHECK(node->user_data != nullptr);
+  TFLITE_DCHECK(node->builtin_data != nullptr);
+
+  OpData* data = static_cast<OpData*>(node->user_data);
+  const auto params = static_cast<const TfLiteConvParams*>(node->builtin_data);
+  TfLiteTensor* output = GetOutput(context, node, kOutputTensor);
+
+  return PrepareOpData(context, node, params, output, data);
+}
 
 void EvalQuantized(TfLiteContext* context, TfLiteNode* node,
                    TfLiteConvParams* params, const OpData& data,
@@ -246,6 +290,160 @@ void EvalQuantizedPerChannel(TfLiteContext* context, TfLiteNode* node,
       tflite::micro::GetTensorData<int8_t>(output));
 }
 
+// Same result as reference_integer_ops::ConvPerChannel() when
+// OpData::folded_bias is set: no bounds checks and no input offset, the
+// inner loop is a plain int8 dot product.
+void EvalQuantizedPerChannelFolded(TfLiteConvParams* params,
+                                   const OpData& data,
+                                   const TfLiteEvalTensor* input,
+                                   const TfLiteEvalTensor* filter,
+                                   TfLiteEvalTensor* output) {
+  const RuntimeShape input_shape = tflite::micro::GetTensorShape(input);
+  const RuntimeShape filter_shape = tflite::micro::GetTensorShape(filter);
+  const RuntimeShape output_shape = tflite::micro::GetTensorShape(output);
+  const int8_t* input_data = tflite::micro::GetTensorData<int8_t>(input);
+  const int8_t* filter_data = tflite::micro::GetTensorData<int8_t>(filter);
+  int8_t* output_data = tflite::micro::GetTensorData<int8_t>(output);
+
+  const int stride_width = params->stride_width;
+  const int stride_height = params->stride_height;
+  const int dilation_width_factor = params->dilation_width_factor;
+  const int dilation_height_factor = params->dilation_height_factor;
+  const int32_t output_offset = data.output_zero_point;
+  const int32_t output_activation_min = data.output_activation_min;
+  const int32_t output_activation_max = data.output_activation_max;
+
+  const int batches = MatchingDim(input_shape, 0, output_shape, 0);
+  const int input_depth = MatchingDim(input_shape, 3, filter_shape, 3);
+  const int output_depth = MatchingDim(filter_shape, 0, output_shape, 3);
+  const int input_height = input_shape.Dims(1);
+  const int input_width = input_shape.Dims(2);
+  const int filter_height = filter_shape.Dims(1);
+  const int filter_width = filter_shape.Dims(2);
+  const int output_height = output_shape.Dims(1);
+  const int output_width = output_shape.Dims(2);
+  const int input_row_size = input_width * input_depth;
+  const int filter_size = filter_height * filter_width * input_depth;
+
+  for (int batch = 0; batch < batches; ++batch) {
+    const int8_t* batch_input =
+        input_data + batch * input_height * input_row_size;
+    for (int out_y = 0; out_y < output_height; ++out_y) {
+      for (int out_x = 0; out_x < output_width; ++out_x) {
+        const int8_t* window = batch_input +
+                               out_y * stride_height * input_row_size +
+                               out_x * stride_width * input_depth;
+        for (int out_channel = 0; out_channel < output_depth; ++out_channel) {
+          const int8_t* w = filter_data + out_channel * filter_size;
+          int32_t acc = data.folded_bias[out_channel];
+          for (int filter_y = 0; filter_y < filter_height; ++filter_y) {
+            for (int filter_x = 0; filter_x < filter_width; ++filter_x) {
+              const int8_t* in = window +
+                                 dilation_height_factor * filter_y *
+                                     input_row_size +
+                                 dilation_width_factor * filter_x * input_depth;
+              for (int in_channel = 0; in_channel < input_depth; ++in_channel) {
+                acc += *w++ * in[in_channel];
+              }
+            }
+          }
+
+          acc = MultiplyByQuantizedMultiplier(
+              acc, data.per_channel_output_multiplier[out_channel],
+              data.per_channel_output_shift[out_channel]);
+          acc += output_offset;
+          acc = std::max(acc, output_activation_min);
+          acc = std::min(acc, output_activation_max);
+          output_data[Offset(output_shape, batch, out_y, out_x, out_channel)] =
+              static_cast<int8_t>(acc);
+        }
+      }
+    }
+  }
+}
+
+// Same result as reference_integer_ops::ConvPerChannel() for the shapes of
+// OpData::single_channel_3x3 (the first layer of the keyword model): no
+// bounds checks, the nine filter taps are kept in registers and the input
+// zero point comes from OpData::folded_bias, so the inner loop is nine
+// multiply-accumulates over a 3x3 window that slides along the rows,
+// loading only its three new input values per output.
+void EvalConv3x3SingleChannel(const OpData& data,
+                              const TfLiteEvalTensor* input,
+                              const TfLiteEvalTensor* filter,
+                              TfLiteEvalTensor* output) {
+  const RuntimeShape input_shape = tflite::micro::GetTensorShape(input);
+  const RuntimeShape output_shape = tflite::micro::GetTensorShape(output);
+  const int8_t* input_data = tflite::micro::GetTensorData<int8_t>(input);
+  const int8_t* filter_data = tflite::micro::GetTensorData<int8_t>(filter);
+  int8_t* output_data = tflite::micro::GetTensorData<int8_t>(output);
+
+  const int batches = MatchingDim(input_shape, 0, output_shape, 0);
+  const int input_width = input_shape.Dims(2);
+  const int input_height = input_shape.Dims(1);
+  const int output_width = output_shape.Dims(2);
+  const int output_height = output_shape.Dims(1);
+  const int output_depth = output_shape.Dims(3);
+  const int32_t output_offset = data.output_zero_point;
+  const int32_t output_activation_min = data.output_activation_min;
+  const int32_t output_activation_max = data.output_activation_max;
+
+  for (int out_channel = 0; out_channel < output_depth; ++out_channel) {
+    const int8_t* w = filter_data + out_channel * 9;
+    const int32_t w0 = w[0], w1 = w[1], w2 = w[2];
+    const int32_t w3 = w[3], w4 = w[4], w5 = w[5];
+    const int32_t w6 = w[6], w7 = w[7], w8 = w[8];
+    const int32_t multiplier = data.per_channel_output_multiplier[out_channel];
+    const int32_t shift = data.per_channel_output_shift[out_channel];
+    const int32_t folded_bias = data.folded_bias[out_channel];
+
+    for (int batch = 0; batch < batches; ++batch) {
+      const int8_t* batch_input =
+          input_data + batch * input_height * input_width;
+      int8_t* batch_output = output_data +
+                             batch * output_height * output_width *
+                                 output_depth +
+                             out_channel;
+
+      for (int out_y = 0; out_y < output_height; ++out_y) {
+        const int8_t* row0 = batch_input + out_y * input_width;
+        const int8_t* row1 = row0 + input_width;
+        const int8_t* row2 = row1 + input_width;
+        int8_t* out = batch_output + out_y * output_width * output_depth;
+
+        // Left two columns of the window.
+        int32_t a0 = row0[0], a1 = row0[1];
+        int32_t b0 = row1[0], b1 = row1[1];
+        int32_t c0 = row2[0], c1 = row2[1];
+
+        for (int out_x = 0; out_x < output_width; ++out_x) {
+          const int32_t a2 = row0[out_x + 2];
+          const int32_t b2 = row1[out_x + 2];
+          const int32_t c2 = row2[out_x + 2];
+
+          int32_t acc = folded_bias;
+          acc += w0 * a0 + w1 * a1 + w2 * a2;
+          acc += w3 * b0 + w4 * b1 + w5 * b2;
+          acc += w6 * c0 + w7 * c1 + w8 * c2;
+
+          acc = MultiplyByQuantizedMultiplier(acc, multiplier, shift);
+          acc += output_offset;
+          acc = std::max(acc, output_activation_min);
+          acc = std::min(acc, output_activation_max);
+          out[out_x * output_depth] = static_cast<int8_t>(acc);
+
+          a0 = a1;
+          a1 = a2;
+          b0 = b1;
+          b1 = b2;
+          c0 = c1;
+          c1 = c2;
+        }
+      }
+    }
+  }
+}
+
 void EvalFloat(TfLiteContext* context, TfLiteNode* node,
                TfLiteConvParams* params, const OpData& data,
                const TfLiteEvalTensor* input, const TfLiteEvalTensor* filter,
@@ -278,6 +476,20 @@ void EvalFloat(TfLiteContext* context, TfLiteNode* node,
                       tflite::micro::GetTensorData<float>(im2col));
 }
 
+void EvalInt8(TfLiteContext* context, TfLiteNode* node,
+              TfLiteConvParams* params, const OpData& data,
+              const TfLiteEvalTensor* input, const TfLiteEvalTensor* filter,
+              const TfLiteEvalTensor* bias, TfLiteEvalTensor* output) {
+  if (data.single_channel_3x3) {
+    EvalConv3x3SingleChannel(data, input, filter, output);
+  } else if (data.folded_bias != nullptr) {
+    EvalQuantizedPerChannelFolded(params, data, input, filter, output);
+  } else {
+    EvalQuantizedPerChannel(context, node, params, data, input, filter, bias,
+                            output, nullptr);
+  }
+}
+
 TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
   auto* params = reinterpret_cast<TfLiteConvParams*>(node->builtin_data);
 
@@ -301,8 +513,7 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
                 nullptr, output);
       break;
     case kTfLiteInt8:
-      EvalQuantizedPerChannel(context, node, params, data, input, filter, bias,
-                              output, nullptr);
+      EvalInt8(context, node, params, data, input, filter, bias, output);
       break;
     case kTfLiteUInt8:
       EvalQuantized(context, node, params, data, input, filter, bias, nullptr,
@@ -316,6 +527,179 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
   return kTfLiteOk;
 }
 
+// CONV_2D -> MAX_POOL_2D [-> RELU] fused by FuseOperators(), int8 only. The
+// convolution has no padding, so each band of pooling window rows of its
+// output is computed from a band of input rows into a scratch buffer and
+// pooled right away; the whole convolution output never exists. Every
+// value goes through the same arithmetic as in the three separate kernels.
+struct ConvPoolOpData {
+  OpData conv;
+  TfLitePaddingValues pool_padding;
+  int32_t pool_activation_min;
+  int32_t pool_activation_max;
+  ReluParams relu;
+  // Pooling window rows of the convolution output.
+  int rows_buffer_index;
+};
+
+void* ConvPoolInit(TfLiteContext* context, const char* buffer, size_t length) {
+  TFLITE_DCHECK(context->AllocatePersistentBuffer != nullptr);
+  return context->AllocatePersistentBuffer(context, sizeof(ConvPoolOpData));
+}
+
+TfLiteStatus ConvPoolPrepare(TfLiteContext* context, TfLiteNode* node) {
+  TFLITE_DCHECK(node->user_data != nullptr);
+  TFLITE_DCHECK(node->builtin_data != nullptr);
+
+  ConvPoolOpData* data = static_cast<ConvPoolOpData*>(node->user_data);
+  const auto* params =
+      static_cast<const TfLiteConvPoolParams*>(node->builtin_data);
+
+  const TfLiteTensor* input = GetInput(context, node, kInputTensor);
+  TfLiteTensor* output = GetOutput(context, node, kOutputTensor);
+  TfLiteTensor* conv_output = context->GetTensor(context, params->conv_output);
+  TfLiteTensor* pool_output = context->GetTensor(context, params->pool_output);
+  TF_LITE_ENSURE_EQ(context, input->type, kTfLiteInt8);
+  TF_LITE_ENSURE_EQ(context, output->type, kTfLiteInt8);
+
+  TF_LITE_ENSURE_STATUS(
+      PrepareOpData(context, node, &params->conv, conv_output, &data->conv));
+  TF_LITE_ENSURE_EQ(context, data->conv.padding.width, 0);
+  TF_LITE_ENSURE_EQ(context, data->conv.padding.height, 0);
+
+  const int conv_height = SizeOfDimension(conv_output, 1);
+  const int conv_width = SizeOfDimension(conv_output, 2);
+  const int conv_depth = SizeOfDimension(conv_output, 3);
+  int unused_height, unused_width;
+  data->pool_padding = ComputePaddingHeightWidth(
+      params->pool.stride_height, params->pool.stride_width,
+      /*dilation_rate_height=*/1, /*dilation_rate_width=*/1, conv_height,
+      conv_width, params->pool.filter_height, params->pool.filter_width,
+      params->pool.padding, &unused_height, &unused_width);
+  TF_LITE_ENSURE_STATUS(CalculateActivationRangeQuantized(
+      context, params->pool.activation, pool_output,
+      &data->pool_activation_min, &data->pool_activation_max));
+  if (params->relu) {
+    CalculateReluParams<int8_t>(pool_output, output, &data->relu);
+  }
+
+  return context->RequestScratchBufferInArena(
+      context, params->pool.filter_height * conv_width * conv_depth,
+      &data->rows_buffer_index);
+}
+
+// Convolution output rows [first_row, first_row + row_count) of one batch,
+// computed by the CONV_2D kernel on views of the input and of rows.
+void EvalConvRows(TfLiteContext* context, TfLiteNode* node,
+                  TfLiteConvParams* params, const OpData& data,
+                  const TfLiteEvalTensor* input,
+                  const TfLiteEvalTensor* filter,
+                  const TfLiteEvalTensor* bias, int batch, int first_row,
+                  int row_count, int width, int depth, int8_t* rows) {
+  const RuntimeShape input_shape = tflite::micro::GetTensorShape(input);
+  const int input_height = input_shape.Dims(1);
+  const int input_width = input_shape.Dims(2);
+  const int input_depth = input_shape.Dims(3);
+  const int filter_height = tflite::micro::GetTensorShape(filter).Dims(1);
+  const int first_input_row = first_row * params->stride_height;
+
+  int input_dims[5] = {4, 1,
+                       (row_count - 1) * params->stride_height +
+                           (filter_height - 1) *
+                               params->dilation_height_factor +
+                           1,
+                       input_width, input_depth};
+  TfLiteEvalTensor input_rows;
+  input_rows.type = kTfLiteInt8;
+  input_rows.dims = reinterpret_cast<TfLiteIntArray*>(input_dims);
+  input_rows.data.int8 = const_cast<int8_t*>(
+      tflite::micro::GetTensorData<int8_t>(input) +
+      (batch * input_height + first_input_row) * input_width * input_depth);
+
+  int output_dims[5] = {4, 1, row_count, width, depth};
+  TfLiteEvalTensor output_rows;
+  output_rows.type = kTfLiteInt8;
+  output_rows.dims = reinterpret_cast<TfLiteIntArray*>(output_dims);
+  output_rows.data.int8 = rows;
+
+  EvalInt8(context, node, params, data, &input_rows, filter, bias,
+           &output_rows);
+}
+
+TfLiteStatus ConvPoolEval(TfLiteContext* context, TfLiteNode* node) {
+  TFLITE_DCHECK(node->user_data != nullptr);
+  TFLITE_DCHECK(node->builtin_data != nullptr);
+  const ConvPoolOpData& data =
+      *(static_cast<const ConvPoolOpData*>(node->user_data));
+  auto* params = static_cast<TfLiteConvPoolParams*>(node->builtin_data);
+
+  const TfLiteEvalTensor* input =
+      tflite::micro::GetEvalInput(context, node, kInputTensor);
+  const TfLiteEvalTensor* filter =
+      tflite::micro::GetEvalInput(context, node, kFilterTensor);
+  const TfLiteEvalTensor* bias =
+      (NumInputs(node) == 3)
+          ? tflite::micro::GetEvalInput(context, node, kBiasTensor)
+          : nullptr;
+  TfLiteEvalTensor* output =
+      tflite::micro::GetEvalOutput(context, node, kOutputTensor);
+  const TfLiteEvalTensor* conv_output =
+      context->GetEvalTensor(context, params->conv_output);
+  int8_t* rows =
+      static_cast<int8_t*>(context->GetScratchBuffer(context,
+                                                     data.rows_buffer_index));
+  TF_LITE_ENSURE(context, rows != nullptr);
+
+  const RuntimeShape conv_shape = tflite::micro::GetTensorShape(conv_output);
+  const RuntimeShape output_shape = tflite::micro::GetTensorShape(output);
+  const int batches = MatchingDim(conv_shape, 0, output_shape, 0);
+  const int depth = MatchingDim(conv_shape, 3, output_shape, 3);
+  const int conv_height = conv_shape.Dims(1);
+  const int conv_width = conv_shape.Dims(2);
+  const int output_height = output_shape.Dims(1);
+  const int output_width = output_shape.Dims(2);
+  const TfLitePoolParams& pool = params->pool;
+  int8_t* output_data = tflite::micro::GetTensorData<int8_t>(output);
+
+  for (int batch = 0; batch < batches; ++batch) {
+    for (int out_y = 0; out_y < output_height; ++out_y) {
+      const int in_y_origin =
+          (out_y * pool.stride_height) - data.pool_padding.height;
+      const int first_row = std::max(0, in_y_origin);
+      const int end_row =
+          std::min(conv_height, in_y_origin + pool.filter_height);
+      EvalConvRows(context, node, &params->conv, data.conv, input, filter,
+                   bias, batch, first_row, end_row - first_row, conv_width,
+                   depth, rows);
+
+      for (int out_x = 0; out_x < output_width; ++out_x) {
+        const int in_x_origin =
+            (out_x * pool.stride_width) - data.pool_padding.width;
+        const int first_col = std::max(0, in_x_origin);
+        const int end_col =
+            std::min(conv_width, in_x_origin + pool.filter_width);
+        for (int channel = 0; channel < depth; ++channel) {
+          int32_t max = std::numeric_limits<int8_t>::lowest();
+          for (int row = 0; row < end_row - first_row; ++row) {
+            for (int col = first_col; col < end_col; ++col) {
+              max = std::max<int32_t>(
+                  max, rows[(row * conv_width + col) * depth + channel]);
+            }
+          }
+          max = std::max<int32_t>(max, data.pool_activation_min);
+          max = std::min<int32_t>(max, data.pool_activation_max);
+          if (params->relu) {
+            max = ReluQuantizedValue(data.relu, max);
+          }
+          output_data[Offset(output_shape, batch, out_y, out_x, channel)] =
+              static_cast<int8_t>(max);
+        }
+      }
+    }
+  }
+  return kTfLiteOk;
+}
+
 }  // namespace conv
 
 TfLiteRegistration Register_CONV_2D() {
@@ -329,6 +713,18 @@ TfLiteRegistration Register_CONV_2D() {
           /*version=*/0};
 }
 
+TfLiteRegistration* Register_CONV_2D_MAX_POOL_2D() {
+  static TfLiteRegistration r = {/*init=*/conv::ConvPoolInit,
+                                 /*free=*/nullptr,
+                                 /*prepare=*/conv::ConvPoolPrepare,
+                                 /*invoke=*/conv::ConvPoolEval,
+                                 /*profiling_string=*/nullptr,
+                                 /*builtin_code=*/0,
+                                 /*custom_name=*/nullptr,
+                                 /*version=*/0};
+  return &r;
+}
+
 }  // namespace micro
 }  // namespace ops
 }  // namespace tflite
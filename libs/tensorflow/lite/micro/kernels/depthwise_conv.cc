@@ -61,6 +61,12 @@ struct OpData {
   // uint8_t these would be 0 and 255.
   int32_t output_activation_min;
   int32_t output_activation_max;
+
+  // int8 with constant weights where every output reads all filter taps,
+  // nullptr otherwise: per output channel part of the accumulator that does
+  // not depend on the input, see FoldInputOffsetIntoBias().
+  // EvalQuantizedPerChannelFolded() runs instead of the reference kernel.
+  int32_t* folded_bias;
 };
 
 TfLiteStatus CalculateOpData(TfLiteContext* context, TfLiteNode* node,
@@ -161,6 +167,24 @@ TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
   data->filter_zero_point = filter->params.zero_point;
   data->output_zero_point = output->params.zero_point;
 
+  const TfLiteTensor* bias = GetOptionalInputTensor(context, node, kBiasTensor);
+  data->folded_bias = nullptr;
+  if (data_type == kTfLiteInt8 &&
+      tflite::micro::CanFoldInputOffset(filter, bias) &&
+      tflite::micro::ConvWindowsInside(
+          width, filter_width, params->stride_width,
+          params->dilation_width_factor, data->padding.width,
+          SizeOfDimension(output, 2)) &&
+      tflite::micro::ConvWindowsInside(
+          height, filter_height, params->stride_height,
+          params->dilation_height_factor, data->padding.height,
+          SizeOfDimension(output, 1))) {
+    // Per-channel int8 weights are symmetric, the filter offset is not used.
+    TF_LITE_ENSURE_STATUS(tflite::micro::FoldInputOffsetIntoBias(
+        context, filter, bias, kDepthwiseConvQuantizedDimension,
+        -data->input_zero_point, 0, &data->folded_bias));
+  }
+
   return kTfLiteOk;
 }
 
@@ -230,6 +254,83 @@ void EvalQuantizedPerChannel(TfLiteContext* context, TfLiteNode* node,
       tflite::micro::GetTensorData<int8_t>(output));
 }
 
+// Same result as reference_integer_ops::DepthwiseConvPerChannel() when
+// OpData::folded_bias is set: no bounds checks and no input offset, the
+// inner loop is a plain int8 dot product.
+void EvalQuantizedPerChannelFolded(TfLiteDepthwiseConvParams* params,
+                                   const OpData& data,
+                                   const TfLiteEvalTensor* input,
+                                   const TfLiteEvalTensor* filter,
+                                   TfLiteEvalTensor* output) {
+  const RuntimeShape input_shape = tflite::micro::GetTensorShape(input);
+  const RuntimeShape filter_shape = tflite::micro::GetTensorShape(filter);
+  const RuntimeShape output_shape = tflite::micro::GetTensorShape(output);
+  const int8_t* input_data = tflite::micro::GetTensorData<int8_t>(input);
+  const int8_t* filter_data = tflite::micro::GetTensorData<int8_t>(filter);
+  int8_t* output_data = tflite::micro::GetTensorData<int8_t>(output);
+
+  const int stride_width = params->stride_width;
+  const int stride_height = params->stride_height;
+  const int dilation_width_factor = params->dilation_width_factor;
+  const int dilation_height_factor = params->dilation_height_factor;
+  const int depth_multiplier = params->depth_multiplier;
+  const int32_t output_offset = data.output_zero_point;
+  // Same clamping as EvalQuantizedPerChannel().
+  const int32_t output_activation_min = std::numeric_limits<int8_t>::min();
+  const int32_t output_activation_max = std::numeric_limits<int8_t>::max();
+
+  const int batches = MatchingDim(input_shape, 0, output_shape, 0);
+  const int output_depth = MatchingDim(filter_shape, 3, output_shape, 3);
+  const int input_height = input_shape.Dims(1);
+  const int input_width = input_shape.Dims(2);
+  const int input_depth = input_shape.Dims(3);
+  const int filter_height = filter_shape.Dims(1);
+  const int filter_width = filter_shape.Dims(2);
+  const int output_height = output_shape.Dims(1);
+  const int output_width = output_shape.Dims(2);
+  const int input_row_size = input_width * input_depth;
+  const int filter_row_size = filter_width * output_depth;
+
+  for (int batch = 0; batch < batches; ++batch) {
+    const int8_t* batch_input =
+        input_data + batch * input_height * input_row_size;
+    for (int out_y = 0; out_y < output_height; ++out_y) {
+      for (int out_x = 0; out_x < output_width; ++out_x) {
+        const int8_t* window = batch_input +
+                               out_y * stride_height * input_row_size +
+                               out_x * stride_width * input_depth;
+        for (int in_channel = 0; in_channel < input_depth; ++in_channel) {
+          for (int m = 0; m < depth_multiplier; ++m) {
+            const int output_channel = m + in_channel * depth_multiplier;
+            int32_t acc = data.folded_bias[output_channel];
+            for (int filter_y = 0; filter_y < filter_height; ++filter_y) {
+              const int8_t* in = window +
+                                 dilation_height_factor * filter_y *
+                                     input_row_size +
+                                 in_channel;
+              const int8_t* w =
+                  filter_data + filter_y * filter_row_size + output_channel;
+              for (int filter_x = 0; filter_x < filter_width; ++filter_x) {
+                acc += w[filter_x * output_depth] *
+                       in[dilation_width_factor * filter_x * input_depth];
+              }
+            }
+
+            acc = MultiplyByQuantizedMultiplier(
+                acc, data.per_channel_output_multiplier[output_channel],
+                data.per_channel_output_shift[output_channel]);
+            acc += output_offset;
+            acc = std::max(acc, output_activation_min);
+            acc = std::min(acc, output_activation_max);
+            output_data[Offset(output_shape, batch, out_y, out_x,
+                               output_channel)] = static_cast<int8_t>(acc);
+          }
+        }
+      }
+    }
+  }
+}
+
 void EvalQuantized(TfLiteContext* context, TfLiteNode* node,
                    TfLiteDepthwiseConvParams* params, const OpData& data,
                    const TfLiteEvalTensor* input,
@@ -295,6 +396,10 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
       EvalFloat(context, node, params, data, input, filter, bias, output);
       break;
     case kTfLiteInt8:
+      if (data.folded_bias != nullptr) {
+        EvalQuantizedPerChannelFolded(params, data, input, filter, output);
+        break;
+      }
       EvalQuantizedPerChannel(context, node, params, data, input, filter, bias,
                               output);
       break;
@@ -15,6 +15,8 @@ limitations under the License.
 
 #include "tensorflow/lite/kernels/internal/reference/fully_connected.h"
 
+#include <cstring>
+
 #include "tensorflow/lite/c/builtin_op_data.h"
 #include "tensorflow/lite/c/common.h"
 #include "tensorflow/lite/kernels/internal/common.h"
@@ -24,6 +26,12 @@ limitations under the License.
 #include "tensorflow/lite/kernels/kernel_util.h"
 #include "tensorflow/lite/micro/kernels/kernel_util.h"
 
+// Cortex-M4 and up: two 16-bit multiply-accumulates per instruction.
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#include "cmsis_compiler.h"
+#define FULLY_CONNECTED_DUAL_MAC
+#endif
+
 namespace tflite {
 namespace ops {
 namespace micro {
@@ -45,8 +53,17 @@ struct OpData {
   int32_t input_zero_point;
   int32_t filter_zero_point;
   int32_t output_zero_point;
+
+  // int8 with constant weights only, nullptr otherwise: per output channel
+  // part of the accumulator that does not depend on the input, see
+  // FoldInputOffsetIntoBias(). EvalFullyConnectedInt8() runs instead of the
+  // reference kernel.
+  int32_t* folded_bias;
 };
 
+// Output channels accumulated per pass over the input.
+constexpr int kRowsPerPass = 4;
+
 constexpr int kInputTensor = 0;
 constexpr int kWeightsTensor = 1;
 constexpr int kBiasTensor = 2;
@@ -77,6 +94,106 @@ TfLiteStatus CalculateOpData(TfLiteContext* context,
   return status;
 }
 
+#if defined(FULLY_CONNECTED_DUAL_MAC)
+inline int32_t ReadInt8x4(const int8_t* data) {
+  int32_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+#endif
+
+// acc[row] += sum(filter row * input) for kRows consecutive filter rows,
+// each input value is loaded once for all of them. With the DSP extension
+// four int8 values are loaded at a time and sign extended into two pairs of
+// 16-bit lanes (bytes 0, 2 and 1, 3), SMLAD multiplies and adds both lanes.
+template <int kRows>
+inline void AccumulateRows(const int8_t* input, const int8_t* filter,
+                           int accum_depth, int32_t* acc) {
+  int d = 0;
+#if defined(FULLY_CONNECTED_DUAL_MAC)
+  for (; d <= accum_depth - 4; d += 4) {
+    const int32_t in = ReadInt8x4(input + d);
+    const uint32_t in_even = __SXTB16(in);
+    const uint32_t in_odd = __SXTB16(__ROR(in, 8));
+    for (int row = 0; row < kRows; ++row) {
+      const int32_t w = ReadInt8x4(filter + row * accum_depth + d);
+      acc[row] = __SMLAD(__SXTB16(w), in_even, acc[row]);
+      acc[row] = __SMLAD(__SXTB16(__ROR(w, 8)), in_odd, acc[row]);
+    }
+  }
+#endif
+  for (; d < accum_depth; ++d) {
+    const int32_t in = input[d];
+    for (int row = 0; row < kRows; ++row) {
+      acc[row] += filter[row * accum_depth + d] * in;
+    }
+  }
+}
+
+// Same result as reference_integer_ops::FullyConnected() with the input
+// independent terms taken from OpData::folded_bias.
+void EvalFullyConnectedInt8(const OpData& data, const TfLiteEvalTensor* input,
+                            const TfLiteEvalTensor* filter,
+                            TfLiteEvalTensor* output) {
+  const RuntimeShape filter_shape = tflite::micro::GetTensorShape(filter);
+  const RuntimeShape output_shape = tflite::micro::GetTensorShape(output);
+  const int8_t* input_data = tflite::micro::GetTensorData<int8_t>(input);
+  const int8_t* filter_data = tflite::micro::GetTensorData<int8_t>(filter);
+  int8_t* output_data = tflite::micro::GetTensorData<int8_t>(output);
+
+  const int filter_dim_count = filter_shape.DimensionsCount();
+  const int batches = output_shape.Dims(0);
+  const int output_depth = output_shape.Dims(1);
+  const int accum_depth = filter_shape.Dims(filter_dim_count - 1);
+  const int32_t filter_offset = -data.filter_zero_point;
+  const int32_t output_offset = data.output_zero_point;
+  const int output_shift = -data.output_shift;
+
+  for (int b = 0; b < batches; ++b) {
+    const int8_t* batch_input = input_data + b * accum_depth;
+
+    // Zero for symmetric int8 weights.
+    int32_t input_term = 0;
+    if (filter_offset != 0) {
+      for (int d = 0; d < accum_depth; ++d) {
+        input_term += batch_input[d];
+      }
+      input_term *= filter_offset;
+    }
+
+    for (int out_c = 0; out_c < output_depth; out_c += kRowsPerPass) {
+      const int8_t* rows = filter_data + out_c * accum_depth;
+      const int row_count = std::min(kRowsPerPass, output_depth - out_c);
+      int32_t acc[kRowsPerPass] = {0};
+      switch (row_count) {
+        case 4:
+          AccumulateRows<4>(batch_input, rows, accum_depth, acc);
+          break;
+        case 3:
+          AccumulateRows<3>(batch_input, rows, accum_depth, acc);
+          break;
+        case 2:
+          AccumulateRows<2>(batch_input, rows, accum_depth, acc);
+          break;
+        default:
+          AccumulateRows<1>(batch_input, rows, accum_depth, acc);
+          break;
+      }
+
+      for (int row = 0; row < row_count; ++row) {
+        int32_t value = acc[row] + input_term + data.folded_bias[out_c + row];
+        value = MultiplyByQuantizedMultiplier(value, data.output_multiplier,
+                                              output_shift);
+        value += output_offset;
+        value = std::max(value, data.output_activation_min);
+        value = std::min(value, data.output_activation_max);
+        output_data[out_c + row + output_depth * b] =
+            static_cast<int8_t>(value);
+      }
+    }
+  }
+}
+
 }  // namespace
 
 void* Init(TfLiteContext* context, const char* buffer, size_t length) {
@@ -101,8 +218,19 @@ TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
   TF_LITE_ENSURE_MSG(context, input->type == filter->type,
                      "Hybrid models are not supported on TFLite Micro.");
 
-  return CalculateOpData(context, params->activation, input->type, input,
-                         filter, bias, output, data);
+  TF_LITE_ENSURE_STATUS(CalculateOpData(context, params->activation,
+                                        input->type, input, filter, bias,
+                                        output, data));
+
+  data->folded_bias = nullptr;
+  if (input->type == kTfLiteInt8 &&
+      tflite::micro::CanFoldInputOffset(filter, bias)) {
+    TF_LITE_ENSURE_STATUS(tflite::micro::FoldInputOffsetIntoBias(
+        context, filter, bias, filter->dims->size - 2,
+        -data->input_zero_point, -data->filter_zero_point,
+        &data->folded_bias));
+  }
+  return kTfLiteOk;
 }
 
 TfLiteStatus EvalQuantizedInt8(TfLiteContext* context, TfLiteNode* node,
@@ -111,6 +239,11 @@ TfLiteStatus EvalQuantizedInt8(TfLiteContext* context, TfLiteNode* node,
                                const TfLiteEvalTensor* filter,
                                const TfLiteEvalTensor* bias,
                                TfLiteEvalTensor* output) {
+  if (data.folded_bias != nullptr) {
+    EvalFullyConnectedInt8(data, input, filter, output);
+    return kTfLiteOk;
+  }
+
   tflite::FullyConnectedParams op_params;
   op_params.input_offset = -data.input_zero_point;
   op_params.weights_offset = -data.filter_zero_point;
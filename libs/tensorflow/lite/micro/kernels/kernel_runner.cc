@@ -68,6 +68,9 @@ TfLiteStatus KernelRunner::Invoke() {
                          "TfLiteRegistration missing invoke function pointer!");
     return kTfLiteError;
   }
+  // The TfLiteEvalTensors of GetEvalTensor() only live for one invoke, they
+  // would fill the buffer when the kernel is invoked over and over.
+  allocator_->ResetTempAllocations();
   return registration_.invoke(&context_, &node_);
 }
 
@@ -16,6 +16,8 @@ limitations under the License.
 #include "tensorflow/lite/micro/kernels/kernel_util.h"
 
 #include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/kernels/internal/tensor_ctypes.h"
+#include "tensorflow/lite/kernels/kernel_util.h"
 
 namespace tflite {
 namespace micro {
@@ -27,5 +29,63 @@ bool HaveSameShapes(const TfLiteEvalTensor* input1,
   return TfLiteIntArrayEqual(input1->dims, input2->dims);
 }
 
+bool CanFoldInputOffset(const TfLiteTensor* filter, const TfLiteTensor* bias) {
+  return filter->type == kTfLiteInt8 && IsConstantTensor(filter) &&
+         (bias == nullptr ||
+          (bias->type == kTfLiteInt32 && IsConstantTensor(bias)));
+}
+
+TfLiteStatus FoldInputOffsetIntoBias(TfLiteContext* context,
+                                     const TfLiteTensor* filter,
+                                     const TfLiteTensor* bias,
+                                     int channel_dimension,
+                                     int32_t input_offset,
+                                     int32_t filter_offset,
+                                     int32_t** folded_bias) {
+  TFLITE_DCHECK(context->AllocatePersistentBuffer != nullptr);
+  TF_LITE_ENSURE(context, CanFoldInputOffset(filter, bias));
+  TF_LITE_ENSURE(context, channel_dimension >= 0 &&
+                              channel_dimension < filter->dims->size);
+
+  // filter is [outer, channels, inner] around channel_dimension.
+  const int channels = filter->dims->data[channel_dimension];
+  int outer = 1;
+  for (int i = 0; i < channel_dimension; ++i) {
+    outer *= filter->dims->data[i];
+  }
+  int inner = 1;
+  for (int i = channel_dimension + 1; i < filter->dims->size; ++i) {
+    inner *= filter->dims->data[i];
+  }
+  const int8_t* filter_data = tflite::GetTensorData<int8_t>(filter);
+  const int32_t* bias_data =
+      bias != nullptr ? tflite::GetTensorData<int32_t>(bias) : nullptr;
+
+  int32_t* sums = reinterpret_cast<int32_t*>(
+      context->AllocatePersistentBuffer(context, channels * sizeof(int32_t)));
+  TF_LITE_ENSURE(context, sums != nullptr);
+
+  for (int c = 0; c < channels; ++c) {
+    sums[c] = outer * inner * filter_offset;
+  }
+  for (int o = 0; o < outer; ++o) {
+    for (int c = 0; c < channels; ++c) {
+      const int8_t* values = filter_data + (o * channels + c) * inner;
+      for (int i = 0; i < inner; ++i) {
+        sums[c] += values[i];
+      }
+    }
+  }
+  for (int c = 0; c < channels; ++c) {
+    sums[c] *= input_offset;
+    if (bias_data) {
+      sums[c] += bias_data[c];
+    }
+  }
+
+  *folded_bias = sums;
+  return kTfLiteOk;
+}
+
 }  // namespace micro
 }  // namespace tflite
@@ -77,6 +77,41 @@ inline const RuntimeShape GetTensorShape(const TfLiteEvalTensor* tensor) {
 bool HaveSameShapes(const TfLiteEvalTensor* input1,
                     const TfLiteEvalTensor* input2);
 
+// Returns true if every output of a convolution along one spatial dimension
+// reads all filter taps from inside the input, so no tap is dropped as
+// padding.
+inline bool ConvWindowsInside(int input_size, int filter_size, int stride,
+                              int dilation, int padding, int output_size) {
+  return padding == 0 &&
+         (output_size - 1) * stride + (filter_size - 1) * dilation <
+             input_size;
+}
+
+// Returns true if the bias of a kernel with the given filter can be folded
+// in Prepare: the filter and the bias (if any) are constant.
+bool CanFoldInputOffset(const TfLiteTensor* filter, const TfLiteTensor* bias);
+
+// Folds the input independent part of a quantized int8 kernel's accumulator
+//   sum((filter + filter_offset) * (input + input_offset)) + bias
+// into one value per output channel:
+//   folded_bias[c] = bias[c] + input_offset * (sum(filter[c]) +
+//                                              filter_offset * n),
+// where filter[c] are the n filter values with index c along
+// channel_dimension. What is left for Eval is
+//   sum(filter * input) + filter_offset * sum(input) + folded_bias,
+// the last but one term is zero for symmetric weights.
+// Only valid when every output reads all filter values: FULLY_CONNECTED,
+// CONV_2D and DEPTHWISE_CONV_2D without padding (see ConvWindowsInside()).
+// folded_bias is allocated as a persistent buffer, so this can only be
+// called from Prepare.
+TfLiteStatus FoldInputOffsetIntoBias(TfLiteContext* context,
+                                     const TfLiteTensor* filter,
+                                     const TfLiteTensor* bias,
+                                     int channel_dimension,
+                                     int32_t input_offset,
+                                     int32_t filter_offset,
+                                     int32_t** folded_bias);
+
 }  // namespace micro
 }  // namespace tflite
 
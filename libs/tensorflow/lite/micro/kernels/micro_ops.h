@@ -38,6 +38,7 @@ TfLiteRegistration Register_CEIL();
 // TODO(b/160234179): Change custom OPs to also return by value.
 TfLiteRegistration* Register_CIRCULAR_BUFFER();
 TfLiteRegistration Register_CONV_2D();
+TfLiteRegistration* Register_CONV_2D_MAX_POOL_2D();
 TfLiteRegistration Register_CONCATENATION();
 TfLiteRegistration Register_COS();
 TfLiteRegistration Register_DEPTHWISE_CONV_2D();
@@ -14,6 +14,9 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/lite/kernels/internal/reference/pooling.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include "tensorflow/lite/c/builtin_op_data.h"
 #include "tensorflow/lite/kernels/internal/reference/integer_ops/pooling.h"
 #include "tensorflow/lite/kernels/internal/tensor_ctypes.h"
@@ -21,6 +24,12 @@ limitations under the License.
 #include "tensorflow/lite/kernels/padding.h"
 #include "tensorflow/lite/micro/kernels/kernel_util.h"
 
+// Cortex-M4 and up: four 8-bit or two 16-bit lanes per instruction.
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#include "cmsis_compiler.h"
+#define POOLING_PACKED_LANES
+#endif
+
 namespace tflite {
 namespace ops {
 namespace micro {
@@ -37,6 +46,11 @@ struct OpData {
   int32_t activation_max;
   float activation_min_f32;
   float activation_max_f32;
+  // int8 2x2 or 3x3 windows that all lie inside the input, see
+  // EvalInt8Windows().
+  bool int8_windows;
+  // One input row of column sums (int16) or maxima, for int8_windows.
+  int column_buffer_index;
 };
 
 TfLiteStatus CalculateOpData(const TfLiteContext* context,
@@ -58,6 +72,179 @@ TfLiteStatus CalculateOpData(const TfLiteContext* context,
   return kTfLiteOk;
 }
 
+#if defined(POOLING_PACKED_LANES)
+inline uint32_t ReadWord(const void* data) {
+  uint32_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+inline void WriteWord(void* data, uint32_t value) {
+  std::memcpy(data, &value, sizeof(value));
+}
+
+// Lane-wise max of four int8 values: __SSUB8 sets the GE flag of every lane
+// where a >= b, __SEL takes those lanes from a and the others from b.
+inline uint32_t MaxInt8x4(uint32_t a, uint32_t b) {
+  __SSUB8(a, b);
+  return __SEL(a, b);
+}
+#endif
+
+// column[i] = max(rows[r * row_stride + i]) over kRows rows.
+template <int kRows>
+void MaxRowsInt8(const int8_t* rows, int row_stride, int size,
+                 int8_t* column) {
+  int i = 0;
+#if defined(POOLING_PACKED_LANES)
+  for (; i <= size - 4; i += 4) {
+    uint32_t max = ReadWord(rows + i);
+    for (int row = 1; row < kRows; ++row) {
+      max = MaxInt8x4(max, ReadWord(rows + row * row_stride + i));
+    }
+    WriteWord(column + i, max);
+  }
+#endif
+  for (; i < size; ++i) {
+    int8_t max = rows[i];
+    for (int row = 1; row < kRows; ++row) {
+      max = std::max(max, rows[row * row_stride + i]);
+    }
+    column[i] = max;
+  }
+}
+
+// column[i] = sum(rows[r * row_stride + i]) over kRows rows. With the DSP
+// extension the even and the odd bytes of a word are summed as two pairs of
+// 16-bit lanes and put back in order when stored.
+template <int kRows>
+void SumRowsInt8(const int8_t* rows, int row_stride, int size,
+                 int16_t* column) {
+  int i = 0;
+#if defined(POOLING_PACKED_LANES)
+  for (; i <= size - 4; i += 4) {
+    uint32_t word = ReadWord(rows + i);
+    uint32_t even = __SXTB16(word);
+    uint32_t odd = __SXTB16(__ROR(word, 8));
+    for (int row = 1; row < kRows; ++row) {
+      word = ReadWord(rows + row * row_stride + i);
+      even = __SADD16(even, __SXTB16(word));
+      odd = __SADD16(odd, __SXTB16(__ROR(word, 8)));
+    }
+    WriteWord(column + i, __PKHBT(even, odd, 16));
+    WriteWord(column + i + 2, __PKHTB(odd, even, 16));
+  }
+#endif
+  for (; i < size; ++i) {
+    int16_t sum = rows[i];
+    for (int row = 1; row < kRows; ++row) {
+      sum += rows[row * row_stride + i];
+    }
+    column[i] = sum;
+  }
+}
+
+// One output row of MAX_POOL_2D from the column maxima of its input rows.
+template <int kFilterWidth>
+void MaxColumnsInt8(const int8_t* column, int stride, int depth,
+                    int output_width, const OpData* data, int8_t* output) {
+  for (int out_x = 0; out_x < output_width; ++out_x) {
+    const int8_t* window = column + out_x * stride * depth;
+    for (int channel = 0; channel < depth; ++channel) {
+      int32_t max = window[channel];
+      for (int filter_x = 1; filter_x < kFilterWidth; ++filter_x) {
+        max = std::max<int32_t>(max, window[filter_x * depth + channel]);
+      }
+      max = std::max<int32_t>(max, data->activation_min);
+      max = std::min<int32_t>(max, data->activation_max);
+      *output++ = static_cast<int8_t>(max);
+    }
+  }
+}
+
+// One output row of AVERAGE_POOL_2D from the column sums of its input rows,
+// rounded like reference_integer_ops::AveragePool().
+template <int kFilterHeight, int kFilterWidth>
+void AverageColumnsInt8(const int16_t* column, int stride, int depth,
+                        int output_width, const OpData* data,
+                        int8_t* output) {
+  constexpr int kCount = kFilterHeight * kFilterWidth;
+  for (int out_x = 0; out_x < output_width; ++out_x) {
+    const int16_t* window = column + out_x * stride * depth;
+    for (int channel = 0; channel < depth; ++channel) {
+      int32_t acc = window[channel];
+      for (int filter_x = 1; filter_x < kFilterWidth; ++filter_x) {
+        acc += window[filter_x * depth + channel];
+      }
+      acc = acc > 0 ? (acc + kCount / 2) / kCount
+                    : (acc - kCount / 2) / kCount;
+      acc = std::max(acc, data->activation_min);
+      acc = std::min(acc, data->activation_max);
+      *output++ = static_cast<int8_t>(acc);
+    }
+  }
+}
+
+// int8 pooling over kFilterHeight x kFilterWidth windows that all lie inside
+// the input. Nothing is clipped, so each output row is one vertical pass
+// over whole input rows into the column buffer and one horizontal pass over
+// the columns of each window.
+template <bool kMax, int kFilterHeight, int kFilterWidth>
+void EvalInt8Windows(TfLiteContext* context, const TfLitePoolParams* params,
+                     const OpData* data, const TfLiteEvalTensor* input,
+                     TfLiteEvalTensor* output) {
+  const RuntimeShape input_shape = tflite::micro::GetTensorShape(input);
+  const RuntimeShape output_shape = tflite::micro::GetTensorShape(output);
+  const int batches = MatchingDim(input_shape, 0, output_shape, 0);
+  const int depth = MatchingDim(input_shape, 3, output_shape, 3);
+  const int input_height = input_shape.Dims(1);
+  const int input_width = input_shape.Dims(2);
+  const int output_height = output_shape.Dims(1);
+  const int output_width = output_shape.Dims(2);
+  const int row_size = input_width * depth;
+  // Only the input columns read by some window.
+  const int column_size =
+      ((output_width - 1) * params->stride_width + kFilterWidth) * depth;
+  const int8_t* input_data = tflite::micro::GetTensorData<int8_t>(input);
+  int8_t* output_data = tflite::micro::GetTensorData<int8_t>(output);
+  void* column =
+      context->GetScratchBuffer(context, data->column_buffer_index);
+
+  for (int batch = 0; batch < batches; ++batch) {
+    for (int out_y = 0; out_y < output_height; ++out_y) {
+      const int8_t* rows =
+          input_data +
+          (batch * input_height + out_y * params->stride_height) * row_size;
+      int8_t* output_row =
+          output_data + (batch * output_height + out_y) * output_width * depth;
+      if (kMax) {
+        MaxRowsInt8<kFilterHeight>(rows, row_size, column_size,
+                                   static_cast<int8_t*>(column));
+        MaxColumnsInt8<kFilterWidth>(static_cast<const int8_t*>(column),
+                                     params->stride_width, depth,
+                                     output_width, data, output_row);
+      } else {
+        SumRowsInt8<kFilterHeight>(rows, row_size, column_size,
+                                   static_cast<int16_t*>(column));
+        AverageColumnsInt8<kFilterHeight, kFilterWidth>(
+            static_cast<const int16_t*>(column), params->stride_width, depth,
+            output_width, data, output_row);
+      }
+    }
+  }
+}
+
+template <bool kMax>
+void EvalInt8Windows(TfLiteContext* context, const TfLitePoolParams* params,
+                     const OpData* data, const TfLiteEvalTensor* input,
+                     TfLiteEvalTensor* output) {
+  if (params->filter_height == 2) {
+    EvalInt8Windows<kMax, 2, 2>(context, params, data, input, output);
+  } else {
+    EvalInt8Windows<kMax, 3, 3>(context, params, data, input, output);
+  }
+}
+
 void AverageEvalFloat(const TfLiteContext* context, const TfLiteNode* node,
                       const TfLitePoolParams* params, const OpData* data,
                       const TfLiteEvalTensor* input, TfLiteEvalTensor* output) {
@@ -82,6 +269,11 @@ void AverageEvalQuantized(TfLiteContext* context, const TfLiteNode* node,
                           TfLiteEvalTensor* output) {
   TFLITE_DCHECK(input->type == kTfLiteUInt8 || input->type == kTfLiteInt8);
 
+  if (data->int8_windows) {
+    EvalInt8Windows</*kMax=*/false>(context, params, data, input, output);
+    return;
+  }
+
   PoolParams op_params;
   op_params.stride_height = params->stride_height;
   op_params.stride_width = params->stride_width;
@@ -127,6 +319,11 @@ void MaxEvalFloat(TfLiteContext* context, TfLiteNode* node,
 void MaxEvalQuantized(TfLiteContext* context, TfLiteNode* node,
                       TfLitePoolParams* params, const OpData* data,
                       const TfLiteEvalTensor* input, TfLiteEvalTensor* output) {
+  if (data->int8_windows) {
+    EvalInt8Windows</*kMax=*/true>(context, params, data, input, output);
+    return;
+  }
+
   tflite::PoolParams op_params;
   op_params.stride_height = params->stride_height;
   op_params.stride_width = params->stride_width;
@@ -235,6 +432,27 @@ TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
                                       &data->activation_max);
   }
 
+  const bool square_window =
+      (params->filter_height == 2 && params->filter_width == 2) ||
+      (params->filter_height == 3 && params->filter_width == 3);
+  data->int8_windows =
+      input->type == kTfLiteInt8 && square_window &&
+      tflite::micro::ConvWindowsInside(
+          SizeOfDimension(input, 1), params->filter_height,
+          params->stride_height, /*dilation=*/1, data->padding.height,
+          SizeOfDimension(output, 1)) &&
+      tflite::micro::ConvWindowsInside(
+          SizeOfDimension(input, 2), params->filter_width,
+          params->stride_width, /*dilation=*/1, data->padding.width,
+          SizeOfDimension(output, 2));
+  if (data->int8_windows) {
+    return context->RequestScratchBufferInArena(
+        context,
+        SizeOfDimension(input, 2) * SizeOfDimension(input, 3) *
+            sizeof(int16_t),
+        &data->column_buffer_index);
+  }
+
   return kTfLiteOk;
 }
 
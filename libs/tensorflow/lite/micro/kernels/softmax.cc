@@ -15,6 +15,9 @@ limitations under the License.
 
 #include "tensorflow/lite/kernels/internal/reference/softmax.h"
 
+#include <algorithm>
+#include <limits>
+
 #include "tensorflow/lite/c/builtin_op_data.h"
 #include "tensorflow/lite/c/common.h"
 #include "tensorflow/lite/kernels/internal/common.h"
@@ -30,6 +33,36 @@ namespace micro {
 namespace activations {
 namespace {
 
+// Number of values of max_in_row - input for int8 input.
+constexpr int kExpLutSize = 256;
+
+struct OpData {
+  SoftmaxParams params;
+  // int8 input only: exp(-diff * beta * input_scale) as the raw Q0.31 value
+  // reference_ops::Softmax() computes for diff = max_in_row - input, zero
+  // where the reference skips the input (diff beyond diff_min). Built in
+  // Prepare, so Eval only has the reciprocal of each row sum to compute.
+  int32_t* exp_lut;
+};
+
+// Fills exp_lut with the values of reference_ops::Softmax() for int8 input.
+void PopulateExpLut(const SoftmaxParams& params, int32_t* exp_lut) {
+  using FixedPointScaledDiff = gemmlowp::FixedPoint<int32_t, 5>;
+  for (int diff = 0; diff < kExpLutSize; ++diff) {
+    const int32_t input_diff = -diff;
+    if (input_diff < params.diff_min) {
+      exp_lut[diff] = 0;
+      continue;
+    }
+    const int32_t input_diff_rescaled =
+        MultiplyByQuantizedMultiplierGreaterThanOne(
+            input_diff, params.input_multiplier, params.input_left_shift);
+    exp_lut[diff] = gemmlowp::exp_on_negative_values(
+                        FixedPointScaledDiff::FromRaw(input_diff_rescaled))
+                        .raw();
+  }
+}
+
 TfLiteStatus CalculateSoftmaxParams(TfLiteContext* context,
                                     const TfLiteTensor* input,
                                     TfLiteTensor* output,
@@ -85,32 +118,68 @@ void SoftmaxFloat(const TfLiteEvalTensor* input, TfLiteEvalTensor* output,
 
 void SoftmaxQuantized(const TfLiteEvalTensor* input, TfLiteEvalTensor* output,
                       const SoftmaxParams& op_data) {
-  if (input->type == kTfLiteUInt8) {
-    tflite::reference_ops::Softmax(
-        op_data, tflite::micro::GetTensorShape(input),
-        tflite::micro::GetTensorData<uint8_t>(input),
-        tflite::micro::GetTensorShape(output),
-        tflite::micro::GetTensorData<uint8_t>(output));
-  } else {
-    if (output->type == kTfLiteInt16) {
-      tflite::reference_ops::Softmax(
-          op_data, tflite::micro::GetTensorShape(input),
-          tflite::micro::GetTensorData<int8_t>(input),
-          tflite::micro::GetTensorShape(output),
-          tflite::micro::GetTensorData<int16_t>(output));
-    } else {
-      tflite::reference_ops::Softmax(
-          op_data, tflite::micro::GetTensorShape(input),
-          tflite::micro::GetTensorData<int8_t>(input),
-          tflite::micro::GetTensorShape(output),
-          tflite::micro::GetTensorData<int8_t>(output));
+  tflite::reference_ops::Softmax(
+      op_data, tflite::micro::GetTensorShape(input),
+      tflite::micro::GetTensorData<uint8_t>(input),
+      tflite::micro::GetTensorShape(output),
+      tflite::micro::GetTensorData<uint8_t>(output));
+}
+
+// reference_ops::Softmax() for int8 input with the exponentials taken from
+// exp_lut, bit-exact.
+template <typename OutputT>
+void SoftmaxInt8Lut(const TfLiteEvalTensor* input, TfLiteEvalTensor* output,
+                    const OpData& data) {
+  static const int kAccumulationIntegerBits = 12;
+  using FixedPointAccum =
+      gemmlowp::FixedPoint<int32_t, kAccumulationIntegerBits>;
+  using FixedPoint0 = gemmlowp::FixedPoint<int32_t, 0>;
+
+  const RuntimeShape input_shape = tflite::micro::GetTensorShape(input);
+  const RuntimeShape output_shape = tflite::micro::GetTensorShape(output);
+  const int8_t* input_data = tflite::micro::GetTensorData<int8_t>(input);
+  OutputT* output_data = tflite::micro::GetTensorData<OutputT>(output);
+  const int trailing_dim = input_shape.DimensionsCount() - 1;
+  const int outer_size =
+      MatchingFlatSizeSkipDim(input_shape, trailing_dim, output_shape);
+  const int depth =
+      MatchingDim(input_shape, trailing_dim, output_shape, trailing_dim);
+
+  for (int i = 0; i < outer_size; ++i) {
+    const int8_t* input_row = input_data + i * depth;
+    OutputT* output_row = output_data + i * depth;
+    const int32_t max_in_row = *std::max_element(input_row, input_row + depth);
+
+    FixedPointAccum sum_of_exps = FixedPointAccum::Zero();
+    for (int c = 0; c < depth; ++c) {
+      sum_of_exps =
+          sum_of_exps + gemmlowp::Rescale<kAccumulationIntegerBits>(
+                            FixedPoint0::FromRaw(
+                                data.exp_lut[max_in_row - input_row[c]]));
+    }
+
+    int num_bits_over_unit;
+    const FixedPoint0 shifted_scale = FixedPoint0::FromRaw(GetReciprocal(
+        sum_of_exps.raw(), kAccumulationIntegerBits, &num_bits_over_unit));
+    const int exponent = num_bits_over_unit + 31 - (sizeof(OutputT) * 8);
+
+    for (int c = 0; c < depth; ++c) {
+      const FixedPoint0 exp_in_0 =
+          FixedPoint0::FromRaw(data.exp_lut[max_in_row - input_row[c]]);
+      const int32_t unsat_output =
+          gemmlowp::RoundingDivideByPOT((shifted_scale * exp_in_0).raw(),
+                                        exponent) +
+          static_cast<int32_t>(std::numeric_limits<OutputT>::min());
+      output_row[c] = static_cast<OutputT>(std::min(
+          unsat_output,
+          static_cast<int32_t>(std::numeric_limits<OutputT>::max())));
     }
   }
 }
 
 void* SoftmaxInit(TfLiteContext* context, const char* buffer, size_t length) {
   TFLITE_DCHECK(context->AllocatePersistentBuffer != nullptr);
-  return context->AllocatePersistentBuffer(context, sizeof(SoftmaxParams));
+  return context->AllocatePersistentBuffer(context, sizeof(OpData));
 }
 
 TfLiteStatus SoftmaxPrepare(TfLiteContext* context, TfLiteNode* node) {
@@ -124,8 +193,18 @@ TfLiteStatus SoftmaxPrepare(TfLiteContext* context, TfLiteNode* node) {
   TfLiteTensor* output = GetOutput(context, node, 0);
 
   TFLITE_DCHECK(node->user_data != nullptr);
-  SoftmaxParams* data = static_cast<SoftmaxParams*>(node->user_data);
-  return CalculateSoftmaxParams(context, input, output, params, data);
+  OpData* data = static_cast<OpData*>(node->user_data);
+  TF_LITE_ENSURE_STATUS(
+      CalculateSoftmaxParams(context, input, output, params, &data->params));
+
+  data->exp_lut = nullptr;
+  if (input->type == kTfLiteInt8) {
+    data->exp_lut = static_cast<int32_t*>(context->AllocatePersistentBuffer(
+        context, kExpLutSize * sizeof(int32_t)));
+    TF_LITE_ENSURE(context, data->exp_lut != nullptr);
+    PopulateExpLut(data->params, data->exp_lut);
+  }
+  return kTfLiteOk;
 }
 
 TfLiteStatus SoftmaxEval(TfLiteContext* context, TfLiteNode* node) {
@@ -133,16 +212,23 @@ TfLiteStatus SoftmaxEval(TfLiteContext* context, TfLiteNode* node) {
   TfLiteEvalTensor* output = tflite::micro::GetEvalOutput(context, node, 0);
 
   TFLITE_DCHECK(node->user_data != nullptr);
-  SoftmaxParams* data = static_cast<SoftmaxParams*>(node->user_data);
+  const OpData& data = *(static_cast<const OpData*>(node->user_data));
 
   switch (input->type) {
     case kTfLiteFloat32: {
-      SoftmaxFloat(input, output, *data);
+      SoftmaxFloat(input, output, data.params);
+      return kTfLiteOk;
+    }
+    case kTfLiteInt8: {
+      if (output->type == kTfLiteInt16) {
+        SoftmaxInt8Lut<int16_t>(input, output, data);
+      } else {
+        SoftmaxInt8Lut<int8_t>(input, output, data);
+      }
       return kTfLiteOk;
     }
-    case kTfLiteInt8:
     case kTfLiteUInt8: {
-      SoftmaxQuantized(input, output, *data);
+      SoftmaxQuantized(input, output, data.params);
       return kTfLiteOk;
     }
     default:
@@ -0,0 +1,212 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/micro/memory_planner/best_fit_memory_planner.h"
+
+#include <cstdint>
+
+namespace tflite {
+
+BestFitMemoryPlanner::BestFitMemoryPlanner(unsigned char* scratch_buffer,
+                                           int scratch_buffer_size)
+    : buffer_count_(0),
+      maximum_memory_size_(0),
+      need_to_calculate_offsets_(true) {
+  // Allocate the arrays we need within the scratch buffer arena.
+  max_buffer_count_ = scratch_buffer_size / per_buffer_size();
+
+  unsigned char* next_free = scratch_buffer;
+  requirements_ = reinterpret_cast<BufferRequirements*>(next_free);
+  next_free += sizeof(BufferRequirements) * max_buffer_count_;
+
+  buffer_ids_sorted_ = reinterpret_cast<int*>(next_free);
+  next_free += sizeof(int) * max_buffer_count_;
+
+  buffer_ids_by_offset_ = reinterpret_cast<int*>(next_free);
+  next_free += sizeof(int) * max_buffer_count_;
+
+  pass_offsets_ = reinterpret_cast<int*>(next_free);
+  next_free += sizeof(int) * max_buffer_count_;
+
+  buffer_offsets_ = reinterpret_cast<int*>(next_free);
+}
+
+BestFitMemoryPlanner::~BestFitMemoryPlanner() {
+  // We don't own the scratch buffer, so don't deallocate anything.
+}
+
+TfLiteStatus BestFitMemoryPlanner::AddBuffer(
+    tflite::ErrorReporter* error_reporter, int size, int first_time_used,
+    int last_time_used) {
+  return AddBuffer(error_reporter, size, first_time_used, last_time_used,
+                   kOnlinePlannedBuffer);
+}
+
+TfLiteStatus BestFitMemoryPlanner::AddBuffer(
+    tflite::ErrorReporter* error_reporter, int size, int first_time_used,
+    int last_time_used, int offline_offset) {
+  if (buffer_count_ >= max_buffer_count_) {
+    TF_LITE_REPORT_ERROR(error_reporter, "Too many buffers (max is %d)",
+                         max_buffer_count_);
+    return kTfLiteError;
+  }
+  BufferRequirements* current = &requirements_[buffer_count_];
+  current->size = size;
+  current->offline_offset = offline_offset;
+  current->first_time_used = first_time_used;
+  current->last_time_used = last_time_used;
+  ++buffer_count_;
+  need_to_calculate_offsets_ = true;
+  return kTfLiteOk;
+}
+
+void BestFitMemoryPlanner::SortBuffers(Order order) {
+  // GreedyMemoryPlanner lists the online planned buffers from the last one
+  // added and sorts them stably, start from the same list for the same ties.
+  int online_start = 0;
+  for (int i = 0; i < buffer_count_; ++i) {
+    if (requirements_[i].offline_offset != kOnlinePlannedBuffer) {
+      buffer_ids_sorted_[online_start++] = i;
+    }
+  }
+  int next = online_start;
+  for (int i = buffer_count_ - 1; i >= 0; --i) {
+    if (requirements_[i].offline_offset == kOnlinePlannedBuffer) {
+      buffer_ids_sorted_[next++] = i;
+    }
+  }
+
+  // Stable insertion sort in descending order of the key.
+  auto key = [this, order](int buffer_id) {
+    const BufferRequirements& requirements = requirements_[buffer_id];
+    int64_t value = requirements.size;
+    if (order == Order::kSizeTimesLifetime) {
+      value *= requirements.last_time_used - requirements.first_time_used + 1;
+    }
+    return value;
+  };
+  for (int i = online_start + 1; i < buffer_count_; ++i) {
+    const int buffer_id = buffer_ids_sorted_[i];
+    const int64_t value = key(buffer_id);
+    int j = i;
+    for (; j > online_start && key(buffer_ids_sorted_[j - 1]) < value; --j) {
+      buffer_ids_sorted_[j] = buffer_ids_sorted_[j - 1];
+    }
+    buffer_ids_sorted_[j] = buffer_id;
+  }
+}
+
+int BestFitMemoryPlanner::PlaceBuffers(bool best_fit) {
+  int placed_count = 0;
+  int memory_size = 0;
+  for (int i = 0; i < buffer_count_; ++i) {
+    const int buffer_id = buffer_ids_sorted_[i];
+    const BufferRequirements& wanted = requirements_[buffer_id];
+
+    int offset = wanted.offline_offset;
+    if (offset == kOnlinePlannedBuffer) {
+      // Walk the placed buffers that are active at the same time by offset,
+      // the gaps are between the end of those passed so far and the next.
+      int gap_start = 0;
+      int best_gap = -1;
+      for (int p = 0; p < placed_count; ++p) {
+        const int placed_id = buffer_ids_by_offset_[p];
+        const BufferRequirements& placed = requirements_[placed_id];
+        if (placed.first_time_used > wanted.last_time_used ||
+            wanted.first_time_used > placed.last_time_used) {
+          continue;
+        }
+        const int gap = pass_offsets_[placed_id] - gap_start;
+        if (gap >= wanted.size && (best_gap == -1 || gap < best_gap)) {
+          best_gap = gap;
+          offset = gap_start;
+          if (!best_fit || gap == wanted.size) break;
+        }
+        const int placed_end = pass_offsets_[placed_id] + placed.size;
+        if (placed_end > gap_start) {
+          gap_start = placed_end;
+        }
+      }
+      // No gap is large enough, place it after the active buffers.
+      if (best_gap == -1) {
+        offset = gap_start;
+      }
+    }
+    pass_offsets_[buffer_id] = offset;
+    if (offset + wanted.size > memory_size) {
+      memory_size = offset + wanted.size;
+    }
+
+    // Keep the placed buffers ordered by offset.
+    int p = placed_count;
+    for (; p > 0 && pass_offsets_[buffer_ids_by_offset_[p - 1]] > offset;
+         --p) {
+      buffer_ids_by_offset_[p] = buffer_ids_by_offset_[p - 1];
+    }
+    buffer_ids_by_offset_[p] = buffer_id;
+    ++placed_count;
+  }
+  return memory_size;
+}
+
+void BestFitMemoryPlanner::CalculateOffsetsIfNeeded() {
+  if (!need_to_calculate_offsets_ || (buffer_count_ == 0)) {
+    return;
+  }
+  need_to_calculate_offsets_ = false;
+
+  // The first pass is the layout of GreedyMemoryPlanner.
+  const Order orders[] = {Order::kSize, Order::kSizeTimesLifetime};
+  const bool best_fits[] = {false, true};
+  bool first_pass = true;
+  for (Order order : orders) {
+    SortBuffers(order);
+    for (bool best_fit : best_fits) {
+      const int memory_size = PlaceBuffers(best_fit);
+      if (first_pass || memory_size < maximum_memory_size_) {
+        maximum_memory_size_ = memory_size;
+        for (int i = 0; i < buffer_count_; ++i) {
+          buffer_offsets_[i] = pass_offsets_[i];
+        }
+      }
+      first_pass = false;
+    }
+  }
+}
+
+size_t BestFitMemoryPlanner::GetMaximumMemorySize() {
+  CalculateOffsetsIfNeeded();
+  if (buffer_count_ == 0) {
+    return 0;
+  }
+  return maximum_memory_size_;
+}
+
+int BestFitMemoryPlanner::GetBufferCount() { return buffer_count_; }
+
+TfLiteStatus BestFitMemoryPlanner::GetOffsetForBuffer(
+    tflite::ErrorReporter* error_reporter, int buffer_index, int* offset) {
+  CalculateOffsetsIfNeeded();
+  if ((buffer_index < 0) || (buffer_index >= buffer_count_)) {
+    TF_LITE_REPORT_ERROR(error_reporter,
+                         "buffer index %d is outside range 0 to %d",
+                         buffer_index, buffer_count_);
+    return kTfLiteError;
+  }
+  *offset = buffer_offsets_[buffer_index];
+  return kTfLiteOk;
+}
+
+}  // namespace tflite
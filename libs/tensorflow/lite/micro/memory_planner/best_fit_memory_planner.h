@@ -0,0 +1,114 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_MICRO_MEMORY_PLANNER_BEST_FIT_MEMORY_PLANNER_H_
+#define TENSORFLOW_LITE_MICRO_MEMORY_PLANNER_BEST_FIT_MEMORY_PLANNER_H_
+
+#include "tensorflow/lite/micro/compatibility.h"
+#include "tensorflow/lite/micro/memory_planner/memory_planner.h"
+
+namespace tflite {
+
+// A memory planner that lays the buffers out several times and keeps the
+// smallest layout.
+//
+// Each pass places the offline planned buffers at their offsets, then the
+// others one by one in an order, each into a gap between the buffers placed
+// so far that are active at the same time, or after the last of them:
+//  - The orders are descending size, as GreedyMemoryPlanner, and descending
+//    size times lifetime, which places the long lived buffers first so the
+//    short lived ones share the space around them.
+//  - The gap is either the first one large enough, as GreedyMemoryPlanner,
+//    or the smallest one large enough (best fit), which keeps the large gaps
+//    for the large buffers.
+// The pass with the order and the gap choice of GreedyMemoryPlanner gives
+// its layout, so the result is never larger than that of
+// GreedyMemoryPlanner, for four times its planning time.
+class BestFitMemoryPlanner : public MemoryPlanner {
+ public:
+  // As GreedyMemoryPlanner, the planner works in `scratch_buffer`, which must
+  // outlive it. Each buffer requires per_buffer_size() bytes of scratch.
+  BestFitMemoryPlanner(unsigned char* scratch_buffer, int scratch_buffer_size);
+  ~BestFitMemoryPlanner() override;
+
+  TfLiteStatus AddBuffer(tflite::ErrorReporter* error_reporter, int size,
+                         int first_time_used, int last_time_used) override;
+  TfLiteStatus AddBuffer(tflite::ErrorReporter* error_reporter, int size,
+                         int first_time_used, int last_time_used,
+                         int offline_offset) override;
+
+  size_t GetMaximumMemorySize() override;
+  int GetBufferCount() override;
+  TfLiteStatus GetOffsetForBuffer(tflite::ErrorReporter* error_reporter,
+                                  int buffer_index, int* offset) override;
+
+  // Number of bytes required in order to plan a buffer.
+  static size_t per_buffer_size() {
+    const int per_buffer_size =
+        sizeof(BufferRequirements) +  // requirements_
+        sizeof(int) +                 // buffer_ids_sorted_
+        sizeof(int) +                 // buffer_ids_by_offset_
+        sizeof(int) +                 // pass_offsets_
+        sizeof(int);                  // buffer_offsets_
+    return per_buffer_size;
+  }
+
+ private:
+  enum class Order { kSize, kSizeTimesLifetime };
+
+  // Sorts buffer_ids_sorted_: offline planned buffers first, the others in
+  // `order`, with ties in the order GreedyMemoryPlanner breaks them.
+  void SortBuffers(Order order);
+
+  // Places the buffers in the order of buffer_ids_sorted_ into
+  // pass_offsets_, returns the size of the layout.
+  int PlaceBuffers(bool best_fit);
+
+  // If there isn't an up to date plan, calculate a new one.
+  void CalculateOffsetsIfNeeded();
+
+  // Records the client-provided information about each buffer.
+  struct BufferRequirements {
+    int size;
+    int offline_offset;
+    int first_time_used;
+    int last_time_used;
+  };
+
+  // How many buffers we can plan for, based on the arena size we're given in
+  // the constructor.
+  int max_buffer_count_;
+  // The number of buffers added so far.
+  int buffer_count_;
+
+  BufferRequirements* requirements_;
+  // The buffers in the order a pass places them.
+  int* buffer_ids_sorted_;
+  // The buffers placed so far in a pass, by ascending offset.
+  int* buffer_ids_by_offset_;
+  // The layout of the current pass, and the smallest one.
+  int* pass_offsets_;
+  int* buffer_offsets_;
+  int maximum_memory_size_;
+
+  // Whether buffers have been added since the last plan was calculated.
+  bool need_to_calculate_offsets_;
+
+  TF_LITE_REMOVE_VIRTUAL_DELETE
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_MICRO_MEMORY_PLANNER_BEST_FIT_MEMORY_PLANNER_H_
@@ -21,8 +21,6 @@ limitations under the License.
 
 namespace tflite {
 
-constexpr int kOnlinePlannedBuffer = -1;
-
 // A memory planner that uses a greedy algorithm to arrange buffers in memory
 // to minimize the overall arena size needed.
 //
@@ -65,7 +63,7 @@ class GreedyMemoryPlanner : public MemoryPlanner {
   // offline_offset is the buffer offset from the start of the arena.
   TfLiteStatus AddBuffer(ErrorReporter* error_reporter, int size,
                          int first_time_used, int last_time_used,
-                         int offline_offset);
+                         int offline_offset) override;
 
   // Returns the high-water mark of used memory. This is the minimum size of a
   // memory arena you'd need to allocate to hold these buffers.
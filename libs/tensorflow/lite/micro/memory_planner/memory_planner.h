@@ -21,6 +21,9 @@ limitations under the License.
 
 namespace tflite {
 
+// The offline_offset of a buffer that the planner places.
+constexpr int kOnlinePlannedBuffer = -1;
+
 // Interface class for planning the layout of memory buffers during the
 // execution of a graph.
 // It's designed to be used by a client that iterates in any order through the
@@ -57,6 +60,22 @@ class MemoryPlanner {
                                  int size, int first_time_used,
                                  int last_time_used) = 0;
 
+  // Pass a buffer that must be placed at offline_offset, the buffer offset
+  // from the start of the arena (see OfflineMemoryAllocation in
+  // micro_allocator.cc), or kOnlinePlannedBuffer to let the planner place it.
+  // Planners that only place buffers themselves report an error.
+  virtual TfLiteStatus AddBuffer(tflite::ErrorReporter* error_reporter,
+                                 int size, int first_time_used,
+                                 int last_time_used, int offline_offset) {
+    if (offline_offset == kOnlinePlannedBuffer) {
+      return AddBuffer(error_reporter, size, first_time_used, last_time_used);
+    }
+    TF_LITE_REPORT_ERROR(error_reporter,
+                         "This memory planner can not place offline planned "
+                         "buffers");
+    return kTfLiteError;
+  }
+
   // The largest contiguous block of memory that's needed to hold the layout.
   virtual size_t GetMaximumMemorySize() = 0;
   // How many buffers have been added to the planner.
@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/lite/micro/micro_allocator.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 
@@ -27,8 +28,10 @@ limitations under the License.
 #include "tensorflow/lite/kernels/internal/compatibility.h"
 #include "tensorflow/lite/micro/compatibility.h"
 #include "tensorflow/lite/micro/memory_helpers.h"
+#include "tensorflow/lite/micro/memory_planner/best_fit_memory_planner.h"
 #include "tensorflow/lite/micro/memory_planner/greedy_memory_planner.h"
 #include "tensorflow/lite/micro/memory_planner/memory_planner.h"
+#include "tensorflow/lite/micro/micro_graph_fusion.h"
 #include "tensorflow/lite/micro/micro_op_resolver.h"
 #include "tensorflow/lite/micro/simple_memory_allocator.h"
 #include "tensorflow/lite/schema/schema_generated.h"
@@ -36,20 +39,16 @@ limitations under the License.
 namespace tflite {
 
 namespace {
-// Used to hold information used during allocation calculations.
-struct AllocationInfo {
-  size_t bytes;
-  void** output_ptr;
-  int first_created;
-  int last_used;
-  int32_t offline_offset;
-  bool needs_allocating;
-};
+
+using internal::AllocationInfo;
 
 // We align tensor buffers to 16-byte boundaries, since this is a common
 // requirement for SIMD extensions.
 constexpr int kBufferAlignment = 16;
 constexpr char kOfflineMemAllocMetadata[] = "OfflineMemoryAllocation";
+// Scratch buffer requests the head has room for during the Prepare of one
+// node, see MicroAllocator::ReserveScratchBufferRequests().
+constexpr size_t kMaxScratchBuffersPerOp = 12;
 const TfLiteIntArray kZeroLengthIntArray = {0, {}};
 
 class MicroBuiltinDataAllocator : public BuiltinDataAllocator {
@@ -138,6 +137,19 @@ TfLiteStatus CheckOfflinePlannedOffsets(const Model* model,
 }
 #endif
 
+// Returns true for ops whose output has the bytes of their first input in
+// another shape, so both tensors can share one buffer.
+bool IsShapeOnlyOp(const TfLiteRegistration* registration) {
+  switch (registration->builtin_code) {
+    case BuiltinOperator_EXPAND_DIMS:
+    case BuiltinOperator_RESHAPE:
+    case BuiltinOperator_SQUEEZE:
+      return true;
+    default:
+      return false;
+  }
+}
+
 // A helper class to construct AllocationInfo array. This array contains the
 // lifetime of tensors / scratch_buffer and will be used to calculate the memory
 // plan. Methods need to be called in order from `Init`, `Add*`, to `Finish`.
@@ -162,8 +174,10 @@ class AllocationInfoBuilder {
   TfLiteStatus GetOfflinePlannedOffsets(
       const Model* model, const int32_t** offline_planner_offsets);
 
-  // Add allocaiton information for the tensors.
+  // Add allocaiton information for the tensors. Lifetimes follow the nodes
+  // (which may be fused, see FuseOperators()) rather than the model operators.
   TfLiteStatus AddTensors(const SubGraph* subgraph,
+                          const NodeAndRegistration* node_and_registrations,
                           const int32_t* offline_offsets,
                           TfLiteEvalTensor* eval_tensors);
 
@@ -199,9 +213,10 @@ TfLiteStatus AllocationInfoBuilder::Allocate() {
   return kTfLiteOk;
 }
 
-TfLiteStatus AllocationInfoBuilder::AddTensors(const SubGraph* subgraph,
-                                               const int32_t* offline_offsets,
-                                               TfLiteEvalTensor* eval_tensors) {
+TfLiteStatus AllocationInfoBuilder::AddTensors(
+    const SubGraph* subgraph, const NodeAndRegistration* node_and_registrations,
+    const int32_t* offline_offsets, TfLiteEvalTensor* eval_tensors) {
+  TFLITE_DCHECK(node_and_registrations != nullptr);
   TFLITE_DCHECK(eval_tensors != nullptr);
 
   // Set up allocation info for all tensors.
@@ -214,6 +229,7 @@ TfLiteStatus AllocationInfoBuilder::AddTensors(const SubGraph* subgraph,
 
     current->first_created = -1;
     current->last_used = -1;
+    current->alias_of = -1;
     current->needs_allocating = (eval_tensors[i].data.data == nullptr) &&
                                 (!subgraph->tensors()->Get(i)->is_variable());
     if (offline_offsets) {
@@ -238,16 +254,20 @@ TfLiteStatus AllocationInfoBuilder::AddTensors(const SubGraph* subgraph,
 
   // Figure out when the first and last use of each tensor is.
   for (int i = (subgraph->operators()->size() - 1); i >= 0; --i) {
-    const auto* op = subgraph->operators()->Get(i);
-    for (size_t n = 0; n < op->inputs()->size(); ++n) {
-      const int tensor_index = op->inputs()->Get(n);
+    const TfLiteNode& node = node_and_registrations[i].node;
+    for (int n = 0; n < node.inputs->size; ++n) {
+      const int tensor_index = node.inputs->data[n];
+      if (tensor_index < 0) {
+        // Optional input that is not present.
+        continue;
+      }
       AllocationInfo* current = &info_[tensor_index];
       if (((current->last_used == -1) || (current->last_used < i))) {
         current->last_used = i;
       }
     }
-    for (size_t n = 0; n < op->outputs()->size(); ++n) {
-      const int tensor_index = op->outputs()->Get(n);
+    for (int n = 0; n < node.outputs->size; ++n) {
+      const int tensor_index = node.outputs->data[n];
       AllocationInfo* current = &info_[tensor_index];
       if ((current->first_created == -1) || (current->first_created > i)) {
         current->first_created = i;
@@ -263,6 +283,12 @@ TfLiteStatus AllocationInfoBuilder::AddTensors(const SubGraph* subgraph,
     if (is_read_only) {
       current->needs_allocating = false;
     }
+    // No node reads or writes it, e.g. one between the ops of a fused node.
+    const bool is_unused =
+        (current->first_created == -1) && (current->last_used == -1);
+    if (is_unused) {
+      current->needs_allocating = false;
+    }
     const bool has_partial_lifetime =
         !is_read_only &&
         ((current->first_created == -1) || (current->last_used == -1));
@@ -275,6 +301,33 @@ TfLiteStatus AllocationInfoBuilder::AddTensors(const SubGraph* subgraph,
       return kTfLiteError;
     }
   }
+
+  // The output of an op that only changes the shape shares the buffer of its
+  // input, which then lives as long as both. Chains share the first buffer.
+  for (size_t i = 0; i < subgraph->operators()->size(); ++i) {
+    const NodeAndRegistration& node_and_registration =
+        node_and_registrations[i];
+    const TfLiteNode& node = node_and_registration.node;
+    if (!IsShapeOnlyOp(node_and_registration.registration) ||
+        node.inputs->size < 1 || node.outputs->size != 1) {
+      continue;
+    }
+    AllocationInfo* output = &info_[node.outputs->data[0]];
+    int input_index = node.inputs->data[0];
+    if (info_[input_index].alias_of != -1) {
+      input_index = info_[input_index].alias_of;
+    }
+    AllocationInfo* input = &info_[input_index];
+    if (!input->needs_allocating || !output->needs_allocating ||
+        input->offline_offset != kOnlinePlannedBuffer ||
+        output->offline_offset != kOnlinePlannedBuffer ||
+        input->bytes != output->bytes) {
+      continue;
+    }
+    output->needs_allocating = false;
+    output->alias_of = input_index;
+    input->last_used = std::max(input->last_used, output->last_used);
+  }
   return kTfLiteOk;
 }
 
@@ -339,12 +392,12 @@ TfLiteStatus AllocationInfoBuilder::AddScratchBuffers(
     current->last_used = handle->node_idx;
     current->needs_allocating = true;
     current->offline_offset = kOnlinePlannedBuffer;
+    current->alias_of = -1;
   }
   return kTfLiteOk;
 }
 
-TfLiteStatus CreatePlan(ErrorReporter* error_reporter,
-                        GreedyMemoryPlanner* planner,
+TfLiteStatus CreatePlan(ErrorReporter* error_reporter, MemoryPlanner* planner,
                         const AllocationInfo* allocation_info,
                         size_t allocation_info_size) {
   // Add the tensors to our allocation plan.
@@ -383,6 +436,36 @@ TfLiteStatus CommitPlan(ErrorReporter* error_reporter, MemoryPlanner* planner,
       ++planner_index;
     }
   }
+  for (size_t i = 0; i < allocation_info_size; ++i) {
+    const AllocationInfo* current = &allocation_info[i];
+    if (current->alias_of != -1) {
+      *current->output_ptr = *allocation_info[current->alias_of].output_ptr;
+    }
+  }
+  return kTfLiteOk;
+}
+
+// Plans the buffers with `planner` and commits the plan to the head at
+// `starting_point`, which has `available_size` bytes.
+TfLiteStatus PlanAndCommit(ErrorReporter* error_reporter,
+                           MemoryPlanner* planner, uint8_t* starting_point,
+                           size_t available_size,
+                           const AllocationInfo* allocation_info,
+                           size_t allocation_info_size, size_t* head_usage) {
+  TF_LITE_ENSURE_STATUS(CreatePlan(error_reporter, planner, allocation_info,
+                                   allocation_info_size));
+  // Make sure we have enough arena size.
+  if (planner->GetMaximumMemorySize() > available_size) {
+    TF_LITE_REPORT_ERROR(
+        error_reporter,
+        "Arena size is too small for activation buffers. Needed %d but only "
+        "%d was available.",
+        planner->GetMaximumMemorySize(), available_size);
+    return kTfLiteError;
+  }
+  TF_LITE_ENSURE_STATUS(CommitPlan(error_reporter, planner, starting_point,
+                                   allocation_info, allocation_info_size));
+  *head_usage = planner->GetMaximumMemorySize();
   return kTfLiteOk;
 }
 }  // namespace
@@ -605,15 +688,18 @@ TfLiteStatus InitializeTfLiteEvalTensorFromFlatbuffer(
 }  // namespace internal
 
 MicroAllocator::MicroAllocator(SimpleMemoryAllocator* memory_allocator,
-                               ErrorReporter* error_reporter)
+                               ErrorReporter* error_reporter,
+                               MemoryPlannerType memory_planner_type)
     : memory_allocator_(memory_allocator),
       error_reporter_(error_reporter),
+      memory_planner_type_(memory_planner_type),
       model_is_allocating_(false) {}
 
 MicroAllocator::~MicroAllocator() {}
 
 MicroAllocator* MicroAllocator::Create(uint8_t* tensor_arena, size_t arena_size,
-                                       ErrorReporter* error_reporter) {
+                                       ErrorReporter* error_reporter,
+                                       MemoryPlannerType memory_planner_type) {
   uint8_t* aligned_arena = AlignPointerUp(tensor_arena, kBufferAlignment);
   if (aligned_arena != tensor_arena) {
     TF_LITE_REPORT_ERROR(
@@ -625,18 +711,20 @@ MicroAllocator* MicroAllocator::Create(uint8_t* tensor_arena, size_t arena_size,
   size_t aligned_arena_size = tensor_arena + arena_size - aligned_arena;
   return Create(SimpleMemoryAllocator::Create(error_reporter, aligned_arena,
                                               aligned_arena_size),
-                error_reporter);
+                error_reporter, memory_planner_type);
 }
 
 MicroAllocator* MicroAllocator::Create(SimpleMemoryAllocator* memory_allocator,
-                                       ErrorReporter* error_reporter) {
+                                       ErrorReporter* error_reporter,
+                                       MemoryPlannerType memory_planner_type) {
   TFLITE_DCHECK(memory_allocator != nullptr);
   TFLITE_DCHECK(error_reporter != nullptr);
 
   uint8_t* allocator_buffer = memory_allocator->AllocateFromTail(
       sizeof(MicroAllocator), alignof(MicroAllocator));
   MicroAllocator* allocator =
-      new (allocator_buffer) MicroAllocator(memory_allocator, error_reporter);
+      new (allocator_buffer)
+          MicroAllocator(memory_allocator, error_reporter, memory_planner_type);
   return allocator;
 }
 
@@ -655,11 +743,16 @@ TfLiteStatus MicroAllocator::StartModelAllocation(
 
   model_is_allocating_ = true;
 
+  TF_LITE_ENSURE_STATUS(ReserveScratchBufferRequests());
   TF_LITE_ENSURE_STATUS(AllocateTfLiteEvalTensors(model, eval_tensors));
   TF_LITE_ENSURE_STATUS(
       AllocateNodeAndRegistrations(model, node_and_registrations));
   TF_LITE_ENSURE_STATUS(PrepareNodeAndRegistrationDataFromFlatbuffer(
       model, op_resolver, *node_and_registrations));
+  TF_LITE_ENSURE_STATUS(FuseOperators(model, op_resolver, memory_allocator_,
+                                      *node_and_registrations,
+                                      error_reporter_));
+  node_and_registrations_ = *node_and_registrations;
 
   return kTfLiteOk;
 }
@@ -676,6 +769,7 @@ TfLiteStatus MicroAllocator::FinishModelAllocation(
   const SubGraph* subgraph = GetSubGraphFromModel(model);
   TFLITE_DCHECK(subgraph != nullptr);
 
+  TF_LITE_ENSURE_STATUS(AllocateScratchBufferHandles());
   TF_LITE_ENSURE_STATUS(CommitStaticMemoryPlan(model, subgraph, eval_tensors));
   TF_LITE_ENSURE_STATUS(AllocateVariables(subgraph, eval_tensors));
 
@@ -690,40 +784,35 @@ void* MicroAllocator::AllocatePersistentBuffer(size_t bytes) {
 TfLiteStatus MicroAllocator::RequestScratchBufferInArena(int node_id,
                                                          size_t bytes,
                                                          int* buffer_idx) {
-  // A consistency check to make sure scratch_buffer_handles_ is contiguous i.e.
-  // scratch_buffer_handles_ is pointing to the last allocation from memory
-  // allocator.
-  if (scratch_buffer_handles_ != nullptr &&
-      reinterpret_cast<uint8_t*>(scratch_buffer_handles_) !=
-          memory_allocator_->GetTail()) {
+  // The requests stay in the head until FinishModelAllocation(), so that the
+  // persistent buffers a kernel allocates from the tail in Prepare (e.g. a
+  // folded bias) do not split them. The room for them only grows between
+  // two nodes, when no temp allocation is above the head.
+  internal::ScratchBufferHandle* requests = GetScratchBufferRequests();
+  const size_t capacity =
+      (memory_allocator_->GetHead() - reinterpret_cast<uint8_t*>(requests)) /
+      sizeof(internal::ScratchBufferHandle);
+  if (scratch_buffer_count_ >= capacity) {
     TF_LITE_REPORT_ERROR(error_reporter_,
-                         "Internal error: AllocateFromTail can not be called "
-                         "between two RequestScratchBufferInArena calls.");
+                         "Node %d requested more than %d scratch buffers",
+                         node_id, kMaxScratchBuffersPerOp);
     return kTfLiteError;
   }
 
-  internal::ScratchBufferHandle* handle =
-      reinterpret_cast<internal::ScratchBufferHandle*>(
-          memory_allocator_->AllocateFromTail(
-              sizeof(internal::ScratchBufferHandle),
-              alignof(internal::ScratchBufferHandle)));
-  if (handle == nullptr) {
-    TF_LITE_REPORT_ERROR(error_reporter_,
-                         "Failed to register scratch buffer handle for node %s",
-                         node_id);
-    return kTfLiteError;
-  }
+  internal::ScratchBufferHandle* handle = &requests[scratch_buffer_count_];
   *handle = {};
   handle->bytes = bytes;
   handle->node_idx = node_id;
   *buffer_idx = scratch_buffer_count_;
   scratch_buffer_count_ += 1;
-  // scratch_buffer_handles_ is in reverse order. The following code ensures
-  // that scratch_buffers[0] is pointing to the newly allocated handle.
-  scratch_buffer_handles_ = handle;
   return kTfLiteOk;
 }
 
+TfLiteStatus MicroAllocator::FinishPrepareNodeAllocations() {
+  ResetTempAllocations();
+  return ReserveScratchBufferRequests();
+}
+
 void* MicroAllocator::GetScratchBuffer(int buffer_idx) const {
   if (static_cast<size_t>(buffer_idx) >= scratch_buffer_count_) {
     TF_LITE_REPORT_ERROR(error_reporter_,
@@ -735,6 +824,42 @@ void* MicroAllocator::GetScratchBuffer(int buffer_idx) const {
   return scratch_buffer_handles_[scratch_buffer_count_ - buffer_idx - 1].data;
 }
 
+internal::ScratchBufferHandle* MicroAllocator::GetScratchBufferRequests()
+    const {
+  return reinterpret_cast<internal::ScratchBufferHandle*>(
+      AlignPointerUp(memory_allocator_->GetBufferHead(),
+                     alignof(internal::ScratchBufferHandle)));
+}
+
+TfLiteStatus MicroAllocator::ReserveScratchBufferRequests() {
+  return memory_allocator_->SetHeadSize(
+      sizeof(internal::ScratchBufferHandle) *
+          (scratch_buffer_count_ + kMaxScratchBuffersPerOp),
+      alignof(internal::ScratchBufferHandle));
+}
+
+TfLiteStatus MicroAllocator::AllocateScratchBufferHandles() {
+  if (scratch_buffer_count_ > 0) {
+    internal::ScratchBufferHandle* handles =
+        reinterpret_cast<internal::ScratchBufferHandle*>(
+            memory_allocator_->AllocateFromTail(
+                sizeof(internal::ScratchBufferHandle) * scratch_buffer_count_,
+                alignof(internal::ScratchBufferHandle)));
+    if (handles == nullptr) {
+      TF_LITE_REPORT_ERROR(error_reporter_,
+                           "Failed to allocate %d scratch buffer handles",
+                           scratch_buffer_count_);
+      return kTfLiteError;
+    }
+    // scratch_buffer_handles_ is in reverse order.
+    const internal::ScratchBufferHandle* requests = GetScratchBufferRequests();
+    std::reverse_copy(requests, requests + scratch_buffer_count_, handles);
+    scratch_buffer_handles_ = handles;
+  }
+  // CommitStaticMemoryPlan() plans the head from its start.
+  return memory_allocator_->SetHeadSize(0, kBufferAlignment);
+}
+
 size_t MicroAllocator::used_bytes() const {
   return memory_allocator_->GetUsedBytes();
 }
@@ -1014,7 +1139,8 @@ TfLiteStatus MicroAllocator::CommitStaticMemoryPlan(
   size_t head_usage = 0;
   // Create static memory plan
   // 1. Calculate AllocationInfo to know the lifetime of each tensor/buffer.
-  // 2. Add them into the planner (such as the GreedyMemoryPlanner).
+  // 2. Add them into the planner (GreedyMemoryPlanner or BestFitMemoryPlanner,
+  //    see MemoryPlannerType).
   // 3. Static memory planning using the planner.
   // 4. Set tensor/buffer pointers based on the offsets from the previous step.
   // Note that AllocationInfo is only needed for creating the plan. It will be
@@ -1033,11 +1159,13 @@ TfLiteStatus MicroAllocator::CommitStaticMemoryPlan(
     const int32_t* offline_planner_offsets = nullptr;
     TF_LITE_ENSURE_STATUS(
         builder.GetOfflinePlannedOffsets(model, &offline_planner_offsets));
-    TF_LITE_ENSURE_STATUS(
-        builder.AddTensors(subgraph, offline_planner_offsets, eval_tensors));
+    TF_LITE_ENSURE_STATUS(builder.AddTensors(subgraph, node_and_registrations_,
+                                             offline_planner_offsets,
+                                             eval_tensors));
 
     TF_LITE_ENSURE_STATUS(builder.AddScratchBuffers(scratch_buffer_handles_));
     const AllocationInfo* allocation_info = builder.Finish();
+    RecordAllocationInfo(allocation_info, builder.Size());
 
     // Remaining arena size that memory planner can use for calculating offsets.
     size_t remaining_arena_size =
@@ -1045,27 +1173,22 @@ TfLiteStatus MicroAllocator::CommitStaticMemoryPlan(
     uint8_t* planner_arena =
         tmp_allocator.AllocateTemp(remaining_arena_size, kBufferAlignment);
     TF_LITE_ENSURE(error_reporter_, planner_arena != nullptr);
-    GreedyMemoryPlanner planner(planner_arena, remaining_arena_size);
-    TF_LITE_ENSURE_STATUS(
-        CreatePlan(error_reporter_, &planner, allocation_info, builder.Size()));
 
     size_t actual_available_arena_size =
         memory_allocator_->GetAvailableMemory(kBufferAlignment);
-    // Make sure we have enough arena size.
-    if (planner.GetMaximumMemorySize() > actual_available_arena_size) {
-      TF_LITE_REPORT_ERROR(
-          error_reporter_,
-          "Arena size is too small for activation buffers. Needed %d but only "
-          "%d was available.",
-          planner.GetMaximumMemorySize(), actual_available_arena_size);
-      return kTfLiteError;
+    if (memory_planner_type_ == MemoryPlannerType::kBestFit) {
+      BestFitMemoryPlanner planner(planner_arena, remaining_arena_size);
+      TF_LITE_ENSURE_STATUS(PlanAndCommit(
+          error_reporter_, &planner, memory_allocator_->GetBufferHead(),
+          actual_available_arena_size, allocation_info, builder.Size(),
+          &head_usage));
+    } else {
+      GreedyMemoryPlanner planner(planner_arena, remaining_arena_size);
+      TF_LITE_ENSURE_STATUS(PlanAndCommit(
+          error_reporter_, &planner, memory_allocator_->GetBufferHead(),
+          actual_available_arena_size, allocation_info, builder.Size(),
+          &head_usage));
     }
-
-    // Commit the plan.
-    TF_LITE_ENSURE_STATUS(CommitPlan(error_reporter_, &planner,
-                                     memory_allocator_->GetBufferHead(),
-                                     allocation_info, builder.Size()));
-    head_usage = planner.GetMaximumMemorySize();
   }
 
   TF_LITE_ENSURE_STATUS(
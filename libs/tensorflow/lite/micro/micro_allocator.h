@@ -60,6 +60,21 @@ typedef struct {
   // have `before` = node_idx and `after` = node_idx.
   int node_idx;
 } ScratchBufferHandle;
+
+// The lifetime of one tensor or scratch buffer in the memory plan of the head
+// section, see MicroAllocator::RecordAllocationInfo().
+struct AllocationInfo {
+  size_t bytes;
+  void** output_ptr;
+  int first_created;
+  int last_used;
+  int32_t offline_offset;
+  bool needs_allocating;
+  // Index of the tensor whose buffer this one shares, or -1: the output of an
+  // op that only changes the shape (RESHAPE, SQUEEZE, EXPAND_DIMS) is not
+  // planned, it gets the buffer of its input.
+  int alias_of;
+};
 }  // namespace internal
 
 typedef struct {
@@ -67,6 +82,15 @@ typedef struct {
   const TfLiteRegistration* registration;
 } NodeAndRegistration;
 
+// The memory planner that lays out the head section of the arena.
+enum class MemoryPlannerType {
+  // GreedyMemoryPlanner.
+  kGreedy,
+  // BestFitMemoryPlanner, never larger than kGreedy, for about four times its
+  // planning time at AllocateTensors().
+  kBestFit,
+};
+
 // Allocator responsible for allocating memory for all intermediate tensors
 // necessary to invoke a model.
 //
@@ -97,18 +121,22 @@ class MicroAllocator {
   // Note: Please use __declspec(align(16)) to make sure tensor_arena is 16
   // bytes aligned, otherwise some head room will be wasted.
   // TODO(b/157615197): Cleanup constructor + factory usage.
-  static MicroAllocator* Create(uint8_t* tensor_arena, size_t arena_size,
-                                ErrorReporter* error_reporter);
+  static MicroAllocator* Create(
+      uint8_t* tensor_arena, size_t arena_size, ErrorReporter* error_reporter,
+      MemoryPlannerType memory_planner_type = MemoryPlannerType::kGreedy);
 
   // Creates a MicroAllocator instance using the provided SimpleMemoryAllocator
   // intance. This allocator instance will use the SimpleMemoryAllocator
   // instance to manage allocations internally.
-  static MicroAllocator* Create(SimpleMemoryAllocator* memory_allocator,
-                                ErrorReporter* error_reporter);
+  static MicroAllocator* Create(
+      SimpleMemoryAllocator* memory_allocator, ErrorReporter* error_reporter,
+      MemoryPlannerType memory_planner_type = MemoryPlannerType::kGreedy);
 
   // Begin allocating internal resources required for model inference.
   // This method will run through the flatbuffer data supplied in the model to
-  // properly allocate tensor, node, and op registration data. This method is
+  // properly allocate tensor, node, and op registration data, then fuses the
+  // node chains the op resolver has fused kernels for (see FuseOperators() in
+  // micro_graph_fusion.h). This method is
   // expected to be followed with a call to FinishModelAllocation() before
   // resuming allocation with another model. All persistent tensor buffers are
   // stored in the out-param eval_tensors. This value is allocated from the
@@ -160,20 +188,32 @@ class MicroAllocator {
   // This method only allocates a BufferHandle holding information for memory
   // planning. The buffer ptr is ready after `FinishModelAllocation` and can
   // be retrieved by `GetScratchBuffer` method using the returned buffer_idx.
-  // Note that there should be no tail allocation between two consecutive
-  // `RequestScratchBufferInArena` calls.
+  // The handles are kept in the head until `FinishModelAllocation`, a node
+  // may request at most 12 of them in its Prepare (kMaxScratchBuffersPerOp).
   TfLiteStatus RequestScratchBufferInArena(int node_id, size_t bytes,
                                            int* buffer_idx);
+  // Called after the Prepare of each node: resets the temp allocations and
+  // makes room in the head for the scratch buffer requests of the next node.
+  TfLiteStatus FinishPrepareNodeAllocations();
   // Returns the pointer to the planned scratch buffer.
   void* GetScratchBuffer(int buffer_idx) const;
 
+  // The scratch buffers requested so far, by buffer_idx. For the host tools
+  // that record a plan (see micro_static_plan.h).
+  size_t scratch_buffer_count() const { return scratch_buffer_count_; }
+  const internal::ScratchBufferHandle& scratch_buffer_handle(
+      int buffer_idx) const {
+    return scratch_buffer_handles_[scratch_buffer_count_ - buffer_idx - 1];
+  }
+
   // Returns the arena usage in bytes, only available after
   // `FinishModelAllocation`. Otherwise, it will return 0.
   size_t used_bytes() const;
 
  protected:
-  MicroAllocator(SimpleMemoryAllocator* memory_allocator,
-                 ErrorReporter* error_reporter);
+  MicroAllocator(
+      SimpleMemoryAllocator* memory_allocator, ErrorReporter* error_reporter,
+      MemoryPlannerType memory_planner_type = MemoryPlannerType::kGreedy);
   virtual ~MicroAllocator();
 
   // Allocates an array in the arena to hold pointers to the node and
@@ -218,6 +258,13 @@ class MicroAllocator {
 
   ErrorReporter* error_reporter() const;
 
+  // Called by CommitStaticMemoryPlan() with what it gives the memory planner:
+  // one AllocationInfo per tensor, then one per scratch buffer in the order of
+  // the handles. The array only lives for the call. Does nothing, the host
+  // tool that plans the arena offline records it (generate_offline_plan.cc).
+  virtual void RecordAllocationInfo(
+      const internal::AllocationInfo* allocation_info, size_t size) {}
+
   // Returns the first subgraph from the model.
   const SubGraph* GetSubGraphFromModel(const Model* model);
 
@@ -230,12 +277,28 @@ class MicroAllocator {
                                               const SubGraph* subgraph,
                                               TfLiteEvalTensor* eval_tensors);
 
+  // The scratch buffer handles requested so far, by buffer_idx, at the start
+  // of the head until AllocateScratchBufferHandles() copies them to the tail.
+  internal::ScratchBufferHandle* GetScratchBufferRequests() const;
+
+  // Sets the head to the requests so far plus kMaxScratchBuffersPerOp.
+  TfLiteStatus ReserveScratchBufferRequests();
+
+  // Copies the requests to scratch_buffer_handles_ in the tail and gives the
+  // head back to the memory plan.
+  TfLiteStatus AllocateScratchBufferHandles();
+
   // A simple memory allocator that always allocate from the arena tail or head.
   SimpleMemoryAllocator* memory_allocator_;
 
   ErrorReporter* error_reporter_;
+  MemoryPlannerType memory_planner_type_;
   bool model_is_allocating_;
 
+  // Nodes of the model being allocated, their inputs and outputs give the
+  // tensor lifetimes of the memory plan.
+  NodeAndRegistration* node_and_registrations_ = nullptr;
+
   // In reverse order for efficiency.
   // i.e. scratch_buffer_handles_[0] is the handle for the last buffer,
   // corresponding to the last RequestScratchBufferInArena call.
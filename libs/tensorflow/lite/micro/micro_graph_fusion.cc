@@ -0,0 +1,250 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/micro/micro_graph_fusion.h"
+
+#include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/core/api/error_reporter.h"
+#include "tensorflow/lite/micro/micro_allocator.h"
+#include "tensorflow/lite/micro/micro_op_resolver.h"
+#include "tensorflow/lite/micro/simple_memory_allocator.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace tflite {
+
+namespace {
+
+// Registration of the nodes merged into a fused node. Without callbacks the
+// interpreter skips them.
+const TfLiteRegistration kFusedRegistration = {/*init=*/nullptr,
+                                               /*free=*/nullptr,
+                                               /*prepare=*/nullptr,
+                                               /*invoke=*/nullptr,
+                                               /*profiling_string=*/nullptr,
+                                               /*builtin_code=*/
+                                               BuiltinOperator_CUSTOM,
+                                               /*custom_name=*/"FUSED",
+                                               /*version=*/0};
+
+const TfLiteIntArray kNoTensors = {0, {}};
+
+bool IsBuiltin(const NodeAndRegistration& node_and_registration,
+               BuiltinOperator op) {
+  return node_and_registration.registration->builtin_code == op;
+}
+
+int CountReaders(const NodeAndRegistration* node_and_registrations,
+                 int node_count, int tensor_index) {
+  int readers = 0;
+  for (int i = 0; i < node_count; ++i) {
+    const TfLiteIntArray* inputs = node_and_registrations[i].node.inputs;
+    for (int n = 0; n < inputs->size; ++n) {
+      if (inputs->data[n] == tensor_index) {
+        ++readers;
+      }
+    }
+  }
+  return readers;
+}
+
+// Returns true if the only output of node `producer` is an int8 tensor read
+// by the next node only, as its first input, and not by the application.
+bool IsFusableIntermediate(const SubGraph* subgraph,
+                           const NodeAndRegistration* node_and_registrations,
+                           int node_count, int producer) {
+  const TfLiteNode& node = node_and_registrations[producer].node;
+  const TfLiteNode& next = node_and_registrations[producer + 1].node;
+  if (node.outputs->size != 1 || next.inputs->size < 1) {
+    return false;
+  }
+  const int tensor_index = node.outputs->data[0];
+  if (next.inputs->data[0] != tensor_index) {
+    return false;
+  }
+
+  const Tensor* tensor = subgraph->tensors()->Get(tensor_index);
+  if (tensor->type() != TensorType_INT8 || tensor->is_variable()) {
+    return false;
+  }
+  for (size_t i = 0; i < subgraph->outputs()->size(); ++i) {
+    if (subgraph->outputs()->Get(i) == tensor_index) {
+      return false;
+    }
+  }
+  return CountReaders(node_and_registrations, node_count, tensor_index) == 1;
+}
+
+// Marks a node merged into the fused node before it.
+void DropNode(NodeAndRegistration* node_and_registration) {
+  TfLiteIntArray* no_tensors = const_cast<TfLiteIntArray*>(&kNoTensors);
+  node_and_registration->node.inputs = no_tensors;
+  node_and_registration->node.outputs = no_tensors;
+  node_and_registration->registration = &kFusedRegistration;
+}
+
+// Returns the fused activation of a builtin op that clamps its output with
+// it, nullptr for other ops.
+TfLiteFusedActivation* FusedActivation(
+    const NodeAndRegistration& node_and_registration) {
+  void* builtin_data = node_and_registration.node.builtin_data;
+  switch (node_and_registration.registration->builtin_code) {
+    case BuiltinOperator_ADD:
+      return &static_cast<TfLiteAddParams*>(builtin_data)->activation;
+    case BuiltinOperator_AVERAGE_POOL_2D:
+    case BuiltinOperator_MAX_POOL_2D:
+      return &static_cast<TfLitePoolParams*>(builtin_data)->activation;
+    case BuiltinOperator_CONV_2D:
+      return &static_cast<TfLiteConvParams*>(builtin_data)->activation;
+    case BuiltinOperator_DEPTHWISE_CONV_2D:
+      return &static_cast<TfLiteDepthwiseConvParams*>(builtin_data)
+                  ->activation;
+    case BuiltinOperator_FULLY_CONNECTED:
+      return &static_cast<TfLiteFullyConnectedParams*>(builtin_data)
+                  ->activation;
+    default:
+      return nullptr;
+  }
+}
+
+// Returns true if both tensors have the same per-tensor scale and zero point.
+bool SameQuantization(const SubGraph* subgraph, int first, int second) {
+  const QuantizationParameters* a =
+      subgraph->tensors()->Get(first)->quantization();
+  const QuantizationParameters* b =
+      subgraph->tensors()->Get(second)->quantization();
+  if (a == nullptr || b == nullptr || a->scale() == nullptr ||
+      b->scale() == nullptr || a->zero_point() == nullptr ||
+      b->zero_point() == nullptr || a->scale()->size() != 1 ||
+      b->scale()->size() != 1 || a->zero_point()->size() != 1 ||
+      b->zero_point()->size() != 1) {
+    return false;
+  }
+  return a->scale()->Get(0) == b->scale()->Get(0) &&
+         a->zero_point()->Get(0) == b->zero_point()->Get(0);
+}
+
+// A RELU or RELU6 that does not change the quantization only clamps its input
+// to the quantized 0 (and 6), which is what the fused activation of its
+// producer does. Such a RELU is folded into the producer: the producer gets
+// the tighter activation and writes the RELU output directly.
+void FoldRelu(const SubGraph* subgraph,
+              NodeAndRegistration* node_and_registrations, int node_count) {
+  for (int i = 1; i < node_count; ++i) {
+    NodeAndRegistration* producer = &node_and_registrations[i - 1];
+    NodeAndRegistration* relu = &node_and_registrations[i];
+    const bool is_relu6 = IsBuiltin(*relu, BuiltinOperator_RELU6);
+    if (!is_relu6 && !IsBuiltin(*relu, BuiltinOperator_RELU)) {
+      continue;
+    }
+    TfLiteFusedActivation* activation = FusedActivation(*producer);
+    if (activation == nullptr ||
+        (*activation != kTfLiteActNone && *activation != kTfLiteActRelu &&
+         *activation != kTfLiteActRelu6) ||
+        relu->node.outputs->size != 1 ||
+        !IsFusableIntermediate(subgraph, node_and_registrations, node_count,
+                               i - 1) ||
+        !SameQuantization(subgraph, relu->node.inputs->data[0],
+                          relu->node.outputs->data[0])) {
+      continue;
+    }
+    if (is_relu6 || *activation == kTfLiteActRelu6) {
+      *activation = kTfLiteActRelu6;
+    } else {
+      *activation = kTfLiteActRelu;
+    }
+    producer->node.outputs = relu->node.outputs;
+    DropNode(relu);
+  }
+}
+
+TfLiteStatus FuseConvMaxPool(const SubGraph* subgraph,
+                             const TfLiteRegistration* registration,
+                             SimpleMemoryAllocator* allocator,
+                             NodeAndRegistration* node_and_registrations,
+                             int node_count, ErrorReporter* error_reporter) {
+  for (int i = 0; i + 1 < node_count; ++i) {
+    NodeAndRegistration* conv = &node_and_registrations[i];
+    NodeAndRegistration* pool = &node_and_registrations[i + 1];
+    if (!IsBuiltin(*conv, BuiltinOperator_CONV_2D) ||
+        !IsBuiltin(*pool, BuiltinOperator_MAX_POOL_2D)) {
+      continue;
+    }
+    const auto* conv_params =
+        static_cast<const TfLiteConvParams*>(conv->node.builtin_data);
+    const auto* pool_params =
+        static_cast<const TfLitePoolParams*>(pool->node.builtin_data);
+    // Without padding a band of output rows only needs a band of input rows.
+    if (conv_params->padding != kTfLitePaddingValid ||
+        !IsFusableIntermediate(subgraph, node_and_registrations, node_count,
+                               i)) {
+      continue;
+    }
+    const bool relu =
+        i + 2 < node_count &&
+        IsBuiltin(node_and_registrations[i + 2], BuiltinOperator_RELU) &&
+        IsFusableIntermediate(subgraph, node_and_registrations, node_count,
+                              i + 1);
+
+    auto* params = reinterpret_cast<TfLiteConvPoolParams*>(
+        allocator->AllocateFromTail(sizeof(TfLiteConvPoolParams),
+                                    alignof(TfLiteConvPoolParams)));
+    if (params == nullptr) {
+      TF_LITE_REPORT_ERROR(error_reporter,
+                           "Failed to allocate memory for fused node %d", i);
+      return kTfLiteError;
+    }
+    const int fused_count = relu ? 2 : 1;
+    params->conv = *conv_params;
+    params->pool = *pool_params;
+    params->relu = relu;
+    params->conv_output = conv->node.outputs->data[0];
+    params->pool_output = pool->node.outputs->data[0];
+
+    conv->node.builtin_data = params;
+    conv->node.outputs = node_and_registrations[i + fused_count]
+                             .node.outputs;
+    conv->registration = registration;
+    for (int n = 1; n <= fused_count; ++n) {
+      DropNode(&node_and_registrations[i + n]);
+    }
+    i += fused_count;
+  }
+  return kTfLiteOk;
+}
+
+}  // namespace
+
+TfLiteStatus FuseOperators(const Model* model,
+                           const MicroOpResolver& op_resolver,
+                           SimpleMemoryAllocator* allocator,
+                           NodeAndRegistration* node_and_registrations,
+                           ErrorReporter* error_reporter) {
+  const SubGraph* subgraph = (*model->subgraphs())[0];
+  const int node_count = subgraph->operators()->size();
+
+  FoldRelu(subgraph, node_and_registrations, node_count);
+
+  const TfLiteRegistration* conv_pool =
+      op_resolver.FindOp(kConv2DMaxPool2DOpName);
+  if (conv_pool != nullptr) {
+    TF_LITE_ENSURE_STATUS(FuseConvMaxPool(subgraph, conv_pool, allocator,
+                                          node_and_registrations, node_count,
+                                          error_reporter));
+  }
+  return kTfLiteOk;
+}
+
+}  // namespace tflite
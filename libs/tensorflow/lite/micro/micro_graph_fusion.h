@@ -0,0 +1,64 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_MICRO_MICRO_GRAPH_FUSION_H_
+#define TENSORFLOW_LITE_MICRO_MICRO_GRAPH_FUSION_H_
+
+#include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/core/api/error_reporter.h"
+#include "tensorflow/lite/micro/micro_allocator.h"
+#include "tensorflow/lite/micro/micro_op_resolver.h"
+#include "tensorflow/lite/micro/simple_memory_allocator.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace tflite {
+
+// Name of the fused CONV_2D + MAX_POOL_2D [+ RELU] kernel in the op resolver,
+// see MicroMutableOpResolver::AddConv2DMaxPool2D().
+constexpr char kConv2DMaxPool2DOpName[] = "CONV_2D_MAX_POOL_2D";
+
+// Builtin data of a fused CONV_2D + MAX_POOL_2D [+ RELU] node. The node reads
+// the inputs of the CONV_2D and writes the output of the last fused op. The
+// tensors between the fused ops are kept for their shapes and quantization
+// only and get no memory in the arena. TfLiteNode::intermediates does not
+// exist with TF_LITE_STATIC_MEMORY, so their indices are kept here.
+struct TfLiteConvPoolParams {
+  TfLiteConvParams conv;
+  TfLitePoolParams pool;
+  bool relu;
+  int conv_output;
+  // The MAX_POOL_2D output, the node output if RELU is not fused.
+  int pool_output;
+};
+
+// Rewrites node_and_registrations, before any kernel is initialized:
+//  - an int8 RELU or RELU6 with the quantization of its input becomes the
+//    fused activation of the op before it (ADD, AVERAGE_POOL_2D, CONV_2D,
+//    DEPTHWISE_CONV_2D, FULLY_CONNECTED, MAX_POOL_2D);
+//  - every int8 CONV_2D (VALID padding) -> MAX_POOL_2D [-> RELU] chain runs
+//    as one node of the kernel registered as kConv2DMaxPool2DOpName, if the
+//    op resolver has one.
+// Only tensors read by the next op alone are removed. The first node of a
+// chain becomes the fused node, the others keep their place with no inputs,
+// no outputs and no kernel callbacks, so node indices still match the model.
+TfLiteStatus FuseOperators(const Model* model,
+                           const MicroOpResolver& op_resolver,
+                           SimpleMemoryAllocator* allocator,
+                           NodeAndRegistration* node_and_registrations,
+                           ErrorReporter* error_reporter);
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_MICRO_MICRO_GRAPH_FUSION_H_
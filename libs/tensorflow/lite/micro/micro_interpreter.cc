@@ -19,6 +19,7 @@ limitations under the License.
 #include <cstdint>
 
 #include "flatbuffers/flatbuffers.h"  // from @flatbuffers
+#include "tensorflow/lite/c/builtin_op_data.h"
 #include "tensorflow/lite/c/common.h"
 #include "tensorflow/lite/core/api/error_reporter.h"
 #include "tensorflow/lite/core/api/tensor_utils.h"
@@ -296,7 +297,7 @@ TfLiteStatus MicroInterpreter::AllocateTensors() {
         return kTfLiteError;
       }
     }
-    allocator_.ResetTempAllocations();
+    TF_LITE_ENSURE_STATUS(allocator_.FinishPrepareNodeAllocations());
   }
   context_helper_.SetNodeIndex(-1);
 
@@ -327,7 +328,9 @@ TfLiteStatus MicroInterpreter::Invoke() {
     TF_LITE_ENSURE_OK(&context_, AllocateTensors());
   }
 
-  for (size_t i = 0; i < subgraph_->operators()->size(); ++i) {
+  const size_t node_count =
+      subgraph_->operators()->size() - (skip_last_node_ ? 1 : 0);
+  for (size_t i = 0; i < node_count; ++i) {
     auto* node = &(node_and_registrations_[i].node);
     auto* registration = node_and_registrations_[i].registration;
 
@@ -425,6 +428,39 @@ TfLiteTensor* MicroInterpreter::tensor(size_t index) {
                                                    index);
 }
 
+TfLiteTensor* MicroInterpreter::SkipOutputSoftmax(size_t index, float* beta) {
+  if (!tensors_allocated_ || index >= outputs_size() ||
+      operators_size() == 0) {
+    return nullptr;
+  }
+  const NodeAndRegistration& last =
+      node_and_registrations_[operators_size() - 1];
+  if (last.registration->builtin_code != BuiltinOperator_SOFTMAX ||
+      last.node.outputs->size != 1 ||
+      last.node.outputs->data[0] != subgraph_->outputs()->Get(index)) {
+    return nullptr;
+  }
+  // Only int8 logits have the scale and zero point the argmax mode scores
+  // with; check before anything is allocated or changed.
+  const int logits_index = last.node.inputs->data[0];
+  if (eval_tensors_[logits_index].type != kTfLiteInt8) {
+    return nullptr;
+  }
+  // tensor() checks the index against context_.tensors_size, which is not
+  // set in this mode.
+  TfLiteTensor* logits = allocator_.AllocatePersistentTfLiteTensor(
+      model_, eval_tensors_, logits_index);
+  if (logits == nullptr) {
+    return nullptr;
+  }
+  if (beta != nullptr) {
+    *beta =
+        static_cast<const TfLiteSoftmaxParams*>(last.node.builtin_data)->beta;
+  }
+  skip_last_node_ = true;
+  return logits;
+}
+
 TfLiteStatus MicroInterpreter::ResetVariableTensors() {
   for (size_t i = 0; i < subgraph_->tensors()->size(); ++i) {
     auto* tensor = subgraph_->tensors()->Get(i);
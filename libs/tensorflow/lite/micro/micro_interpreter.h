@@ -151,6 +151,15 @@ class MicroInterpreter {
   // Reset all variable tensors to the default value.
   TfLiteStatus ResetVariableTensors();
 
+  // Argmax-only output: if the last op is a SOFTMAX that writes output(index),
+  // Invoke() stops before it from now on and its input (the logits) is
+  // returned, with its beta if beta is not null. Softmax keeps the order of
+  // its inputs, so the best class is the best logit. output(index) is not
+  // written any more then. Returns nullptr and changes nothing for other
+  // models and for logits that are not int8. Only available after
+  // `AllocateTensors` has been called.
+  TfLiteTensor* SkipOutputSoftmax(size_t index, float* beta);
+
   TfLiteStatus initialization_status() const { return initialization_status_; }
 
   size_t operators_size() const { return subgraph_->operators()->size(); }
@@ -190,6 +199,8 @@ class MicroInterpreter {
   TfLiteContext context_ = {};
   MicroAllocator& allocator_;
   bool tensors_allocated_;
+  // Invoke() leaves out the last node, see SkipOutputSoftmax().
+  bool skip_last_node_ = false;
 
   TfLiteStatus initialization_status_;
 
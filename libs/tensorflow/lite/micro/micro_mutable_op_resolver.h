@@ -25,27 +25,28 @@ limitations under the License.
 #include "tensorflow/lite/kernels/op_macros.h"
 #include "tensorflow/lite/micro/compatibility.h"
 #include "tensorflow/lite/micro/kernels/micro_ops.h"
+#include "tensorflow/lite/micro/micro_graph_fusion.h"
 #include "tensorflow/lite/micro/micro_op_resolver.h"
 #include "tensorflow/lite/schema/schema_generated.h"
 
 namespace tflite {
 
+// Builtin ops are found through a table indexed by BuiltinOperator, so
+// FindOp() and GetOpDataParser() cost the same for any number of registered
+// ops. Custom ops are still looked up by name.
 template <unsigned int tOpCount>
 class MicroMutableOpResolver : public MicroOpResolver {
  public:
   explicit MicroMutableOpResolver(ErrorReporter* error_reporter = nullptr)
-      : error_reporter_(error_reporter) {}
+      : error_reporter_(error_reporter) {
+    static_assert(tOpCount < kNotRegistered,
+                  "The builtin index table holds uint8_t indices.");
+    memset(builtin_index_, kNotRegistered, sizeof(builtin_index_));
+  }
 
   const TfLiteRegistration* FindOp(tflite::BuiltinOperator op) const override {
-    if (op == BuiltinOperator_CUSTOM) return nullptr;
-
-    for (unsigned int i = 0; i < registrations_len_; ++i) {
-      const TfLiteRegistration& registration = registrations_[i];
-      if (registration.builtin_code == op) {
-        return &registration;
-      }
-    }
-    return nullptr;
+    const unsigned int index = BuiltinIndex(op);
+    return index == kNotRegistered ? nullptr : &registrations_[index];
   }
 
   const TfLiteRegistration* FindOp(const char* op) const override {
@@ -61,11 +62,8 @@ class MicroMutableOpResolver : public MicroOpResolver {
 
   MicroOpResolver::BuiltinParseFunction GetOpDataParser(
       BuiltinOperator op) const override {
-    TFLITE_DCHECK(num_buitin_ops_ <= tOpCount);
-    for (unsigned int i = 0; i < num_buitin_ops_; ++i) {
-      if (builtin_codes_[i] == op) return builtin_parsers_[i];
-    }
-    return nullptr;
+    const unsigned int index = BuiltinIndex(op);
+    return index == kNotRegistered ? nullptr : builtin_parsers_[index];
   }
 
   // Registers a Custom Operator with the MicroOpResolver.
@@ -154,6 +152,13 @@ class MicroMutableOpResolver : public MicroOpResolver {
                       tflite::ops::micro::Register_CONV_2D(), ParseConv2D);
   }
 
+  // Fused CONV_2D + MAX_POOL_2D [+ RELU] kernel, used by FuseOperators() in
+  // place of the separate kernels when the model has such chains.
+  TfLiteStatus AddConv2DMaxPool2D() {
+    return AddCustom(kConv2DMaxPool2DOpName,
+                     tflite::ops::micro::Register_CONV_2D_MAX_POOL_2D());
+  }
+
   TfLiteStatus AddCos() {
     return AddBuiltin(BuiltinOperator_COS, tflite::ops::micro::Register_COS(),
                       ParseCos);
@@ -394,6 +399,16 @@ class MicroMutableOpResolver : public MicroOpResolver {
   unsigned int GetRegistrationLength() { return registrations_len_; }
 
  private:
+  static constexpr uint8_t kNotRegistered = 0xFF;
+
+  unsigned int BuiltinIndex(tflite::BuiltinOperator op) const {
+    if (op < BuiltinOperator_MIN || op > BuiltinOperator_MAX ||
+        op == BuiltinOperator_CUSTOM) {
+      return kNotRegistered;
+    }
+    return builtin_index_[op];
+  }
+
   TfLiteStatus AddBuiltin(tflite::BuiltinOperator op,
                           const TfLiteRegistration& registration,
                           MicroOpResolver::BuiltinParseFunction parser) {
@@ -430,23 +445,20 @@ class MicroMutableOpResolver : public MicroOpResolver {
     // Strictly speaking, the builtin_code is not necessary for TFLM but filling
     // it in regardless.
     registrations_[registrations_len_].builtin_code = op;
+    builtin_parsers_[registrations_len_] = parser;
+    builtin_index_[op] = static_cast<uint8_t>(registrations_len_);
     registrations_len_++;
 
-    builtin_codes_[num_buitin_ops_] = op;
-    builtin_parsers_[num_buitin_ops_] = parser;
-    num_buitin_ops_++;
-
     return kTfLiteOk;
   }
 
   TfLiteRegistration registrations_[tOpCount];
   unsigned int registrations_len_ = 0;
 
-  // Arrays (and counter) to store the builtin codes and their corresponding
-  // parse functions as these are registered with the Op Resolver.
-  BuiltinOperator builtin_codes_[tOpCount];
+  // Parse functions of the registrations (unset for custom ops), and the
+  // index of the registration of each builtin op or kNotRegistered.
   MicroOpResolver::BuiltinParseFunction builtin_parsers_[tOpCount];
-  unsigned int num_buitin_ops_ = 0;
+  uint8_t builtin_index_[BuiltinOperator_MAX + 1];
 
   ErrorReporter* error_reporter_;
 
@@ -0,0 +1,320 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/micro/micro_static_plan.h"
+
+#include <cstdarg>
+#include <cstring>
+
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/core/api/error_reporter.h"
+#include "tensorflow/lite/micro/memory_helpers.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace tflite {
+namespace {
+
+// Same as MicroAllocator, so the planned offsets of the host hold.
+constexpr size_t kBufferAlignment = 16;
+
+uint8_t* AlignedArena(uint8_t* tensor_arena) {
+  return AlignPointerUp(tensor_arena, kBufferAlignment);
+}
+
+size_t AlignedArenaSize(uint8_t* tensor_arena, size_t tensor_arena_size) {
+  return tensor_arena + tensor_arena_size - AlignedArena(tensor_arena);
+}
+
+TfLiteIntArray* ToIntArray(const int32_t* data) {
+  return reinterpret_cast<TfLiteIntArray*>(const_cast<int32_t*>(data));
+}
+
+}  // namespace
+
+StaticPlanRunner::StaticPlanRunner(const StaticPlan& plan,
+                                   uint8_t* tensor_arena,
+                                   size_t tensor_arena_size,
+                                   ErrorReporter* error_reporter)
+    : plan_(plan),
+      error_reporter_(error_reporter),
+      memory_allocator_(error_reporter, AlignedArena(tensor_arena),
+                        AlignedArenaSize(tensor_arena, tensor_arena_size)) {
+  context_.impl_ = static_cast<void*>(this);
+  context_.ReportError = ReportOpError;
+  context_.GetTensor = GetTensor;
+  context_.GetEvalTensor = GetEvalTensor;
+  context_.recommended_num_threads = 1;
+}
+
+StaticPlanRunner::~StaticPlanRunner() {
+  if (nodes_ == nullptr) return;
+  for (uint32_t i = 0; i < plan_.node_count; ++i) {
+    const TfLiteRegistration* registration = plan_.nodes[i].registration;
+    if (registration->free != nullptr) {
+      registration->free(&context_, nodes_[i].user_data);
+    }
+  }
+}
+
+TfLiteStatus StaticPlanRunner::Setup() {
+  if (memory_allocator_.EnsureHeadSize(plan_.head_bytes, kBufferAlignment) !=
+      kTfLiteOk) {
+    TF_LITE_REPORT_ERROR(error_reporter_,
+                         "Arena size is too small for the static plan, %d "
+                         "bytes of activation buffers.",
+                         plan_.head_bytes);
+    return kTfLiteError;
+  }
+  TF_LITE_ENSURE_STATUS(SetupTensors());
+  TF_LITE_ENSURE_STATUS(SetupNodes());
+
+  // Only allow AllocatePersistentBuffer in Init stage.
+  context_.AllocatePersistentBuffer = AllocatePersistentBuffer;
+  for (uint32_t i = 0; i < plan_.node_count; ++i) {
+    const StaticPlanNode& plan_node = plan_.nodes[i];
+    const TfLiteRegistration* registration = plan_node.registration;
+    if (registration->init == nullptr) continue;
+    if (registration->builtin_code == BuiltinOperator_CUSTOM) {
+      nodes_[i].user_data =
+          registration->init(&context_, plan_node.custom_data,
+                             plan_node.custom_data_size);
+    } else {
+      nodes_[i].user_data = registration->init(
+          &context_, reinterpret_cast<const char*>(plan_node.builtin_data), 0);
+    }
+  }
+
+  // Both AllocatePersistentBuffer and RequestScratchBufferInArena is
+  // available in Prepare stage.
+  context_.RequestScratchBufferInArena = RequestScratchBufferInArena;
+  for (uint32_t i = 0; i < plan_.node_count; ++i) {
+    const TfLiteRegistration* registration = plan_.nodes[i].registration;
+    if (registration->prepare != nullptr &&
+        registration->prepare(&context_, &nodes_[i]) != kTfLiteOk) {
+      TF_LITE_REPORT_ERROR(error_reporter_, "Node %d failed to prepare.", i);
+      return kTfLiteError;
+    }
+    memory_allocator_.ResetTempAllocations();
+  }
+  if (scratch_buffer_count_ != static_cast<int>(plan_.scratch_buffer_count)) {
+    TF_LITE_REPORT_ERROR(error_reporter_,
+                         "The kernels requested %d scratch buffers, the "
+                         "static plan has %d. Generate the plan again.",
+                         scratch_buffer_count_, plan_.scratch_buffer_count);
+    return kTfLiteError;
+  }
+
+  // Kernels can only fetch scratch buffers via GetScratchBuffer from now on.
+  context_.AllocatePersistentBuffer = nullptr;
+  context_.RequestScratchBufferInArena = nullptr;
+  context_.GetScratchBuffer = GetScratchBuffer;
+
+  return ResetVariableTensors();
+}
+
+TfLiteEvalTensor* StaticPlanRunner::input(size_t index) {
+  if (eval_tensors_ == nullptr || index >= inputs_size()) return nullptr;
+  return &eval_tensors_[plan_.inputs[index + 1]];
+}
+
+TfLiteEvalTensor* StaticPlanRunner::output(size_t index) {
+  if (eval_tensors_ == nullptr || index >= outputs_size()) return nullptr;
+  return &eval_tensors_[plan_.outputs[index + 1]];
+}
+
+TfLiteStatus StaticPlanRunner::ResetVariableTensors() {
+  for (uint32_t i = 0; i < plan_.tensor_count; ++i) {
+    const StaticPlanTensor& tensor = plan_.tensors[i];
+    if (tensor.kind != kStaticPlanVariable) continue;
+    int value = 0;
+    if (tensor.type == kTfLiteInt8 && tensor.channels > 0) {
+      value = tensor.zero_points[0];
+    }
+    memset(eval_tensors_[i].data.raw, value, tensor.bytes);
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus StaticPlanRunner::SetupTensors() {
+  eval_tensors_ =
+      reinterpret_cast<TfLiteEvalTensor*>(memory_allocator_.AllocateFromTail(
+          sizeof(TfLiteEvalTensor) * plan_.tensor_count,
+          alignof(TfLiteEvalTensor)));
+  if (eval_tensors_ == nullptr) {
+    TF_LITE_REPORT_ERROR(error_reporter_,
+                         "Failed to allocate memory for the eval tensors.");
+    return kTfLiteError;
+  }
+
+  uint8_t* head = memory_allocator_.GetBufferHead();
+  for (uint32_t i = 0; i < plan_.tensor_count; ++i) {
+    const StaticPlanTensor& tensor = plan_.tensors[i];
+    TfLiteEvalTensor* result = &eval_tensors_[i];
+    result->type = tensor.type;
+    result->dims = ToIntArray(tensor.dims);
+    switch (tensor.kind) {
+      case kStaticPlanArena:
+        if (tensor.offset + tensor.bytes > plan_.head_bytes) {
+          TF_LITE_REPORT_ERROR(error_reporter_,
+                               "Tensor %d is out of the planned buffers.", i);
+          return kTfLiteError;
+        }
+        result->data.data = head + tensor.offset;
+        break;
+      case kStaticPlanModel:
+        result->data.data = const_cast<uint8_t*>(plan_.model_data) +
+                            tensor.offset;
+        break;
+      case kStaticPlanVariable:
+        result->data.data =
+            memory_allocator_.AllocateFromTail(tensor.bytes, kBufferAlignment);
+        if (result->data.data == nullptr) {
+          TF_LITE_REPORT_ERROR(error_reporter_,
+                               "Failed to allocate variable tensor of size %d",
+                               tensor.bytes);
+          return kTfLiteError;
+        }
+        break;
+      default:
+        result->data.data = nullptr;
+        break;
+    }
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus StaticPlanRunner::SetupNodes() {
+  nodes_ = reinterpret_cast<TfLiteNode*>(memory_allocator_.AllocateFromTail(
+      sizeof(TfLiteNode) * plan_.node_count, alignof(TfLiteNode)));
+  if (nodes_ == nullptr) {
+    TF_LITE_REPORT_ERROR(error_reporter_,
+                         "Failed to allocate memory for the nodes.");
+    return kTfLiteError;
+  }
+  for (uint32_t i = 0; i < plan_.node_count; ++i) {
+    const StaticPlanNode& plan_node = plan_.nodes[i];
+    TfLiteNode* node = &nodes_[i];
+    *node = {};
+    node->inputs = ToIntArray(plan_node.inputs);
+    node->outputs = ToIntArray(plan_node.outputs);
+    node->builtin_data = const_cast<void*>(plan_node.builtin_data);
+    node->custom_initial_data = plan_node.custom_data;
+    node->custom_initial_data_size = plan_node.custom_data_size;
+  }
+  return kTfLiteOk;
+}
+
+void StaticPlanRunner::ReportOpError(struct TfLiteContext* context,
+                                     const char* format, ...) {
+#ifndef TF_LITE_STRIP_ERROR_STRINGS
+  StaticPlanRunner* runner = static_cast<StaticPlanRunner*>(context->impl_);
+  va_list args;
+  va_start(args, format);
+  TF_LITE_REPORT_ERROR(runner->error_reporter_, format, args);
+  va_end(args);
+#endif
+}
+
+TfLiteTensor* StaticPlanRunner::GetTensor(const struct TfLiteContext* context,
+                                          int tensor_idx) {
+  StaticPlanRunner* runner = static_cast<StaticPlanRunner*>(context->impl_);
+  SimpleMemoryAllocator& allocator = runner->memory_allocator_;
+  const StaticPlanTensor& tensor = runner->plan_.tensors[tensor_idx];
+
+  // Only valid until the Prepare of the node returns, as with MicroAllocator.
+  TfLiteTensor* result = reinterpret_cast<TfLiteTensor*>(
+      allocator.AllocateTemp(sizeof(TfLiteTensor), alignof(TfLiteTensor)));
+  if (result == nullptr) return nullptr;
+  *result = {};
+  result->type = tensor.type;
+  result->data.data = runner->eval_tensors_[tensor_idx].data.data;
+  result->dims = ToIntArray(tensor.dims);
+  result->bytes = tensor.bytes;
+  result->allocation_type =
+      tensor.kind == kStaticPlanModel ? kTfLiteMmapRo : kTfLiteArenaRw;
+  result->is_variable = tensor.kind == kStaticPlanVariable;
+
+  if (tensor.channels > 0) {
+    result->params.scale = tensor.scales[0];
+    result->params.zero_point = tensor.zero_points[0];
+
+    TfLiteAffineQuantization* quantization =
+        reinterpret_cast<TfLiteAffineQuantization*>(
+            allocator.AllocateTemp(sizeof(TfLiteAffineQuantization),
+                                   alignof(TfLiteAffineQuantization)));
+    TfLiteFloatArray* scale =
+        reinterpret_cast<TfLiteFloatArray*>(allocator.AllocateTemp(
+            TfLiteFloatArrayGetSizeInBytes(tensor.channels),
+            alignof(TfLiteFloatArray)));
+    TfLiteIntArray* zero_point =
+        reinterpret_cast<TfLiteIntArray*>(allocator.AllocateTemp(
+            TfLiteIntArrayGetSizeInBytes(tensor.channels),
+            alignof(TfLiteIntArray)));
+    if (quantization == nullptr || scale == nullptr || zero_point == nullptr) {
+      return nullptr;
+    }
+    scale->size = tensor.channels;
+    zero_point->size = tensor.channels;
+    for (int i = 0; i < tensor.channels; ++i) {
+      scale->data[i] = tensor.scales[i];
+      zero_point->data[i] = tensor.zero_points[i];
+    }
+    quantization->scale = scale;
+    quantization->zero_point = zero_point;
+    quantization->quantized_dimension = tensor.quantized_dimension;
+    result->quantization = {kTfLiteAffineQuantization, quantization};
+  }
+  return result;
+}
+
+TfLiteEvalTensor* StaticPlanRunner::GetEvalTensor(
+    const struct TfLiteContext* context, int tensor_idx) {
+  StaticPlanRunner* runner = static_cast<StaticPlanRunner*>(context->impl_);
+  return &runner->eval_tensors_[tensor_idx];
+}
+
+void* StaticPlanRunner::AllocatePersistentBuffer(struct TfLiteContext* context,
+                                                 size_t bytes) {
+  StaticPlanRunner* runner = static_cast<StaticPlanRunner*>(context->impl_);
+  return runner->memory_allocator_.AllocateFromTail(bytes, kBufferAlignment);
+}
+
+TfLiteStatus StaticPlanRunner::RequestScratchBufferInArena(
+    struct TfLiteContext* context, size_t bytes, int* buffer_idx) {
+  StaticPlanRunner* runner = static_cast<StaticPlanRunner*>(context->impl_);
+  const int index = runner->scratch_buffer_count_;
+  if (index >= static_cast<int>(runner->plan_.scratch_buffer_count) ||
+      bytes > runner->plan_.scratch_buffers[index].bytes) {
+    TF_LITE_REPORT_ERROR(runner->error_reporter_,
+                         "Scratch buffer %d of %d bytes is not in the static "
+                         "plan. Generate the plan again.",
+                         index, bytes);
+    return kTfLiteError;
+  }
+  runner->scratch_buffer_count_++;
+  *buffer_idx = index;
+  return kTfLiteOk;
+}
+
+void* StaticPlanRunner::GetScratchBuffer(struct TfLiteContext* context,
+                                         int buffer_idx) {
+  StaticPlanRunner* runner = static_cast<StaticPlanRunner*>(context->impl_);
+  if (buffer_idx < 0 || buffer_idx >= runner->scratch_buffer_count_) {
+    return nullptr;
+  }
+  return runner->memory_allocator_.GetBufferHead() +
+         runner->plan_.scratch_buffers[buffer_idx].offset;
+}
+
+}  // namespace tflite
@@ -0,0 +1,155 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_MICRO_MICRO_STATIC_PLAN_H_
+#define TENSORFLOW_LITE_MICRO_MICRO_STATIC_PLAN_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/core/api/error_reporter.h"
+#include "tensorflow/lite/micro/simple_memory_allocator.h"
+
+namespace tflite {
+
+// A static plan is a model that MicroInterpreter has already allocated on the
+// host, written out as C++ source by tools/host/generate_static_plan: the
+// tensors with their place in the arena, the nodes (after FuseOperators())
+// with their kernels and builtin data, and the scratch buffers. Running it
+// needs no flatbuffer parsing, op resolving or memory planning, only Init and
+// Prepare of the kernels at setup, since their op data is private to them.
+// The generated Invoke function calls the Eval functions of the kernels in
+// order, see StaticPlanRunner.
+
+// Where the data of a StaticPlanTensor is.
+enum StaticPlanTensorKind : uint8_t {
+  // No data, e.g. a tensor between the ops of a fused node.
+  kStaticPlanNoData = 0,
+  // At `offset` in the planned (head) section of the arena.
+  kStaticPlanArena = 1,
+  // At `offset` in the model, the weights.
+  kStaticPlanModel = 2,
+  // A variable tensor, allocated from the tail of the arena by Setup() and
+  // reset to its zero point.
+  kStaticPlanVariable = 3,
+};
+
+struct StaticPlanTensor {
+  TfLiteType type;
+  StaticPlanTensorKind kind;
+  uint32_t offset;
+  uint32_t bytes;
+  // Rank followed by the dimensions, laid out as a TfLiteIntArray.
+  const int32_t* dims;
+  // Quantization, channels is 0 if the tensor is not quantized.
+  int32_t channels;
+  int32_t quantized_dimension;
+  const float* scales;
+  const int32_t* zero_points;
+};
+
+struct StaticPlanNode {
+  const TfLiteRegistration* registration;
+  // Count followed by the tensor indices, laid out as a TfLiteIntArray.
+  const int32_t* inputs;
+  const int32_t* outputs;
+  const void* builtin_data;
+  const char* custom_data;
+  uint32_t custom_data_size;
+};
+
+struct StaticPlanScratchBuffer {
+  uint32_t offset;
+  uint32_t bytes;
+};
+
+struct StaticPlan {
+  // The model the plan was made from, only the weights are read.
+  const uint8_t* model_data;
+  const StaticPlanTensor* tensors;
+  uint32_t tensor_count;
+  const StaticPlanNode* nodes;
+  uint32_t node_count;
+  const StaticPlanScratchBuffer* scratch_buffers;
+  uint32_t scratch_buffer_count;
+  // Count followed by the tensor indices.
+  const int32_t* inputs;
+  const int32_t* outputs;
+  // Bytes of the planned section at the start of the arena.
+  uint32_t head_bytes;
+};
+
+// Runs a static plan in an arena: the planned buffers at its start as on the
+// host, the eval tensors, the nodes and the persistent buffers of the kernels
+// from its end. The persistent part is allocated on the target, so its size
+// may differ from the host, the arena only has to hold both.
+class StaticPlanRunner {
+ public:
+  StaticPlanRunner(const StaticPlan& plan, uint8_t* tensor_arena,
+                   size_t tensor_arena_size, ErrorReporter* error_reporter);
+  ~StaticPlanRunner();
+
+  // Sets up the tensors and the nodes and runs Init and Prepare of the
+  // kernels. The scratch buffers the kernels request must match the plan,
+  // otherwise the plan is older than the kernels and has to be generated
+  // again.
+  TfLiteStatus Setup();
+
+  // For the generated Invoke function.
+  TfLiteContext* context() { return &context_; }
+  TfLiteNode* nodes() { return nodes_; }
+
+  TfLiteEvalTensor* input(size_t index);
+  TfLiteEvalTensor* output(size_t index);
+  size_t inputs_size() const { return plan_.inputs[0]; }
+  size_t outputs_size() const { return plan_.outputs[0]; }
+
+  // Reset all variable tensors to their zero point.
+  TfLiteStatus ResetVariableTensors();
+
+  // The used arena in bytes, only available after Setup().
+  size_t arena_used_bytes() const { return memory_allocator_.GetUsedBytes(); }
+
+ private:
+  static void ReportOpError(struct TfLiteContext* context, const char* format,
+                            ...);
+  static TfLiteTensor* GetTensor(const struct TfLiteContext* context,
+                                 int tensor_idx);
+  static TfLiteEvalTensor* GetEvalTensor(const struct TfLiteContext* context,
+                                         int tensor_idx);
+  static void* AllocatePersistentBuffer(struct TfLiteContext* context,
+                                        size_t bytes);
+  static TfLiteStatus RequestScratchBufferInArena(struct TfLiteContext* context,
+                                                  size_t bytes,
+                                                  int* buffer_idx);
+  static void* GetScratchBuffer(struct TfLiteContext* context,
+                                int buffer_idx);
+
+  TfLiteStatus SetupTensors();
+  TfLiteStatus SetupNodes();
+
+  const StaticPlan& plan_;
+  ErrorReporter* error_reporter_;
+  SimpleMemoryAllocator memory_allocator_;
+  TfLiteContext context_ = {};
+  TfLiteEvalTensor* eval_tensors_ = nullptr;
+  TfLiteNode* nodes_ = nullptr;
+  // Scratch buffers requested so far in Prepare.
+  int scratch_buffer_count_ = 0;
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_MICRO_MICRO_STATIC_PLAN_H_
@@ -90,6 +90,31 @@ TfLiteStatus SimpleMemoryAllocator::EnsureHeadSize(size_t size,
   return kTfLiteOk;
 }
 
+TfLiteStatus SimpleMemoryAllocator::SetHeadSize(size_t size,
+                                                size_t alignment) {
+  if (head_ != temp_) {
+    TF_LITE_REPORT_ERROR(
+        error_reporter_,
+        "Internal error: SetHeadSize() needs to be called after"
+        "ResetTempAllocations().");
+    return kTfLiteError;
+  }
+
+  uint8_t* const aligned_result = AlignPointerUp(buffer_head_, alignment);
+  const size_t available_memory = tail_ - aligned_result;
+  if (available_memory < size) {
+    TF_LITE_REPORT_ERROR(
+        error_reporter_,
+        "Failed to set head size. Requested: %u, available %u, missing: %u",
+        size, available_memory, size - available_memory);
+    return kTfLiteError;
+  }
+  head_ = aligned_result + size;
+  temp_ = head_;
+
+  return kTfLiteOk;
+}
+
 uint8_t* SimpleMemoryAllocator::AllocateFromTail(size_t size,
                                                  size_t alignment) {
   uint8_t* const aligned_result = AlignPointerDown(tail_ - size, alignment);
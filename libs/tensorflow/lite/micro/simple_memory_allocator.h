@@ -51,6 +51,11 @@ class SimpleMemoryAllocator {
   // up with a call to ResetTempAllocations().
   virtual TfLiteStatus EnsureHeadSize(size_t size, size_t alignment);
 
+  // Sets the head memory allocation to a given size, which may also shrink
+  // it. Same requirements as EnsureHeadSize(): invalidates all temporary
+  // allocation values and fails if the temp allocations have not been reset.
+  virtual TfLiteStatus SetHeadSize(size_t size, size_t alignment);
+
   // Allocates memory starting at the tail of the arena (highest address and
   // moving downwards).
   virtual uint8_t* AllocateFromTail(size_t size, size_t alignment);
@@ -0,0 +1,200 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Checks the int8 CONV_2D kernel of micro/kernels/conv.cc against
+// reference_integer_ops::ConvPerChannel() with the unfolded parameters:
+// EvalConv3x3SingleChannel() on the first layer of the keyword model (3x3
+// over a 250x64 single-channel input) and its neighbours, and
+// EvalQuantizedPerChannelFolded() over channels, strides, dilations and
+// batches. The cases marked "reference" cannot be folded (padded windows or
+// a filter that is not constant) and check that Prepare() falls back to the
+// reference kernel. Prints the times of both and exits with 1 on a
+// mismatch.
+
+#include <cstdio>
+#include <vector>
+
+#include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/kernels/internal/reference/integer_ops/conv.h"
+#include "tensorflow/lite/kernels/internal/types.h"
+#include "tensorflow/lite/kernels/padding.h"
+#include "tensorflow/lite/micro/kernels/micro_ops.h"
+#include "tensorflow/lite/micro/tools/host/kernel_check.h"
+
+namespace {
+
+using tflite::host::ChannelQuantization;
+
+struct ConvCase {
+  const char* name;
+  int batches;
+  int input_height;
+  int input_width;
+  int input_depth;
+  int filter_height;
+  int filter_width;
+  int output_depth;
+  int stride;
+  int dilation;
+  TfLitePadding padding;
+  TfLiteFusedActivation activation;
+  int input_zero_point;
+  bool constant_filter;
+};
+
+const ConvCase kCases[] = {
+    // The first layer of the keyword model.
+    {"3x3 single channel 250x64", 1, 250, 64, 1, 3, 3, 1, 1, 1,
+     kTfLitePaddingValid, kTfLiteActNone, -128, true},
+    {"3x3 single channel 250x64 relu", 1, 250, 64, 1, 3, 3, 1, 1, 1,
+     kTfLitePaddingValid, kTfLiteActRelu, 5, true},
+    {"3x3 single channel 250x64 to 8", 1, 250, 64, 1, 3, 3, 8, 1, 1,
+     kTfLitePaddingValid, kTfLiteActNone, -3, true},
+    {"3x3 single channel 2x31x17", 2, 31, 17, 1, 3, 3, 3, 1, 1,
+     kTfLitePaddingValid, kTfLiteActRelu6, 17, true},
+    {"3x3 single channel 3x3", 1, 3, 3, 1, 3, 3, 2, 1, 1,
+     kTfLitePaddingValid, kTfLiteActNone, 0, true},
+    // EvalQuantizedPerChannelFolded().
+    {"3x3 20x20x8 to 16", 1, 20, 20, 8, 3, 3, 16, 1, 1, kTfLitePaddingValid,
+     kTfLiteActNone, -128, true},
+    {"3x3 stride 2 21x19x4 to 8", 1, 21, 19, 4, 3, 3, 8, 2, 1,
+     kTfLitePaddingValid, kTfLiteActRelu, 9, true},
+    {"3x3 dilation 2 17x15x3 to 5", 1, 17, 15, 3, 3, 3, 5, 1, 2,
+     kTfLitePaddingValid, kTfLiteActNone, -7, true},
+    {"5x5 2 batches 12x11x2 to 3", 2, 12, 11, 2, 5, 5, 3, 1, 1,
+     kTfLitePaddingValid, kTfLiteActRelu6, 30, true},
+    {"1x4 stride 2 single channel 9x30", 1, 9, 30, 1, 1, 4, 4, 2, 1,
+     kTfLitePaddingValid, kTfLiteActNone, -1, true},
+    // SAME padding that pads nothing still folds.
+    {"1x1 SAME 10x10x16 to 8", 1, 10, 10, 16, 1, 1, 8, 1, 1,
+     kTfLitePaddingSame, kTfLiteActNone, 4, true},
+    {"3x3 SAME 12x12x4 to 4, reference", 1, 12, 12, 4, 3, 3, 4, 1, 1,
+     kTfLitePaddingSame, kTfLiteActNone, -128, true},
+    {"3x3 SAME single channel 250x64, reference", 1, 250, 64, 1, 3, 3, 1, 1,
+     1, kTfLitePaddingSame, kTfLiteActNone, -128, true},
+    {"3x3 stride 2 SAME 13x13x2 to 3, reference", 1, 13, 13, 2, 3, 3, 3, 2,
+     1, kTfLitePaddingSame, kTfLiteActRelu, 11, true},
+    {"3x3 variable filter 12x12x4 to 4, reference", 1, 12, 12, 4, 3, 3, 4,
+     1, 1, kTfLitePaddingValid, kTfLiteActNone, -5, false},
+};
+
+bool Check(const ConvCase& test, tflite::host::Random* random) {
+  int output_height, output_width;
+  const TfLitePaddingValues padding = tflite::ComputePaddingHeightWidth(
+      test.stride, test.stride, test.dilation, test.dilation,
+      test.input_height, test.input_width, test.filter_height,
+      test.filter_width, test.padding, &output_height, &output_width);
+
+  int input_dims[] = {4, test.batches, test.input_height, test.input_width,
+                      test.input_depth};
+  int filter_dims[] = {4, test.output_depth, test.filter_height,
+                       test.filter_width, test.input_depth};
+  int bias_dims[] = {1, test.output_depth};
+  int output_dims[] = {4, test.batches, output_height, output_width,
+                       test.output_depth};
+  const int input_size =
+      test.batches * test.input_height * test.input_width * test.input_depth;
+  const int filter_size = test.output_depth * test.filter_height *
+                          test.filter_width * test.input_depth;
+  const int output_size =
+      test.batches * output_height * output_width * test.output_depth;
+
+  std::vector<int8_t> input(input_size);
+  std::vector<int8_t> filter(filter_size);
+  std::vector<int32_t> bias(test.output_depth);
+  std::vector<int8_t> output(output_size);
+  std::vector<int8_t> expected(output_size);
+  std::vector<float> filter_scales(test.output_depth);
+  random->Fill(input.data(), input_size, -128, 127);
+  random->Fill(filter.data(), filter_size, -127, 127);
+  random->Fill(bias.data(), test.output_depth, -20000, 20000);
+  for (float& scale : filter_scales) scale = random->Float(0.002f, 0.02f);
+
+  const float input_scale = 0.05f;
+  const float output_scale = 0.25f;
+  const int output_zero_point = 3;
+  ChannelQuantization filter_quantization;
+  TfLiteTensor tensors[] = {
+      tflite::host::Int8Tensor(input.data(), input_dims, input_scale,
+                               test.input_zero_point),
+      tflite::host::Int8Tensor(filter.data(), filter_dims, 1.0f, 0,
+                               test.constant_filter),
+      tflite::host::Int32Tensor(bias.data(), bias_dims,
+                                input_scale * filter_scales[0],
+                                /*constant=*/true),
+      tflite::host::Int8Tensor(output.data(), output_dims, output_scale,
+                               output_zero_point),
+  };
+  tflite::host::SetChannelQuantization(&tensors[1], 0, filter_scales.data(),
+                                       &filter_quantization);
+  int inputs[] = {3, 0, 1, 2};
+  int outputs[] = {1, 3};
+  TfLiteConvParams params = {test.padding,    test.stride,   test.stride,
+                             test.activation, test.dilation, test.dilation};
+
+  const TfLiteRegistration registration =
+      tflite::ops::micro::Register_CONV_2D();
+  tflite::host::KernelCheck kernel(registration, tensors, 4, inputs, outputs,
+                                   &params);
+  if (!kernel.Prepare() || !kernel.Invoke()) return false;
+
+  std::vector<int32_t> multipliers(test.output_depth);
+  std::vector<int32_t> shifts(test.output_depth);
+  tflite::host::ChannelMultipliers(input_scale, filter_scales.data(),
+                                   output_scale, test.output_depth,
+                                   multipliers.data(), shifts.data());
+  tflite::ConvParams op_params;
+  op_params.input_offset = -test.input_zero_point;
+  op_params.output_offset = output_zero_point;
+  op_params.stride_height = test.stride;
+  op_params.stride_width = test.stride;
+  op_params.dilation_height_factor = test.dilation;
+  op_params.dilation_width_factor = test.dilation;
+  op_params.padding_values.height = padding.height;
+  op_params.padding_values.width = padding.width;
+  tflite::host::Int8ActivationRange(
+      test.activation, output_scale, output_zero_point,
+      &op_params.quantized_activation_min,
+      &op_params.quantized_activation_max);
+  const tflite::RuntimeShape input_shape(4, input_dims + 1);
+  const tflite::RuntimeShape filter_shape(4, filter_dims + 1);
+  const tflite::RuntimeShape bias_shape(1, bias_dims + 1);
+  const tflite::RuntimeShape output_shape(4, output_dims + 1);
+  auto reference = [&]() {
+    tflite::reference_integer_ops::ConvPerChannel(
+        op_params, multipliers.data(), shifts.data(), input_shape,
+        input.data(), filter_shape, filter.data(), bias_shape, bias.data(),
+        output_shape, expected.data());
+  };
+  reference();
+
+  const bool same = tflite::host::SameOutput(test.name, output.data(),
+                                             expected.data(), output_size);
+  tflite::host::PrintResult(test.name, kernel.InvokeNanoseconds(),
+                            tflite::host::Nanoseconds(reference), same);
+  return same;
+}
+
+}  // namespace
+
+int main() {
+  tflite::host::Random random;
+  bool all_same = true;
+  tflite::host::PrintHeader();
+  for (const ConvCase& test : kCases) {
+    all_same &= Check(test, &random);
+  }
+  return all_same ? 0 : 1;
+}
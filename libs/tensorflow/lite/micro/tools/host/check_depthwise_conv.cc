@@ -0,0 +1,197 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Checks the int8 DEPTHWISE_CONV_2D kernel of micro/kernels/depthwise_conv.cc
+// against reference_integer_ops::DepthwiseConvPerChannel() with the unfolded
+// parameters: EvalQuantizedPerChannelFolded() over depth multipliers,
+// strides, dilations and batches. The cases marked "reference" cannot be
+// folded (padded windows or a filter that is not constant) and check that
+// Prepare() falls back to the reference kernel. The int8 kernel clamps to
+// the int8 range whatever the fused activation (see
+// EvalQuantizedPerChannel()), so there are no activation cases. Prints the
+// times of both and exits with 1 on a mismatch.
+
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+#include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/kernels/internal/reference/integer_ops/depthwise_conv.h"
+#include "tensorflow/lite/kernels/internal/types.h"
+#include "tensorflow/lite/kernels/padding.h"
+#include "tensorflow/lite/micro/kernels/micro_ops.h"
+#include "tensorflow/lite/micro/tools/host/kernel_check.h"
+
+namespace {
+
+using tflite::host::ChannelQuantization;
+
+struct DepthwiseConvCase {
+  const char* name;
+  int batches;
+  int input_height;
+  int input_width;
+  int input_depth;
+  int filter_height;
+  int filter_width;
+  int depth_multiplier;
+  int stride;
+  int dilation;
+  TfLitePadding padding;
+  int input_zero_point;
+  bool constant_filter;
+};
+
+const DepthwiseConvCase kCases[] = {
+    {"3x3 20x20x8", 1, 20, 20, 8, 3, 3, 1, 1, 1, kTfLitePaddingValid, -128,
+     true},
+    {"3x3 24x16x32", 1, 24, 16, 32, 3, 3, 1, 1, 1, kTfLitePaddingValid, 3,
+     true},
+    {"3x3 multiplier 2 15x13x3", 1, 15, 13, 3, 3, 3, 2, 1, 1,
+     kTfLitePaddingValid, -9, true},
+    {"3x3 multiplier 3 stride 2 17x11x2", 1, 17, 11, 2, 3, 3, 3, 2, 1,
+     kTfLitePaddingValid, 21, true},
+    {"3x3 dilation 2 14x16x5", 1, 14, 16, 5, 3, 3, 1, 1, 2,
+     kTfLitePaddingValid, -1, true},
+    {"5x2 2 batches 9x7x4", 2, 9, 7, 4, 5, 2, 1, 1, 1, kTfLitePaddingValid,
+     64, true},
+    {"1x1 multiplier 2 single channel 6x5", 1, 6, 5, 1, 1, 1, 2, 1, 1,
+     kTfLitePaddingValid, 0, true},
+    // SAME padding that pads nothing still folds.
+    {"1x1 SAME 8x8x16", 1, 8, 8, 16, 1, 1, 1, 1, 1, kTfLitePaddingSame, -20,
+     true},
+    {"3x3 SAME 12x12x8, reference", 1, 12, 12, 8, 3, 3, 1, 1, 1,
+     kTfLitePaddingSame, -128, true},
+    {"3x3 mult 2 stride 2 SAME 11x10x3, reference", 1, 11, 10, 3, 3, 3, 2,
+     2, 1, kTfLitePaddingSame, 13, true},
+    {"3x3 variable filter 12x12x8, reference", 1, 12, 12, 8, 3, 3, 1, 1, 1,
+     kTfLitePaddingValid, -6, false},
+};
+
+bool Check(const DepthwiseConvCase& test, tflite::host::Random* random) {
+  int output_height, output_width;
+  const TfLitePaddingValues padding = tflite::ComputePaddingHeightWidth(
+      test.stride, test.stride, test.dilation, test.dilation,
+      test.input_height, test.input_width, test.filter_height,
+      test.filter_width, test.padding, &output_height, &output_width);
+  const int output_depth = test.input_depth * test.depth_multiplier;
+
+  int input_dims[] = {4, test.batches, test.input_height, test.input_width,
+                      test.input_depth};
+  int filter_dims[] = {4, 1, test.filter_height, test.filter_width,
+                       output_depth};
+  int bias_dims[] = {1, output_depth};
+  int output_dims[] = {4, test.batches, output_height, output_width,
+                       output_depth};
+  const int input_size =
+      test.batches * test.input_height * test.input_width * test.input_depth;
+  const int filter_size =
+      test.filter_height * test.filter_width * output_depth;
+  const int output_size =
+      test.batches * output_height * output_width * output_depth;
+
+  std::vector<int8_t> input(input_size);
+  std::vector<int8_t> filter(filter_size);
+  std::vector<int32_t> bias(output_depth);
+  std::vector<int8_t> output(output_size);
+  std::vector<int8_t> expected(output_size);
+  std::vector<float> filter_scales(output_depth);
+  random->Fill(input.data(), input_size, -128, 127);
+  random->Fill(filter.data(), filter_size, -127, 127);
+  random->Fill(bias.data(), output_depth, -20000, 20000);
+  for (float& scale : filter_scales) scale = random->Float(0.002f, 0.02f);
+
+  const float input_scale = 0.05f;
+  const float output_scale = 0.1f;
+  const int output_zero_point = -4;
+  ChannelQuantization filter_quantization;
+  TfLiteTensor tensors[] = {
+      tflite::host::Int8Tensor(input.data(), input_dims, input_scale,
+                               test.input_zero_point),
+      tflite::host::Int8Tensor(filter.data(), filter_dims, 1.0f, 0,
+                               test.constant_filter),
+      tflite::host::Int32Tensor(bias.data(), bias_dims,
+                                input_scale * filter_scales[0],
+                                /*constant=*/true),
+      tflite::host::Int8Tensor(output.data(), output_dims, output_scale,
+                               output_zero_point),
+  };
+  tflite::host::SetChannelQuantization(&tensors[1], 3, filter_scales.data(),
+                                       &filter_quantization);
+  int inputs[] = {3, 0, 1, 2};
+  int outputs[] = {1, 3};
+  TfLiteDepthwiseConvParams params = {};
+  params.padding = test.padding;
+  params.stride_width = test.stride;
+  params.stride_height = test.stride;
+  params.depth_multiplier = test.depth_multiplier;
+  params.activation = kTfLiteActNone;
+  params.dilation_width_factor = test.dilation;
+  params.dilation_height_factor = test.dilation;
+
+  const TfLiteRegistration registration =
+      tflite::ops::micro::Register_DEPTHWISE_CONV_2D();
+  tflite::host::KernelCheck kernel(registration, tensors, 4, inputs, outputs,
+                                   &params);
+  if (!kernel.Prepare() || !kernel.Invoke()) return false;
+
+  std::vector<int32_t> multipliers(output_depth);
+  std::vector<int32_t> shifts(output_depth);
+  tflite::host::ChannelMultipliers(input_scale, filter_scales.data(),
+                                   output_scale, output_depth,
+                                   multipliers.data(), shifts.data());
+  tflite::DepthwiseParams op_params;
+  op_params.input_offset = -test.input_zero_point;
+  op_params.weights_offset = 0;
+  op_params.output_offset = output_zero_point;
+  op_params.stride_height = test.stride;
+  op_params.stride_width = test.stride;
+  op_params.dilation_height_factor = test.dilation;
+  op_params.dilation_width_factor = test.dilation;
+  op_params.padding_values.height = padding.height;
+  op_params.padding_values.width = padding.width;
+  op_params.depth_multiplier = test.depth_multiplier;
+  op_params.quantized_activation_min = std::numeric_limits<int8_t>::min();
+  op_params.quantized_activation_max = std::numeric_limits<int8_t>::max();
+  const tflite::RuntimeShape input_shape(4, input_dims + 1);
+  const tflite::RuntimeShape filter_shape(4, filter_dims + 1);
+  const tflite::RuntimeShape bias_shape(1, bias_dims + 1);
+  const tflite::RuntimeShape output_shape(4, output_dims + 1);
+  auto reference = [&]() {
+    tflite::reference_integer_ops::DepthwiseConvPerChannel(
+        op_params, multipliers.data(), shifts.data(), input_shape,
+        input.data(), filter_shape, filter.data(), bias_shape, bias.data(),
+        output_shape, expected.data());
+  };
+  reference();
+
+  const bool same = tflite::host::SameOutput(test.name, output.data(),
+                                             expected.data(), output_size);
+  tflite::host::PrintResult(test.name, kernel.InvokeNanoseconds(),
+                            tflite::host::Nanoseconds(reference), same);
+  return same;
+}
+
+}  // namespace
+
+int main() {
+  tflite::host::Random random;
+  bool all_same = true;
+  tflite::host::PrintHeader();
+  for (const DepthwiseConvCase& test : kCases) {
+    all_same &= Check(test, &random);
+  }
+  return all_same ? 0 : 1;
+}
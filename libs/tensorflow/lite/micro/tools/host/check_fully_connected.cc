@@ -0,0 +1,155 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Checks the int8 FULLY_CONNECTED kernel of micro/kernels/fully_connected.cc
+// (EvalFullyConnectedInt8()) against reference_integer_ops::FullyConnected()
+// with the unfolded parameters: the 3844x3 layer of the keyword model,
+// shapes that leave every remainder of the four-row passes and of the
+// four-byte DSP loads, and weights with a zero point (the input_term of the
+// kernel). The cases marked "reference" have weights that are not constant,
+// which Prepare() does not fold. Built twice by the Makefile:
+// check_fully_connected runs the portable loops, check_fully_connected_dsp
+// the DSP path with the intrinsics of stubs/cmsis_compiler.h. Prints the
+// times of the kernel and of the reference and exits with 1 on a mismatch.
+
+#include <cstdio>
+#include <vector>
+
+#include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/kernels/internal/quantization_util.h"
+#include "tensorflow/lite/kernels/internal/reference/integer_ops/fully_connected.h"
+#include "tensorflow/lite/kernels/internal/types.h"
+#include "tensorflow/lite/micro/kernels/micro_ops.h"
+#include "tensorflow/lite/micro/tools/host/kernel_check.h"
+
+namespace {
+
+struct FullyConnectedCase {
+  const char* name;
+  int batches;
+  int accum_depth;
+  int output_depth;
+  TfLiteFusedActivation activation;
+  int input_zero_point;
+  int filter_zero_point;
+  bool constant_filter;
+};
+
+const FullyConnectedCase kCases[] = {
+    // The FULLY_CONNECTED layer of the keyword model.
+    {"3844 to 3", 1, 3844, 3, kTfLiteActNone, -128, 0, true},
+    {"3844 to 3 relu", 1, 3844, 3, kTfLiteActRelu, 7, 0, true},
+    {"256 to 64", 1, 256, 64, kTfLiteActNone, -1, 0, true},
+    {"250 to 10, 2 batches", 2, 250, 10, kTfLiteActNone, 12, 0, true},
+    {"37 to 5", 1, 37, 5, kTfLiteActRelu6, -50, 0, true},
+    {"3 to 2", 1, 3, 2, kTfLiteActNone, 0, 0, true},
+    {"1 to 1, 3 batches", 3, 1, 1, kTfLiteActNone, 127, 0, true},
+    {"3844 to 3, filter zero point", 1, 3844, 3, kTfLiteActNone, -128, 5,
+     true},
+    {"250 to 10, 2 batches, filter zero point", 2, 250, 10, kTfLiteActRelu,
+     -3, -17, true},
+    {"37 to 5, filter zero point", 1, 37, 5, kTfLiteActNone, 0, 1, true},
+    {"256 to 64 variable filter, reference", 1, 256, 64, kTfLiteActNone, -1,
+     0, false},
+    {"37 to 5 variable filter, reference", 1, 37, 5, kTfLiteActNone, 9, -2,
+     false},
+};
+
+bool Check(const FullyConnectedCase& test, tflite::host::Random* random) {
+  int input_dims[] = {2, test.batches, test.accum_depth};
+  int filter_dims[] = {2, test.output_depth, test.accum_depth};
+  int bias_dims[] = {1, test.output_depth};
+  int output_dims[] = {2, test.batches, test.output_depth};
+  const int input_size = test.batches * test.accum_depth;
+  const int filter_size = test.output_depth * test.accum_depth;
+  const int output_size = test.batches * test.output_depth;
+
+  std::vector<int8_t> input(input_size);
+  std::vector<int8_t> filter(filter_size);
+  std::vector<int32_t> bias(test.output_depth);
+  std::vector<int8_t> output(output_size);
+  std::vector<int8_t> expected(output_size);
+  random->Fill(input.data(), input_size, -128, 127);
+  random->Fill(filter.data(), filter_size, -127, 127);
+  random->Fill(bias.data(), test.output_depth, -20000, 20000);
+
+  const float input_scale = 0.05f;
+  const float filter_scale = 0.01f;
+  const float output_scale = 0.5f + 0.01f * test.accum_depth;
+  const int output_zero_point = -2;
+  TfLiteTensor tensors[] = {
+      tflite::host::Int8Tensor(input.data(), input_dims, input_scale,
+                               test.input_zero_point),
+      tflite::host::Int8Tensor(filter.data(), filter_dims, filter_scale,
+                               test.filter_zero_point, test.constant_filter),
+      tflite::host::Int32Tensor(bias.data(), bias_dims,
+                                input_scale * filter_scale,
+                                /*constant=*/true),
+      tflite::host::Int8Tensor(output.data(), output_dims, output_scale,
+                               output_zero_point),
+  };
+  int inputs[] = {3, 0, 1, 2};
+  int outputs[] = {1, 3};
+  TfLiteFullyConnectedParams params = {};
+  params.activation = test.activation;
+
+  const TfLiteRegistration registration =
+      tflite::ops::micro::Register_FULLY_CONNECTED();
+  tflite::host::KernelCheck kernel(registration, tensors, 4, inputs, outputs,
+                                   &params);
+  if (!kernel.Prepare() || !kernel.Invoke()) return false;
+
+  tflite::FullyConnectedParams op_params;
+  op_params.input_offset = -test.input_zero_point;
+  op_params.weights_offset = -test.filter_zero_point;
+  op_params.output_offset = output_zero_point;
+  tflite::QuantizeMultiplier(static_cast<double>(input_scale) *
+                                 static_cast<double>(filter_scale) /
+                                 static_cast<double>(output_scale),
+                             &op_params.output_multiplier,
+                             &op_params.output_shift);
+  tflite::host::Int8ActivationRange(
+      test.activation, output_scale, output_zero_point,
+      &op_params.quantized_activation_min,
+      &op_params.quantized_activation_max);
+  const tflite::RuntimeShape input_shape(2, input_dims + 1);
+  const tflite::RuntimeShape filter_shape(2, filter_dims + 1);
+  const tflite::RuntimeShape bias_shape(1, bias_dims + 1);
+  const tflite::RuntimeShape output_shape(2, output_dims + 1);
+  auto reference = [&]() {
+    tflite::reference_integer_ops::FullyConnected(
+        op_params, input_shape, input.data(), filter_shape, filter.data(),
+        bias_shape, bias.data(), output_shape, expected.data());
+  };
+  reference();
+
+  const bool same = tflite::host::SameOutput(test.name, output.data(),
+                                             expected.data(), output_size);
+  tflite::host::PrintResult(test.name, kernel.InvokeNanoseconds(),
+                            tflite::host::Nanoseconds(reference), same);
+  return same;
+}
+
+}  // namespace
+
+int main() {
+  tflite::host::Random random;
+  bool all_same = true;
+  tflite::host::PrintHeader();
+  for (const FullyConnectedCase& test : kCases) {
+    all_same &= Check(test, &random);
+  }
+  return all_same ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Checks the int8 MAX_POOL_2D and AVERAGE_POOL_2D kernels of
+// micro/kernels/pooling.cc against reference_integer_ops::MaxPool() and
+// AveragePool(): EvalInt8Windows() on 2x2 and 3x3 windows with strides 1 and
+// 2, one or more channels, rows whose size is not a multiple of the four
+// lanes, batches and activations. The cases marked "reference" have padded
+// windows and check that Prepare() falls back to the reference kernels.
+// Built twice by the Makefile: check_pooling runs the portable loops,
+// check_pooling_dsp the packed lanes with the intrinsics of
+// stubs/cmsis_compiler.h. Prints the times of both and exits with 1 on a
+// mismatch.
+
+#include <cstdio>
+#include <vector>
+
+#include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/kernels/internal/reference/integer_ops/pooling.h"
+#include "tensorflow/lite/kernels/internal/types.h"
+#include "tensorflow/lite/kernels/padding.h"
+#include "tensorflow/lite/micro/kernels/micro_ops.h"
+#include "tensorflow/lite/micro/tools/host/kernel_check.h"
+
+namespace {
+
+struct PoolingCase {
+  const char* name;
+  bool max;
+  int batches;
+  int input_height;
+  int input_width;
+  int depth;
+  int filter;
+  int stride;
+  TfLitePadding padding;
+  TfLiteFusedActivation activation;
+};
+
+const PoolingCase kCases[] = {
+    {"max 2x2 stride 2 32x32x1", true, 1, 32, 32, 1, 2, 2,
+     kTfLitePaddingValid, kTfLiteActNone},
+    {"avg 2x2 stride 2 32x32x1", false, 1, 32, 32, 1, 2, 2,
+     kTfLitePaddingValid, kTfLiteActNone},
+    {"max 3x3 stride 1 25x30x1", true, 1, 25, 30, 1, 3, 1,
+     kTfLitePaddingValid, kTfLiteActNone},
+    {"avg 3x3 stride 1 25x30x1", false, 1, 25, 30, 1, 3, 1,
+     kTfLitePaddingValid, kTfLiteActNone},
+    {"max 3x3 stride 2 31x29x8", true, 1, 31, 29, 8, 3, 2,
+     kTfLitePaddingValid, kTfLiteActNone},
+    {"avg 3x3 stride 2 31x29x8", false, 1, 31, 29, 8, 3, 2,
+     kTfLitePaddingValid, kTfLiteActNone},
+    {"max 2x2 stride 2 124x30x3", true, 1, 124, 30, 3, 2, 2,
+     kTfLitePaddingValid, kTfLiteActNone},
+    {"avg 2x2 stride 2 124x30x3", false, 1, 124, 30, 3, 2, 2,
+     kTfLitePaddingValid, kTfLiteActNone},
+    {"max 2x2 stride 1 2 batches 9x11x2", true, 2, 9, 11, 2, 2, 1,
+     kTfLitePaddingValid, kTfLiteActNone},
+    {"avg 2x2 stride 2 2 batches 15x15x5", false, 2, 15, 15, 5, 2, 2,
+     kTfLitePaddingValid, kTfLiteActNone},
+    {"max 3x3 stride 1 relu 12x13x7", true, 1, 12, 13, 7, 3, 1,
+     kTfLitePaddingValid, kTfLiteActRelu},
+    {"avg 3x3 stride 1 relu6 12x13x7", false, 1, 12, 13, 7, 3, 1,
+     kTfLitePaddingValid, kTfLiteActRelu6},
+    {"max 2x2 stride 2 relu6 3x3x16", true, 1, 3, 3, 16, 2, 2,
+     kTfLitePaddingValid, kTfLiteActRelu6},
+    {"avg 3x3 stride 2 3x3x1", false, 1, 3, 3, 1, 3, 2, kTfLitePaddingValid,
+     kTfLiteActNone},
+    {"max 3x3 SAME 10x10x4, reference", true, 1, 10, 10, 4, 3, 1,
+     kTfLitePaddingSame, kTfLiteActNone},
+    {"avg 2x2 stride 2 SAME 11x11x2, reference", false, 1, 11, 11, 2, 2, 2,
+     kTfLitePaddingSame, kTfLiteActNone},
+};
+
+bool Check(const PoolingCase& test, tflite::host::Random* random) {
+  int output_height, output_width;
+  const TfLitePaddingValues padding = tflite::ComputePaddingHeightWidth(
+      test.stride, test.stride, /*dilation_rate_height=*/1,
+      /*dilation_rate_width=*/1, test.input_height, test.input_width,
+      test.filter, test.filter, test.padding, &output_height, &output_width);
+
+  int input_dims[] = {4, test.batches, test.input_height, test.input_width,
+                      test.depth};
+  int output_dims[] = {4, test.batches, output_height, output_width,
+                       test.depth};
+  const int input_size =
+      test.batches * test.input_height * test.input_width * test.depth;
+  const int output_size =
+      test.batches * output_height * output_width * test.depth;
+
+  std::vector<int8_t> input(input_size);
+  std::vector<int8_t> output(output_size);
+  std::vector<int8_t> expected(output_size);
+  random->Fill(input.data(), input_size, -128, 127);
+
+  // Pooling keeps the quantization of its input.
+  const float scale = 0.1f;
+  const int zero_point = -10;
+  TfLiteTensor tensors[] = {
+      tflite::host::Int8Tensor(input.data(), input_dims, scale, zero_point),
+      tflite::host::Int8Tensor(output.data(), output_dims, scale, zero_point),
+  };
+  int inputs[] = {1, 0};
+  int outputs[] = {1, 1};
+  TfLitePoolParams params = {};
+  params.padding = test.padding;
+  params.stride_width = test.stride;
+  params.stride_height = test.stride;
+  params.filter_width = test.filter;
+  params.filter_height = test.filter;
+  params.activation = test.activation;
+
+  const TfLiteRegistration registration =
+      test.max ? tflite::ops::micro::Register_MAX_POOL_2D()
+               : tflite::ops::micro::Register_AVERAGE_POOL_2D();
+  tflite::host::KernelCheck kernel(registration, tensors, 2, inputs, outputs,
+                                   &params);
+  if (!kernel.Prepare() || !kernel.Invoke()) return false;
+
+  tflite::PoolParams op_params;
+  op_params.stride_height = test.stride;
+  op_params.stride_width = test.stride;
+  op_params.filter_height = test.filter;
+  op_params.filter_width = test.filter;
+  op_params.padding_values.height = padding.height;
+  op_params.padding_values.width = padding.width;
+  tflite::host::Int8ActivationRange(test.activation, scale, zero_point,
+                                    &op_params.quantized_activation_min,
+                                    &op_params.quantized_activation_max);
+  const tflite::RuntimeShape input_shape(4, input_dims + 1);
+  const tflite::RuntimeShape output_shape(4, output_dims + 1);
+  auto reference = [&]() {
+    if (test.max) {
+      tflite::reference_integer_ops::MaxPool(op_params, input_shape,
+                                             input.data(), output_shape,
+                                             expected.data());
+    } else {
+      tflite::reference_integer_ops::AveragePool(op_params, input_shape,
+                                                 input.data(), output_shape,
+                                                 expected.data());
+    }
+  };
+  reference();
+
+  const bool same = tflite::host::SameOutput(test.name, output.data(),
+                                             expected.data(), output_size);
+  tflite::host::PrintResult(test.name, kernel.InvokeNanoseconds(),
+                            tflite::host::Nanoseconds(reference), same);
+  return same;
+}
+
+}  // namespace
+
+int main() {
+  tflite::host::Random random;
+  bool all_same = true;
+  tflite::host::PrintHeader();
+  for (const PoolingCase& test : kCases) {
+    all_same &= Check(test, &random);
+  }
+  return all_same ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Checks the int8 SOFTMAX kernel of micro/kernels/softmax.cc
+// (SoftmaxInt8Lut() over the table of PopulateExpLut()) against
+// reference_ops::Softmax() with parameters computed here, for int8 and int16
+// output: several betas and input scales, including ones where diff_min
+// drops part of the table, row lengths from 1 to 1000 and rows of nearly
+// equal values. Prints the times of both and exits with 1 on a mismatch.
+
+#include <cstdio>
+#include <vector>
+
+#include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/kernels/internal/quantization_util.h"
+#include "tensorflow/lite/kernels/internal/reference/softmax.h"
+#include "tensorflow/lite/kernels/internal/types.h"
+#include "tensorflow/lite/micro/kernels/micro_ops.h"
+#include "tensorflow/lite/micro/tools/host/kernel_check.h"
+
+namespace {
+
+struct SoftmaxCase {
+  const char* name;
+  int rows;
+  int depth;
+  float beta;
+  float input_scale;
+  int input_zero_point;
+  // Range of the random input values.
+  int input_min;
+  int input_max;
+};
+
+const SoftmaxCase kCases[] = {
+    // The output of the keyword model.
+    {"3 classes", 1, 3, 1.0f, 0.1f, -20, -128, 127},
+    {"12 classes", 1, 12, 1.0f, 0.0625f, 5, -128, 127},
+    {"12 classes, 8 rows", 8, 12, 1.0f, 0.0625f, 5, -128, 127},
+    {"1000 classes", 1, 1000, 1.0f, 0.05f, -128, -128, 127},
+    {"1 class, 4 rows", 4, 1, 1.0f, 0.1f, 0, -128, 127},
+    {"beta 0.5", 2, 37, 0.5f, 0.1f, 0, -128, 127},
+    {"beta 2", 2, 37, 2.0f, 0.1f, 0, -128, 127},
+    {"input scale 0.003", 3, 64, 1.0f, 0.003f, 0, -128, 127},
+    // diff_min drops the exponentials of the larger differences.
+    {"input scale 0.5, diff_min", 3, 64, 1.0f, 0.5f, 0, -128, 127},
+    {"input scale 2, diff_min", 2, 20, 1.0f, 2.0f, -1, -128, 127},
+    {"nearly equal values", 4, 50, 1.0f, 0.1f, 0, 60, 64},
+    {"all equal values", 1, 16, 1.0f, 0.1f, 0, -7, -7},
+};
+
+template <typename OutputT>
+TfLiteTensor OutputTensor(OutputT* data, int* dims);
+
+template <>
+TfLiteTensor OutputTensor(int8_t* data, int* dims) {
+  return tflite::host::Int8Tensor(data, dims, 1.0f / 256, -128);
+}
+
+template <>
+TfLiteTensor OutputTensor(int16_t* data, int* dims) {
+  return tflite::host::Int16Tensor(data, dims, 1.0f / 32768, -32768);
+}
+
+template <typename OutputT>
+bool Check(const SoftmaxCase& test, const char* name,
+           tflite::host::Random* random) {
+  int dims[] = {2, test.rows, test.depth};
+  const int size = test.rows * test.depth;
+
+  std::vector<int8_t> input(size);
+  std::vector<OutputT> output(size);
+  std::vector<OutputT> expected(size);
+  random->Fill(input.data(), size, test.input_min, test.input_max);
+
+  TfLiteTensor tensors[] = {
+      tflite::host::Int8Tensor(input.data(), dims, test.input_scale,
+                               test.input_zero_point),
+      OutputTensor(output.data(), dims),
+  };
+  int inputs[] = {1, 0};
+  int outputs[] = {1, 1};
+  TfLiteSoftmaxParams params = {test.beta};
+
+  const TfLiteRegistration registration =
+      tflite::ops::micro::Register_SOFTMAX();
+  tflite::host::KernelCheck kernel(registration, tensors, 2, inputs, outputs,
+                                   &params);
+  if (!kernel.Prepare() || !kernel.Invoke()) return false;
+
+  constexpr int kScaledDiffIntegerBits = 5;
+  tflite::SoftmaxParams op_params;
+  int input_left_shift;
+  tflite::PreprocessSoftmaxScaling(
+      static_cast<double>(test.beta), static_cast<double>(test.input_scale),
+      kScaledDiffIntegerBits, &op_params.input_multiplier,
+      &input_left_shift);
+  op_params.input_left_shift = input_left_shift;
+  op_params.diff_min =
+      -tflite::CalculateInputRadius(kScaledDiffIntegerBits, input_left_shift);
+  const tflite::RuntimeShape shape(2, dims + 1);
+  auto reference = [&]() {
+    tflite::reference_ops::Softmax(op_params, shape, input.data(), shape,
+                                   expected.data());
+  };
+  reference();
+
+  const bool same =
+      tflite::host::SameOutput(name, output.data(), expected.data(), size);
+  tflite::host::PrintResult(name, kernel.InvokeNanoseconds(),
+                            tflite::host::Nanoseconds(reference), same);
+  return same;
+}
+
+}  // namespace
+
+int main() {
+  tflite::host::Random random;
+  bool all_same = true;
+  tflite::host::PrintHeader();
+  char name[64];
+  for (const SoftmaxCase& test : kCases) {
+    snprintf(name, sizeof(name), "%s, int8", test.name);
+    all_same &= Check<int8_t>(test, name, &random);
+    snprintf(name, sizeof(name), "%s, int16", test.name);
+    all_same &= Check<int16_t>(test, name, &random);
+  }
+  return all_same ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Checks a static plan written by generate_static_plan against
+// MicroInterpreter on the same model: the outputs of both must be the same
+// bytes for random inputs, over several invocations so that the state of
+// variable tensors is compared too. Prints the setup and invoke times of both
+// and exits with 1 on a mismatch.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "model_plan.h"
+#include "tensorflow/lite/micro/all_ops_resolver.h"
+#include "tensorflow/lite/micro/memory_helpers.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_static_plan.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace {
+
+constexpr size_t kTensorArenaSize = 1024 * 1024;
+constexpr int kInvocations = 20;
+alignas(16) uint8_t interpreter_arena[kTensorArenaSize];
+alignas(16) uint8_t plan_arena[kTensorArenaSize];
+
+using Clock = std::chrono::steady_clock;
+
+double Microseconds(Clock::duration duration) {
+  return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+}  // namespace
+
+int main() {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::AllOpsResolver resolver;
+  const tflite::Model* model = tflite::GetModel(model_plan::kPlan.model_data);
+
+  Clock::time_point start = Clock::now();
+  tflite::MicroInterpreter interpreter(model, resolver, interpreter_arena,
+                                       kTensorArenaSize,
+                                       &micro_error_reporter);
+  if (interpreter.AllocateTensors() != kTfLiteOk) {
+    fprintf(stderr, "AllocateTensors() failed\n");
+    return 1;
+  }
+  const double interpreter_setup = Microseconds(Clock::now() - start);
+
+  start = Clock::now();
+  tflite::StaticPlanRunner runner(model_plan::kPlan, plan_arena,
+                                  kTensorArenaSize, &micro_error_reporter);
+  if (runner.Setup() != kTfLiteOk) {
+    fprintf(stderr, "StaticPlanRunner::Setup() failed\n");
+    return 1;
+  }
+  const double plan_setup = Microseconds(Clock::now() - start);
+
+  if (interpreter.inputs_size() != runner.inputs_size() ||
+      interpreter.outputs_size() != runner.outputs_size()) {
+    fprintf(stderr, "The plan has other inputs or outputs than the model\n");
+    return 1;
+  }
+
+  srand(1);
+  double interpreter_invoke = 0;
+  double plan_invoke = 0;
+  int mismatches = 0;
+  for (int invocation = 0; invocation < kInvocations; ++invocation) {
+    for (size_t i = 0; i < interpreter.inputs_size(); ++i) {
+      TfLiteTensor* input = interpreter.input(i);
+      for (size_t b = 0; b < input->bytes; ++b) {
+        input->data.uint8[b] = static_cast<uint8_t>(rand());
+      }
+      // Random bytes are no valid floats, use values in [-1, 1] for those.
+      if (input->type == kTfLiteFloat32) {
+        for (size_t f = 0; f < input->bytes / sizeof(float); ++f) {
+          input->data.f[f] = 2.0f * rand() / RAND_MAX - 1.0f;
+        }
+      }
+      memcpy(runner.input(i)->data.raw, input->data.raw, input->bytes);
+    }
+
+    start = Clock::now();
+    if (interpreter.Invoke() != kTfLiteOk) {
+      fprintf(stderr, "MicroInterpreter::Invoke() failed\n");
+      return 1;
+    }
+    interpreter_invoke += Microseconds(Clock::now() - start);
+    start = Clock::now();
+    if (model_plan::Invoke(&runner) != kTfLiteOk) {
+      fprintf(stderr, "The Invoke() of the plan failed\n");
+      return 1;
+    }
+    plan_invoke += Microseconds(Clock::now() - start);
+
+    for (size_t i = 0; i < interpreter.outputs_size(); ++i) {
+      const TfLiteTensor* expected = interpreter.output(i);
+      const TfLiteEvalTensor* output = runner.output(i);
+      size_t bytes = 0;
+      tflite::TfLiteEvalTensorByteLength(output, &bytes);
+      if (bytes != expected->bytes ||
+          memcmp(output->data.raw, expected->data.raw, bytes) != 0) {
+        fprintf(stderr, "Invocation %d: output %zu differs\n", invocation, i);
+        ++mismatches;
+      }
+    }
+  }
+
+  printf("%-18s %12s %12s %12s\n", "", "setup (us)", "invoke (us)",
+         "arena bytes");
+  printf("%-18s %12.1f %12.1f %12zu\n", "MicroInterpreter", interpreter_setup,
+         interpreter_invoke / kInvocations, interpreter.arena_used_bytes());
+  printf("%-18s %12.1f %12.1f %12zu\n", "StaticPlanRunner", plan_setup,
+         plan_invoke / kInvocations, runner.arena_used_bytes());
+  if (mismatches > 0) {
+    printf("%d mismatches in %d invocations\n", mismatches, kInvocations);
+    return 1;
+  }
+  printf("Outputs are the same in %d invocations\n", kInvocations);
+  return 0;
+}
@@ -0,0 +1,316 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Compares the memory planners of MemoryPlannerType:
+//  - On the mock models of test_helpers.h and the models of the firmware, the
+//    arena bytes and the AllocateTensors() time of MicroInterpreter with each
+//    planner, and that the outputs of both are the same bytes.
+//  - On random graphs, the planners alone: the size of the layout against the
+//    lower bound (the most bytes alive at once), the planning time, and that
+//    no buffers that are alive at the same time overlap.
+// Exits with 1 if a check fails or BestFitMemoryPlanner is ever larger.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "tensorflow/lite/micro/benchmarks/keyword_scrambled_model_data.h"
+#include "tensorflow/lite/micro/examples/hello_world/model.h"
+#include "tensorflow/lite/micro/memory_planner/best_fit_memory_planner.h"
+#include "tensorflow/lite/micro/memory_planner/greedy_memory_planner.h"
+#include "tensorflow/lite/micro/micro_allocator.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/test_helpers.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace {
+
+constexpr size_t kTensorArenaSize = 1024 * 1024;
+constexpr int kAllocations = 200;
+constexpr int kPlans = 20;
+alignas(16) uint8_t greedy_arena[kTensorArenaSize];
+alignas(16) uint8_t best_fit_arena[kTensorArenaSize];
+
+using Clock = std::chrono::steady_clock;
+
+double Microseconds(Clock::duration duration) {
+  return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+int failures = 0;
+
+// Average AllocateTensors() time of `model` over kAllocations fresh
+// allocators in `arena`, in microseconds.
+double TimeAllocateTensors(const tflite::Model* model,
+                           const tflite::MicroOpResolver& resolver,
+                           tflite::MemoryPlannerType type, uint8_t* arena,
+                           tflite::ErrorReporter* error_reporter) {
+  double total = 0;
+  for (int i = 0; i < kAllocations; ++i) {
+    tflite::MicroAllocator* allocator = tflite::MicroAllocator::Create(
+        arena, kTensorArenaSize, error_reporter, type);
+    tflite::MicroInterpreter interpreter(model, resolver, allocator,
+                                         error_reporter);
+    Clock::time_point start = Clock::now();
+    if (interpreter.AllocateTensors() != kTfLiteOk) return -1;
+    total += Microseconds(Clock::now() - start);
+  }
+  return total / kAllocations;
+}
+
+// `invoke` is false for the models that are only meant to be allocated.
+void CompareOnModel(const char* name, const tflite::Model* model,
+                    const tflite::MicroOpResolver& resolver,
+                    tflite::ErrorReporter* error_reporter,
+                    bool invoke = true) {
+  tflite::MicroInterpreter greedy(
+      model, resolver,
+      tflite::MicroAllocator::Create(greedy_arena, kTensorArenaSize,
+                                     error_reporter,
+                                     tflite::MemoryPlannerType::kGreedy),
+      error_reporter);
+  tflite::MicroInterpreter best_fit(
+      model, resolver,
+      tflite::MicroAllocator::Create(best_fit_arena, kTensorArenaSize,
+                                     error_reporter,
+                                     tflite::MemoryPlannerType::kBestFit),
+      error_reporter);
+  if (greedy.AllocateTensors() != kTfLiteOk ||
+      best_fit.AllocateTensors() != kTfLiteOk) {
+    printf("%-22s AllocateTensors() failed\n", name);
+    ++failures;
+    return;
+  }
+
+  // The same inputs must give the same outputs whatever the layout.
+  srand(1);
+  for (size_t i = 0; i < greedy.inputs_size(); ++i) {
+    TfLiteTensor* input = greedy.input(i);
+    for (size_t b = 0; b < input->bytes; ++b) {
+      input->data.uint8[b] = static_cast<uint8_t>(rand());
+    }
+    // Random bytes are no valid floats, use values in [-1, 1] for those.
+    if (input->type == kTfLiteFloat32) {
+      for (size_t f = 0; f < input->bytes / sizeof(float); ++f) {
+        input->data.f[f] = 2.0f * rand() / RAND_MAX - 1.0f;
+      }
+    }
+    memcpy(best_fit.input(i)->data.raw, input->data.raw, input->bytes);
+  }
+  bool same_outputs = true;
+  if (invoke) {
+    same_outputs = greedy.Invoke() == kTfLiteOk &&
+                   best_fit.Invoke() == kTfLiteOk &&
+                   greedy.outputs_size() == best_fit.outputs_size();
+    for (size_t i = 0; same_outputs && i < greedy.outputs_size(); ++i) {
+      const TfLiteTensor* expected = greedy.output(i);
+      const TfLiteTensor* output = best_fit.output(i);
+      same_outputs = output->bytes == expected->bytes &&
+                     memcmp(output->data.raw, expected->data.raw,
+                            expected->bytes) == 0;
+    }
+  }
+
+  const double greedy_us =
+      TimeAllocateTensors(model, resolver, tflite::MemoryPlannerType::kGreedy,
+                          greedy_arena, error_reporter);
+  const double best_fit_us = TimeAllocateTensors(
+      model, resolver, tflite::MemoryPlannerType::kBestFit, best_fit_arena,
+      error_reporter);
+
+  printf("%-22s %10zu %10zu %10.1f %10.1f %s\n", name,
+         greedy.arena_used_bytes(), best_fit.arena_used_bytes(), greedy_us,
+         best_fit_us,
+         !invoke ? "not invoked"
+                 : same_outputs ? "same outputs" : "OUTPUTS DIFFER");
+  if (!same_outputs ||
+      best_fit.arena_used_bytes() > greedy.arena_used_bytes()) {
+    ++failures;
+  }
+}
+
+struct Buffer {
+  int size;
+  int first_time_used;
+  int last_time_used;
+};
+
+// A chain of `node_count` nodes in which each node outputs a buffer used by
+// one to three of the next nodes, and some buffers live long (skip
+// connections), with sizes of a few bytes to a few KB in steps of 16.
+std::vector<Buffer> RandomGraph(int node_count) {
+  std::vector<Buffer> buffers;
+  for (int node = 0; node < node_count; ++node) {
+    Buffer buffer;
+    buffer.size = 16 * (1 + rand() % 256);
+    buffer.first_time_used = node;
+    int lifetime = 1 + rand() % 3;
+    if (rand() % 8 == 0) lifetime += rand() % (node_count / 4 + 1);
+    buffer.last_time_used = node + lifetime;
+    if (buffer.last_time_used >= node_count) {
+      buffer.last_time_used = node_count - 1;
+    }
+    buffers.push_back(buffer);
+  }
+  return buffers;
+}
+
+int LowerBound(const std::vector<Buffer>& buffers) {
+  int bound = 0;
+  for (const Buffer& at : buffers) {
+    int alive = 0;
+    for (const Buffer& buffer : buffers) {
+      if (buffer.first_time_used <= at.first_time_used &&
+          buffer.last_time_used >= at.first_time_used) {
+        alive += buffer.size;
+      }
+    }
+    if (alive > bound) bound = alive;
+  }
+  return bound;
+}
+
+// Plans `buffers` kPlans times with a new planner each time, returns the size
+// of the layout, or -1 if two buffers alive at the same time overlap.
+template <typename Planner>
+int Plan(const std::vector<Buffer>& buffers, size_t per_buffer_size,
+         tflite::ErrorReporter* error_reporter, double* plan_us) {
+  std::vector<unsigned char> scratch(buffers.size() * per_buffer_size);
+  std::vector<int> offsets(buffers.size());
+  int size = 0;
+  Clock::time_point start = Clock::now();
+  for (int plan = 0; plan < kPlans; ++plan) {
+    Planner planner(scratch.data(), scratch.size());
+    for (const Buffer& buffer : buffers) {
+      planner.AddBuffer(error_reporter, buffer.size, buffer.first_time_used,
+                        buffer.last_time_used);
+    }
+    size = planner.GetMaximumMemorySize();
+    for (size_t i = 0; i < buffers.size(); ++i) {
+      planner.GetOffsetForBuffer(error_reporter, i, &offsets[i]);
+    }
+  }
+  *plan_us = Microseconds(Clock::now() - start) / kPlans;
+
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    for (size_t j = i + 1; j < buffers.size(); ++j) {
+      const Buffer& a = buffers[i];
+      const Buffer& b = buffers[j];
+      if (a.first_time_used > b.last_time_used ||
+          b.first_time_used > a.last_time_used) {
+        continue;
+      }
+      if (offsets[i] < offsets[j] + b.size &&
+          offsets[j] < offsets[i] + a.size) {
+        return -1;
+      }
+    }
+  }
+  return size;
+}
+
+void CompareOnRandomGraphs(int node_count, int graph_count,
+                           tflite::ErrorReporter* error_reporter) {
+  long long bound_total = 0;
+  long long greedy_total = 0;
+  long long best_fit_total = 0;
+  double greedy_us = 0;
+  double best_fit_us = 0;
+  int smaller = 0;
+  for (int graph = 0; graph < graph_count; ++graph) {
+    const std::vector<Buffer> buffers = RandomGraph(node_count);
+    double us = 0;
+    const int greedy = Plan<tflite::GreedyMemoryPlanner>(
+        buffers, tflite::GreedyMemoryPlanner::per_buffer_size(),
+        error_reporter, &us);
+    greedy_us += us;
+    const int best_fit = Plan<tflite::BestFitMemoryPlanner>(
+        buffers, tflite::BestFitMemoryPlanner::per_buffer_size(),
+        error_reporter, &us);
+    best_fit_us += us;
+    if (greedy < 0 || best_fit < 0 || best_fit > greedy) {
+      printf("random %d nodes, graph %d: greedy %d, best fit %d\n", node_count,
+             graph, greedy, best_fit);
+      ++failures;
+      continue;
+    }
+    if (best_fit < greedy) ++smaller;
+    bound_total += LowerBound(buffers);
+    greedy_total += greedy;
+    best_fit_total += best_fit;
+  }
+  char name[32];
+  snprintf(name, sizeof(name), "random %d nodes", node_count);
+  printf("%-22s %9.2f%% %9.2f%% %10.1f %10.1f smaller in %d of %d\n", name,
+         100.0 * greedy_total / bound_total,
+         100.0 * best_fit_total / bound_total, greedy_us / graph_count,
+         best_fit_us / graph_count, smaller, graph_count);
+}
+
+}  // namespace
+
+int main() {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::AllOpsResolver resolver = tflite::testing::GetOpResolver();
+
+  // Two offline planned tensors and two online planned ones (see
+  // OfflineMemoryAllocation in micro_allocator.cc). Its nodes lack the weight
+  // input that mock_custom reads, so it is not invoked.
+  const int32_t offline_metadata[] = {/*version=*/1, /*subgraph=*/0,
+                                      /*tensor count=*/4, 0, 48, -1, -1};
+  tflite::testing::NodeConnection offline_nodes[] = {
+      {{0}, {1}}, {{1}, {2}}, {{2}, {3}}};
+
+  printf("%-22s %10s %10s %10s %10s\n", "model", "greedy", "best fit",
+         "greedy", "best fit");
+  printf("%-22s %10s %10s %10s %10s\n", "", "arena B", "arena B", "alloc us",
+         "alloc us");
+  CompareOnModel("simple_mock", tflite::testing::GetSimpleMockModel(),
+                 resolver, &micro_error_reporter);
+  CompareOnModel("complex_mock", tflite::testing::GetComplexMockModel(),
+                 resolver, &micro_error_reporter);
+  CompareOnModel("simple_with_branch",
+                 tflite::testing::GetSimpleModelWithBranch(), resolver,
+                 &micro_error_reporter);
+  CompareOnModel("simple_stateful", tflite::testing::GetSimpleStatefulModel(),
+                 resolver, &micro_error_reporter);
+  CompareOnModel("offline_planning",
+                 tflite::testing::GetModelWithOfflinePlanning(
+                     4, offline_metadata, offline_nodes, 3),
+                 resolver, &micro_error_reporter, /*invoke=*/false);
+  CompareOnModel("g_model", tflite::GetModel(g_model), resolver,
+                 &micro_error_reporter);
+  CompareOnModel("keyword_scrambled",
+                 tflite::GetModel(g_keyword_scrambled_model_data), resolver,
+                 &micro_error_reporter);
+
+  printf("\n%-22s %10s %10s %10s %10s\n", "graphs", "greedy", "best fit",
+         "greedy", "best fit");
+  printf("%-22s %10s %10s %10s %10s\n", "", "of bound", "of bound", "plan us",
+         "plan us");
+  srand(1);
+  CompareOnRandomGraphs(16, 200, &micro_error_reporter);
+  CompareOnRandomGraphs(64, 100, &micro_error_reporter);
+  CompareOnRandomGraphs(256, 20, &micro_error_reporter);
+
+  if (failures > 0) {
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  return 0;
+}
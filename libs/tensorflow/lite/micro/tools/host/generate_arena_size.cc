@@ -0,0 +1,231 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Sizes the tensor arena of one model: finds the smallest arena in which
+// the setup of the firmware (AllocateTensors(), input(0), output(0) and
+// SkipOutputSoftmax(0) of the argmax-only mode) succeeds, prints where the
+// bytes go with RecordingMicroAllocator, and writes a header with the size.
+//
+// The smallest arena is more than the head and the tail that are in use
+// after AllocateTensors(): the planner works in the free space between them
+// while it plans, so the size is searched for rather than summed.
+//
+// The tool runs on a 64-bit host, where the persistent structures in the tail
+// (TfLiteTensor, TfLiteEvalTensor, NodeAndRegistration, ...) hold 8-byte
+// pointers. The head, the planned tensors and scratch buffers, is the same on
+// the 32-bit target, its tail is smaller, so the size is an upper bound
+// there.
+//
+// Usage: generate_arena_size MODEL [--guard GUARD] [--output FILE]
+// MODEL is a .tflite file or its `xxd -i` array (model.cc). The header goes
+// to stdout without --output, the report to stderr.
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "tensorflow/lite/micro/all_ops_resolver.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/recording_micro_allocator.h"
+#include "tensorflow/lite/micro/tools/host/model_file.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace {
+
+constexpr size_t kMaxArenaSize = 1024 * 1024;
+alignas(16) uint8_t tensor_arena[kMaxArenaSize];
+
+// Drops the errors of the arenas that are too small while searching.
+class SilentErrorReporter : public tflite::ErrorReporter {
+ public:
+  int Report(const char* format, va_list args) override { return 0; }
+};
+
+// The setup of main_functions.cc.
+bool SetUp(tflite::MicroInterpreter* interpreter) {
+  if (interpreter->AllocateTensors() != kTfLiteOk) return false;
+  if (interpreter->input(0) == nullptr || interpreter->output(0) == nullptr) {
+    return false;
+  }
+  // Models without a final SOFTMAX over int8 logits allocate nothing here.
+  interpreter->SkipOutputSoftmax(0, nullptr);
+  return interpreter->arena_used_bytes() > 0;
+}
+
+// Returns the bytes in use after the setup in an arena of `arena_size` bytes,
+// 0 if it fails.
+size_t SetsUp(const tflite::Model* model,
+              const tflite::MicroOpResolver& resolver, size_t arena_size) {
+  SilentErrorReporter silent_error_reporter;
+  tflite::MicroInterpreter interpreter(model, resolver, tensor_arena,
+                                       arena_size, &silent_error_reporter);
+  return SetUp(&interpreter) ? interpreter.arena_used_bytes() : 0;
+}
+
+struct Breakdown {
+  tflite::RecordedAllocationType type;
+  const char* name;
+};
+
+const Breakdown kBreakdown[] = {
+    {tflite::RecordedAllocationType::kTfLiteEvalTensorData,
+     "TfLiteEvalTensor data"},
+    {tflite::RecordedAllocationType::kPersistentTfLiteTensorData,
+     "Persistent TfLiteTensor data"},
+    {tflite::RecordedAllocationType::kPersistentTfLiteTensorQuantizationData,
+     "Persistent TfLiteTensor quantization data"},
+    {tflite::RecordedAllocationType::kTfLiteTensorVariableBufferData,
+     "TfLiteTensor variable buffer data"},
+    {tflite::RecordedAllocationType::kNodeAndRegistrationArray,
+     "NodeAndRegistration structs"},
+    {tflite::RecordedAllocationType::kOpData, "Operator runtime data"},
+};
+
+struct ArenaSize {
+  size_t minimum;
+  size_t head;
+  size_t tail;
+};
+
+// Prints the head and the tail of the setup by RecordedAllocationType and
+// returns the head. The recording allocators are larger than those of the
+// firmware, which uses `used_bytes` in all.
+bool Record(const tflite::Model* model,
+            const tflite::MicroOpResolver& resolver, size_t used_bytes,
+            size_t* head_bytes) {
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::RecordingMicroAllocator* allocator =
+      tflite::RecordingMicroAllocator::Create(tensor_arena, kMaxArenaSize,
+                                              &micro_error_reporter);
+  tflite::MicroInterpreter interpreter(model, resolver, allocator,
+                                       &micro_error_reporter);
+  if (!SetUp(&interpreter)) {
+    fprintf(stderr, "The setup fails in a %zu bytes arena\n", kMaxArenaSize);
+    return false;
+  }
+  const tflite::RecordingSimpleMemoryAllocator* memory_allocator =
+      allocator->GetSimpleMemoryAllocator();
+  const size_t head = memory_allocator->GetHeadUsedBytes();
+  const size_t tail = memory_allocator->GetTailUsedBytes();
+
+  fprintf(stderr, "%-44s %8s %8s %6s\n", "", "bytes", "asked", "count");
+  fprintf(stderr, "%-44s %8zu\n", "head: planned tensors and scratch buffers",
+          head);
+  fprintf(stderr, "%-44s %8zu\n", "tail: persistent", tail);
+  size_t recorded = 0;
+  for (const Breakdown& breakdown : kBreakdown) {
+    const tflite::RecordedAllocation allocation =
+        allocator->GetRecordedAllocation(breakdown.type);
+    fprintf(stderr, "  %-42s %8zu %8zu %6zu\n", breakdown.name,
+            allocation.used_bytes, allocation.requested_bytes,
+            allocation.count);
+    recorded += allocation.used_bytes;
+  }
+  // The allocators themselves, the TfLiteTensors of input(0) and output(0),
+  // the persistent buffers of the kernels, ...
+  fprintf(stderr, "  %-42s %8zu\n", "other", tail - recorded);
+  fprintf(stderr, "  %-42s %8zu\n", "of which recording allocators",
+          head + tail - used_bytes);
+  *head_bytes = head;
+  return true;
+}
+
+void WriteHeader(FILE* out, const std::string& model_name,
+                 const std::string& guard, const ArenaSize& size) {
+  fprintf(out,
+          "// Generated by tensorflow/lite/micro/tools/host/"
+          "generate_arena_size from\n"
+          "// %s, do not edit.\n\n",
+          model_name.c_str());
+  fprintf(out, "#ifndef %s\n#define %s\n\n", guard.c_str(), guard.c_str());
+  fprintf(out,
+          "// The smallest tensor arena the setup of %s succeeds in, on a\n"
+          "// 64-bit host: %zu bytes of head (planned tensors and scratch\n"
+          "// buffers), %zu bytes of tail (persistent data) and %zu bytes the\n"
+          "// planner works in during AllocateTensors(). The tail is smaller "
+          "on the\n"
+          "// 32-bit target, so this is an upper bound there.\n",
+          model_name.c_str(), size.head, size.tail,
+          size.minimum - size.head - size.tail);
+  fprintf(out, "constexpr int kModelArenaSize = %zu;\n\n", size.minimum);
+  fprintf(out, "#endif  // %s\n", guard.c_str());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const char* model_path = nullptr;
+  const char* output_path = nullptr;
+  std::string guard = "MODEL_ARENA_SIZE_H_";
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--guard") == 0 && i + 1 < argc) {
+      guard = argv[++i];
+    } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+      output_path = argv[++i];
+    } else if (argv[i][0] != '-' && model_path == nullptr) {
+      model_path = argv[i];
+    } else {
+      model_path = nullptr;
+      break;
+    }
+  }
+  if (model_path == nullptr) {
+    fprintf(stderr, "Usage: %s MODEL [--guard GUARD] [--output FILE]\n",
+            argv[0]);
+    return 2;
+  }
+
+  std::vector<uint8_t> data;
+  const tflite::Model* model = tflite::host::LoadModel(model_path, &data);
+  if (model == nullptr) return 1;
+  tflite::AllOpsResolver resolver;
+
+  // The head and the tail are needed in any case, search above them.
+  const size_t used_bytes = SetsUp(model, resolver, kMaxArenaSize);
+  if (used_bytes == 0) {
+    fprintf(stderr, "The setup fails in a %zu bytes arena\n", kMaxArenaSize);
+    return 1;
+  }
+  ArenaSize size;
+  if (!Record(model, resolver, used_bytes, &size.head)) return 1;
+  size.tail = used_bytes - size.head;
+
+  size_t too_small = used_bytes - 1;
+  size_t large_enough = kMaxArenaSize;
+  while (large_enough - too_small > 1) {
+    const size_t middle = too_small + (large_enough - too_small) / 2;
+    if (SetsUp(model, resolver, middle) != 0) {
+      large_enough = middle;
+    } else {
+      too_small = middle;
+    }
+  }
+  size.minimum = large_enough;
+  fprintf(stderr, "%-44s %8zu\n", "planning space",
+          size.minimum - size.head - size.tail);
+  fprintf(stderr, "%-44s %8zu\n", "smallest arena", size.minimum);
+
+  FILE* out = output_path != nullptr ? fopen(output_path, "w") : stdout;
+  if (out == nullptr) {
+    fprintf(stderr, "%s: can not create\n", output_path);
+    return 1;
+  }
+  WriteHeader(out, tflite::host::BaseName(model_path), guard, size);
+  if (out != stdout) fclose(out);
+  return 0;
+}
@@ -0,0 +1,514 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Plans the arena of a model offline and writes the tensor offsets into the
+// OfflineMemoryAllocation metadata of the model, which MicroAllocator uses
+// instead of running GreedyMemoryPlanner at boot (see
+// GetOfflinePlannedOffsets() in micro_allocator.cc).
+//
+// The buffers and lifetimes are those of MicroAllocator for the model, after
+// FuseOperators(), with the scratch buffers the kernels request in Prepare.
+// The plan places the buffers first-fit in some order:
+//  - heuristic orders (by size, as GreedyMemoryPlanner, by size times
+//    lifetime, by lifetime, by creation) and random orders give a first plan,
+//  - a branch and bound search over the orders improves it, until the plan
+//    reaches the peak of live bytes (a lower bound, the plan is optimal) or
+//    the search ends or runs out of --max-nodes. Small graphs are searched
+//    exhaustively, larger ones keep the best plan found.
+// Scratch buffers stay planned at runtime, around the offline planned
+// tensors, so the result is checked with GreedyMemoryPlanner as
+// MicroAllocator runs it. The written model is then allocated and invoked
+// against the original one, the outputs must be the same bytes.
+//
+// The offsets are only valid for the fusions and kernels of this build: the
+// model has to be planned again when they change.
+//
+// Usage: generate_offline_plan MODEL --output FILE [--symbol NAME]
+//                              [--header PATH] [--max-nodes N]
+// MODEL is a .tflite file or its `xxd -i` array (model.cc). FILE is a
+// .tflite file, or for .cc an array named NAME that includes PATH.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "flatbuffers/flatbuffers.h"  // from @flatbuffers
+#include "tensorflow/lite/micro/all_ops_resolver.h"
+#include "tensorflow/lite/micro/compatibility.h"
+#include "tensorflow/lite/micro/memory_helpers.h"
+#include "tensorflow/lite/micro/memory_planner/greedy_memory_planner.h"
+#include "tensorflow/lite/micro/micro_allocator.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/simple_memory_allocator.h"
+#include "tensorflow/lite/micro/tools/host/model_file.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace {
+
+constexpr size_t kTensorArenaSize = 1024 * 1024;
+constexpr int kBufferAlignment = 16;
+constexpr char kOfflineMemAllocMetadata[] = "OfflineMemoryAllocation";
+constexpr int kRandomOrders = 1000;
+constexpr int kInvocations = 20;
+alignas(16) uint8_t tensor_arena[kTensorArenaSize];
+alignas(16) uint8_t check_arena[kTensorArenaSize];
+
+// MicroAllocator that keeps the AllocationInfo of its memory plan, which
+// gives the buffers to plan offline. Has no members of its own, so that it
+// takes the bytes of a MicroAllocator in the arena.
+class PlanAllocator : public tflite::MicroAllocator {
+ public:
+  static PlanAllocator* Create(uint8_t* tensor_arena, size_t arena_size,
+                               tflite::ErrorReporter* error_reporter) {
+    tflite::SimpleMemoryAllocator* memory_allocator =
+        tflite::SimpleMemoryAllocator::Create(error_reporter, tensor_arena,
+                                              arena_size);
+    uint8_t* allocator_buffer = memory_allocator->AllocateFromTail(
+        sizeof(PlanAllocator), alignof(PlanAllocator));
+    return new (allocator_buffer)
+        PlanAllocator(memory_allocator, error_reporter);
+  }
+
+  // What the last memory plan of a PlanAllocator gave the planner.
+  static const std::vector<tflite::internal::AllocationInfo>&
+  allocation_info() {
+    return recorded();
+  }
+
+ protected:
+  void RecordAllocationInfo(
+      const tflite::internal::AllocationInfo* allocation_info,
+      size_t size) override {
+    recorded().assign(allocation_info, allocation_info + size);
+  }
+
+ private:
+  PlanAllocator(tflite::SimpleMemoryAllocator* memory_allocator,
+                tflite::ErrorReporter* error_reporter)
+      : tflite::MicroAllocator(memory_allocator, error_reporter) {}
+
+  static std::vector<tflite::internal::AllocationInfo>& recorded() {
+    static std::vector<tflite::internal::AllocationInfo> allocation_info;
+    return allocation_info;
+  }
+
+  TF_LITE_REMOVE_VIRTUAL_DELETE
+};
+
+// A buffer of the head section of the arena, alive from node `first` to node
+// `last`. `tensor` is -1 for a scratch buffer.
+struct Buffer {
+  int size;
+  int first;
+  int last;
+  int tensor;
+};
+
+// The buffers MicroAllocator plans for the model, in its order: the tensors,
+// then the scratch buffers, from its AllocationInfo. The output of a
+// shape-only op shares the buffer of its input, `alias_of` gives the tensor
+// for those and -1 for the others.
+void CollectBuffers(
+    int tensor_count,
+    const std::vector<tflite::internal::AllocationInfo>& allocation_info,
+    std::vector<Buffer>* buffers, std::vector<int>* alias_of) {
+  buffers->clear();
+  alias_of->assign(tensor_count, -1);
+  for (size_t i = 0; i < allocation_info.size(); ++i) {
+    const tflite::internal::AllocationInfo& info = allocation_info[i];
+    const int tensor = static_cast<int>(i) < tensor_count ? i : -1;
+    if (tensor >= 0) (*alias_of)[tensor] = info.alias_of;
+    if (!info.needs_allocating) continue;
+    buffers->push_back(
+        {static_cast<int>(tflite::AlignSizeUp(info.bytes, kBufferAlignment)),
+         info.first_created, info.last_used, tensor});
+  }
+}
+
+// Places buffers first-fit, each at the lowest offset where it does not
+// overlap a placed buffer alive at the same time, in the best order found.
+class OfflinePlanner {
+ public:
+  explicit OfflinePlanner(const std::vector<Buffer>& buffers)
+      : buffers_(buffers), conflicts_(buffers.size()) {
+    for (size_t a = 0; a < buffers_.size(); ++a) {
+      for (size_t b = 0; b < buffers_.size(); ++b) {
+        if (a != b && buffers_[a].first <= buffers_[b].last &&
+            buffers_[b].first <= buffers_[a].last) {
+          conflicts_[a].push_back(b);
+        }
+      }
+    }
+    int last_node = 0;
+    for (const Buffer& buffer : buffers_) {
+      last_node = std::max(last_node, buffer.last);
+    }
+    for (int node = 0; node <= last_node; ++node) {
+      int live = 0;
+      for (const Buffer& buffer : buffers_) {
+        if (buffer.first <= node && node <= buffer.last) live += buffer.size;
+      }
+      lower_bound_ = std::max(lower_bound_, live);
+    }
+  }
+
+  // The largest sum of the buffers alive at one node, no plan is smaller.
+  int lower_bound() const { return lower_bound_; }
+  int best_size() const { return best_size_; }
+  const std::vector<int>& best_offsets() const { return best_offsets_; }
+  long nodes() const { return nodes_; }
+
+  // Plans in the heuristic orders and in `random_orders` random ones.
+  void RunHeuristics(int random_orders) {
+    const int count = buffers_.size();
+    std::vector<int> order(count);
+    auto try_order = [this, &order](bool (*less)(const Buffer&,
+                                                 const Buffer&)) {
+      for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+      std::stable_sort(order.begin(), order.end(), [this, less](int a, int b) {
+        return less(buffers_[a], buffers_[b]);
+      });
+      TryOrder(order);
+    };
+    try_order([](const Buffer& a, const Buffer& b) { return a.size > b.size; });
+    try_order([](const Buffer& a, const Buffer& b) {
+      return static_cast<long>(a.size) * (a.last - a.first + 1) >
+             static_cast<long>(b.size) * (b.last - b.first + 1);
+    });
+    try_order([](const Buffer& a, const Buffer& b) {
+      return a.last - a.first != b.last - b.first
+                 ? a.last - a.first > b.last - b.first
+                 : a.size > b.size;
+    });
+    try_order([](const Buffer& a, const Buffer& b) {
+      return a.first != b.first ? a.first < b.first : a.size > b.size;
+    });
+    std::mt19937 random(1);
+    for (int i = 0; i < random_orders && best_size_ > lower_bound_; ++i) {
+      std::shuffle(order.begin(), order.end(), random);
+      TryOrder(order);
+    }
+  }
+
+  // Branch and bound over the orders, from the largest buffer down. Returns
+  // true if the search ended within `max_nodes`: the plan is then the best
+  // first-fit plan, and optimal if it reaches lower_bound().
+  bool Search(long max_nodes) {
+    max_nodes_ = max_nodes;
+    search_order_.resize(buffers_.size());
+    for (size_t i = 0; i < search_order_.size(); ++i) search_order_[i] = i;
+    std::stable_sort(search_order_.begin(), search_order_.end(),
+                     [this](int a, int b) {
+                       return buffers_[a].size > buffers_[b].size;
+                     });
+    std::vector<int> offsets(buffers_.size(), -1);
+    Branch(&offsets, 0, -1, 0);
+    return nodes_ <= max_nodes_;
+  }
+
+ private:
+  int FirstFit(int buffer, const std::vector<int>& offsets) const {
+    std::vector<std::pair<int, int>> used;
+    for (int other : conflicts_[buffer]) {
+      if (offsets[other] >= 0) {
+        used.push_back({offsets[other], offsets[other] + buffers_[other].size});
+      }
+    }
+    std::sort(used.begin(), used.end());
+    int offset = 0;
+    for (const auto& range : used) {
+      if (range.first >= offset + buffers_[buffer].size) break;
+      offset = std::max(offset, range.second);
+    }
+    return offset;
+  }
+
+  void TryOrder(const std::vector<int>& order) {
+    std::vector<int> offsets(buffers_.size(), -1);
+    int size = 0;
+    for (int buffer : order) {
+      offsets[buffer] = FirstFit(buffer, offsets);
+      size = std::max(size, offsets[buffer] + buffers_[buffer].size);
+    }
+    if (best_offsets_.empty() || size < best_size_) {
+      best_size_ = size;
+      best_offsets_ = offsets;
+    }
+  }
+
+  // Two buffers that are not alive at the same time get the same offsets in
+  // either order, so only the order with the lower index is searched.
+  void Branch(std::vector<int>* offsets, int placed, int previous, int size) {
+    if (placed == static_cast<int>(buffers_.size())) {
+      if (size < best_size_) {
+        best_size_ = size;
+        best_offsets_ = *offsets;
+      }
+      return;
+    }
+    for (int buffer : search_order_) {
+      if ((*offsets)[buffer] >= 0) continue;
+      if (best_size_ <= lower_bound_ || ++nodes_ > max_nodes_) return;
+      if (previous > buffer &&
+          std::find(conflicts_[buffer].begin(), conflicts_[buffer].end(),
+                    previous) == conflicts_[buffer].end()) {
+        continue;
+      }
+      const int offset = FirstFit(buffer, *offsets);
+      const int new_size = std::max(size, offset + buffers_[buffer].size);
+      if (new_size >= best_size_) continue;
+      (*offsets)[buffer] = offset;
+      Branch(offsets, placed + 1, buffer, new_size);
+      (*offsets)[buffer] = -1;
+    }
+  }
+
+  const std::vector<Buffer>& buffers_;
+  std::vector<std::vector<int>> conflicts_;
+  std::vector<int> search_order_;
+  int lower_bound_ = 0;
+  int best_size_ = 0;
+  std::vector<int> best_offsets_;
+  long nodes_ = 0;
+  long max_nodes_ = 0;
+};
+
+// The head size GreedyMemoryPlanner gives in MicroAllocator, with the offsets
+// of the tensors planned offline if `offsets` is set. The offsets of all the
+// buffers are returned in `planned`.
+int RuntimeSize(const std::vector<Buffer>& buffers,
+                const std::vector<int>* offsets, std::vector<int>* planned) {
+  tflite::MicroErrorReporter error_reporter;
+  std::vector<unsigned char> scratch(
+      tflite::GreedyMemoryPlanner::per_buffer_size() * buffers.size());
+  tflite::GreedyMemoryPlanner planner(scratch.data(), scratch.size());
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    const Buffer& buffer = buffers[i];
+    if (offsets != nullptr && buffer.tensor >= 0) {
+      planner.AddBuffer(&error_reporter, buffer.size, buffer.first,
+                        buffer.last, (*offsets)[i]);
+    } else {
+      planner.AddBuffer(&error_reporter, buffer.size, buffer.first,
+                        buffer.last);
+    }
+  }
+  planned->resize(buffers.size());
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    planner.GetOffsetForBuffer(&error_reporter, i, &(*planned)[i]);
+  }
+  return planner.GetMaximumMemorySize();
+}
+
+// The model with an OfflineMemoryAllocation metadata of `tensor_offsets`, -1
+// for the tensors planned at runtime. An existing one is replaced.
+void WriteOfflineOffsets(const tflite::Model* model,
+                         const std::vector<int32_t>& tensor_offsets,
+                         flatbuffers::FlatBufferBuilder* builder) {
+  std::unique_ptr<tflite::ModelT> model_t(model->UnPack());
+  std::vector<int32_t> words = {0, 0,
+                                static_cast<int32_t>(tensor_offsets.size())};
+  words.insert(words.end(), tensor_offsets.begin(), tensor_offsets.end());
+
+  std::unique_ptr<tflite::BufferT> buffer(new tflite::BufferT);
+  buffer->data.resize(words.size() * sizeof(int32_t));
+  memcpy(buffer->data.data(), words.data(), buffer->data.size());
+
+  tflite::MetadataT* metadata = nullptr;
+  for (auto& entry : model_t->metadata) {
+    if (entry->name == kOfflineMemAllocMetadata) metadata = entry.get();
+  }
+  if (metadata == nullptr) {
+    model_t->metadata.emplace_back(new tflite::MetadataT);
+    metadata = model_t->metadata.back().get();
+    metadata->name = kOfflineMemAllocMetadata;
+    metadata->buffer = model_t->buffers.size();
+    model_t->buffers.push_back(std::move(buffer));
+  } else {
+    model_t->buffers[metadata->buffer] = std::move(buffer);
+  }
+  tflite::FinishModelBuffer(*builder,
+                            tflite::Model::Pack(*builder, model_t.get()));
+}
+
+// Invokes both models on the same random inputs, true if all the outputs are
+// the same bytes.
+bool SameOutputs(tflite::MicroInterpreter* original,
+                 tflite::MicroInterpreter* planned) {
+  srand(1);
+  for (int invocation = 0; invocation < kInvocations; ++invocation) {
+    for (size_t i = 0; i < original->inputs_size(); ++i) {
+      TfLiteTensor* input = original->input(i);
+      for (size_t b = 0; b < input->bytes; ++b) {
+        input->data.uint8[b] = static_cast<uint8_t>(rand());
+      }
+      if (input->type == kTfLiteFloat32) {
+        for (size_t f = 0; f < input->bytes / sizeof(float); ++f) {
+          input->data.f[f] = 2.0f * rand() / RAND_MAX - 1.0f;
+        }
+      }
+      memcpy(planned->input(i)->data.raw, input->data.raw, input->bytes);
+    }
+    if (original->Invoke() != kTfLiteOk || planned->Invoke() != kTfLiteOk) {
+      return false;
+    }
+    for (size_t i = 0; i < original->outputs_size(); ++i) {
+      const TfLiteTensor* expected = original->output(i);
+      const TfLiteTensor* output = planned->output(i);
+      if (output->bytes != expected->bytes ||
+          memcmp(output->data.raw, expected->data.raw, output->bytes) != 0) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const char* model_path = nullptr;
+  const char* output_path = nullptr;
+  const char* symbol = nullptr;
+  const char* header = nullptr;
+  long max_nodes = 10000000;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+      output_path = argv[++i];
+    } else if (strcmp(argv[i], "--symbol") == 0 && i + 1 < argc) {
+      symbol = argv[++i];
+    } else if (strcmp(argv[i], "--header") == 0 && i + 1 < argc) {
+      header = argv[++i];
+    } else if (strcmp(argv[i], "--max-nodes") == 0 && i + 1 < argc) {
+      max_nodes = atol(argv[++i]);
+    } else if (argv[i][0] != '-' && model_path == nullptr) {
+      model_path = argv[i];
+    } else {
+      model_path = nullptr;
+      break;
+    }
+  }
+  if (model_path == nullptr || output_path == nullptr) {
+    fprintf(stderr,
+            "Usage: %s MODEL --output FILE [--symbol NAME] [--header PATH] "
+            "[--max-nodes N]\n",
+            argv[0]);
+    return 2;
+  }
+
+  std::vector<uint8_t> data;
+  const tflite::Model* model = tflite::host::LoadModel(model_path, &data);
+  if (model == nullptr) return 1;
+  if (model->subgraphs()->size() != 1) {
+    fprintf(stderr, "%s: only models with one subgraph are supported\n",
+            model_path);
+    return 1;
+  }
+  const tflite::SubGraph* subgraph = model->subgraphs()->Get(0);
+
+  // Planned online, as the firmware does without the metadata.
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::AllOpsResolver resolver;
+  tflite::MicroInterpreter interpreter(
+      model, resolver,
+      PlanAllocator::Create(tensor_arena, kTensorArenaSize,
+                            &micro_error_reporter),
+      &micro_error_reporter);
+  if (interpreter.AllocateTensors() != kTfLiteOk) {
+    fprintf(stderr, "%s: AllocateTensors() failed\n", model_path);
+    return 1;
+  }
+  std::vector<Buffer> buffers;
+  std::vector<int> alias_of;
+  CollectBuffers(subgraph->tensors()->size(), PlanAllocator::allocation_info(),
+                 &buffers, &alias_of);
+  std::vector<int> planned;
+  const int online_size = RuntimeSize(buffers, nullptr, &planned);
+  std::vector<int> online_offsets = planned;
+
+  const auto start = std::chrono::steady_clock::now();
+  OfflinePlanner planner(buffers);
+  planner.RunHeuristics(kRandomOrders);
+  const int heuristic_size = planner.best_size();
+  const bool finished = planner.Search(max_nodes);
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+
+  // The scratch buffers are placed at runtime, keep the online plan if they
+  // do not fit where the offline plan has room for them.
+  std::vector<int> offsets = planner.best_offsets();
+  int offline_size = RuntimeSize(buffers, &offsets, &planned);
+  if (offline_size > online_size) {
+    offsets = online_offsets;
+    offline_size = RuntimeSize(buffers, &offsets, &planned);
+  }
+
+  std::vector<int32_t> tensor_offsets(subgraph->tensors()->size(),
+                                      tflite::kOnlinePlannedBuffer);
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    if (buffers[i].tensor >= 0) tensor_offsets[buffers[i].tensor] = offsets[i];
+  }
+  for (size_t i = 0; i < alias_of.size(); ++i) {
+    if (alias_of[i] != -1) tensor_offsets[i] = tensor_offsets[alias_of[i]];
+  }
+
+  flatbuffers::FlatBufferBuilder builder;
+  WriteOfflineOffsets(model, tensor_offsets, &builder);
+  const tflite::Model* planned_model =
+      tflite::GetModel(builder.GetBufferPointer());
+  tflite::MicroInterpreter check(planned_model, resolver, check_arena,
+                                 kTensorArenaSize, &micro_error_reporter);
+  if (check.AllocateTensors() != kTfLiteOk) {
+    fprintf(stderr, "%s: AllocateTensors() of the planned model failed\n",
+            model_path);
+    return 1;
+  }
+  const bool same_outputs = SameOutputs(&interpreter, &check);
+
+  int scratch_buffers = 0;
+  for (const Buffer& buffer : buffers) scratch_buffers += buffer.tensor < 0;
+  printf("%s: %zu tensors and %d scratch buffers in the head\n", model_path,
+         buffers.size() - scratch_buffers, scratch_buffers);
+  printf("  %-34s %8d bytes\n", "peak of live bytes (lower bound)",
+         planner.lower_bound());
+  printf("  %-34s %8d bytes\n", "online GreedyMemoryPlanner", online_size);
+  printf("  %-34s %8d bytes\n", "best heuristic order", heuristic_size);
+  printf("  %-34s %8d bytes%s\n", "offline plan", offline_size,
+         offline_size == planner.lower_bound()
+             ? ", optimal"
+             : (finished ? ", best first-fit order" : ""));
+  printf("  %-34s %8ld nodes, %s, %.2f s\n", "search", planner.nodes(),
+         finished ? "finished" : "stopped at --max-nodes", seconds);
+  printf("  %-34s %8zu -> %zu bytes\n", "arena used",
+         interpreter.arena_used_bytes(), check.arena_used_bytes());
+  if (!same_outputs) {
+    fprintf(stderr, "%s: the planned model gives other outputs, not written\n",
+            model_path);
+    return 1;
+  }
+  printf("  outputs are the same in %d invocations\n", kInvocations);
+
+  return tflite::host::SaveModel(output_path, builder.GetBufferPointer(),
+                                 builder.GetSize(), symbol, header)
+             ? 0
+             : 1;
+}
@@ -0,0 +1,277 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Writes a header with an op resolver for one model: a
+// MicroMutableOpResolver<N> subclass that registers exactly the ops of the
+// model, so the firmware links only their kernels instead of the whole
+// AllOpsResolver list. The fused CONV_2D + MAX_POOL_2D kernel is added when
+// the model has a CONV_2D feeding a MAX_POOL_2D, see FuseOperators().
+//
+// Usage: generate_op_resolver MODEL [--class NAME] [--guard GUARD]
+//                             [--output FILE]
+// MODEL is a .tflite file or its `xxd -i` array (model.cc). The header goes
+// to stdout without --output.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "tensorflow/lite/micro/micro_graph_fusion.h"
+#include "tensorflow/lite/micro/tools/host/model_file.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace {
+
+struct OpMethod {
+  tflite::BuiltinOperator op;
+  const char* method;
+};
+
+// The Add* methods of MicroMutableOpResolver, keep in the same order.
+const OpMethod kBuiltinMethods[] = {
+    {tflite::BuiltinOperator_ABS, "AddAbs"},
+    {tflite::BuiltinOperator_ADD, "AddAdd"},
+    {tflite::BuiltinOperator_ARG_MAX, "AddArgMax"},
+    {tflite::BuiltinOperator_ARG_MIN, "AddArgMin"},
+    {tflite::BuiltinOperator_AVERAGE_POOL_2D, "AddAveragePool2D"},
+    {tflite::BuiltinOperator_CEIL, "AddCeil"},
+    {tflite::BuiltinOperator_CONCATENATION, "AddConcatenation"},
+    {tflite::BuiltinOperator_CONV_2D, "AddConv2D"},
+    {tflite::BuiltinOperator_COS, "AddCos"},
+    {tflite::BuiltinOperator_DEPTHWISE_CONV_2D, "AddDepthwiseConv2D"},
+    {tflite::BuiltinOperator_DEQUANTIZE, "AddDequantize"},
+    {tflite::BuiltinOperator_EQUAL, "AddEqual"},
+    {tflite::BuiltinOperator_FLOOR, "AddFloor"},
+    {tflite::BuiltinOperator_FULLY_CONNECTED, "AddFullyConnected"},
+    {tflite::BuiltinOperator_GREATER, "AddGreater"},
+    {tflite::BuiltinOperator_GREATER_EQUAL, "AddGreaterEqual"},
+    {tflite::BuiltinOperator_HARD_SWISH, "AddHardSwish"},
+    {tflite::BuiltinOperator_L2_NORMALIZATION, "AddL2Normalization"},
+    {tflite::BuiltinOperator_LESS, "AddLess"},
+    {tflite::BuiltinOperator_LESS_EQUAL, "AddLessEqual"},
+    {tflite::BuiltinOperator_LOG, "AddLog"},
+    {tflite::BuiltinOperator_LOGICAL_AND, "AddLogicalAnd"},
+    {tflite::BuiltinOperator_LOGICAL_NOT, "AddLogicalNot"},
+    {tflite::BuiltinOperator_LOGICAL_OR, "AddLogicalOr"},
+    {tflite::BuiltinOperator_LOGISTIC, "AddLogistic"},
+    {tflite::BuiltinOperator_MAXIMUM, "AddMaximum"},
+    {tflite::BuiltinOperator_MAX_POOL_2D, "AddMaxPool2D"},
+    {tflite::BuiltinOperator_MEAN, "AddMean"},
+    {tflite::BuiltinOperator_MINIMUM, "AddMinimum"},
+    {tflite::BuiltinOperator_MUL, "AddMul"},
+    {tflite::BuiltinOperator_NEG, "AddNeg"},
+    {tflite::BuiltinOperator_NOT_EQUAL, "AddNotEqual"},
+    {tflite::BuiltinOperator_PACK, "AddPack"},
+    {tflite::BuiltinOperator_PAD, "AddPad"},
+    {tflite::BuiltinOperator_PADV2, "AddPadV2"},
+    {tflite::BuiltinOperator_PRELU, "AddPrelu"},
+    {tflite::BuiltinOperator_QUANTIZE, "AddQuantize"},
+    {tflite::BuiltinOperator_RELU, "AddRelu"},
+    {tflite::BuiltinOperator_RELU6, "AddRelu6"},
+    {tflite::BuiltinOperator_RESHAPE, "AddReshape"},
+    {tflite::BuiltinOperator_RESIZE_NEAREST_NEIGHBOR,
+     "AddResizeNearestNeighbor"},
+    {tflite::BuiltinOperator_ROUND, "AddRound"},
+    {tflite::BuiltinOperator_RSQRT, "AddRsqrt"},
+    {tflite::BuiltinOperator_SIN, "AddSin"},
+    {tflite::BuiltinOperator_SOFTMAX, "AddSoftmax"},
+    {tflite::BuiltinOperator_SPLIT, "AddSplit"},
+    {tflite::BuiltinOperator_SQRT, "AddSqrt"},
+    {tflite::BuiltinOperator_SQUARE, "AddSquare"},
+    {tflite::BuiltinOperator_STRIDED_SLICE, "AddStridedSlice"},
+    {tflite::BuiltinOperator_SUB, "AddSub"},
+    {tflite::BuiltinOperator_SVDF, "AddSvdf"},
+    {tflite::BuiltinOperator_TANH, "AddTanh"},
+    {tflite::BuiltinOperator_UNPACK, "AddUnpack"},
+};
+
+// Custom ops with an Add* method.
+const char* CustomMethod(const char* name) {
+  if (strcmp(name, "CIRCULAR_BUFFER") == 0) return "AddCircularBuffer";
+  if (strcmp(name, tflite::kConv2DMaxPool2DOpName) == 0) {
+    return "AddConv2DMaxPool2D";
+  }
+  return nullptr;
+}
+
+const char* BuiltinMethod(tflite::BuiltinOperator op) {
+  for (const OpMethod& entry : kBuiltinMethods) {
+    if (entry.op == op) return entry.method;
+  }
+  return nullptr;
+}
+
+tflite::BuiltinOperator OpOf(const tflite::Model* model,
+                             const tflite::Operator* op) {
+  return model->operator_codes()->Get(op->opcode_index())->builtin_code();
+}
+
+// Whether some CONV_2D output is read by a MAX_POOL_2D, i.e. FuseOperators()
+// may use the fused kernel.
+bool HasConvMaxPool(const tflite::Model* model) {
+  for (const tflite::SubGraph* subgraph : *model->subgraphs()) {
+    if (subgraph->operators() == nullptr) continue;
+    for (const tflite::Operator* conv : *subgraph->operators()) {
+      if (OpOf(model, conv) != tflite::BuiltinOperator_CONV_2D) continue;
+      const int conv_output = conv->outputs()->Get(0);
+      for (const tflite::Operator* pool : *subgraph->operators()) {
+        if (OpOf(model, pool) == tflite::BuiltinOperator_MAX_POOL_2D &&
+            pool->inputs()->Get(0) == conv_output) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+// Appends `method` to `methods` once. Returns false if it was there already.
+bool AddMethod(std::vector<std::string>* methods, const char* method) {
+  for (const std::string& known : *methods) {
+    if (known == method) return false;
+  }
+  methods->push_back(method);
+  return true;
+}
+
+// The Add* calls for the ops of the model, in the order of the
+// kBuiltinMethods table, then the custom ops.
+bool CollectMethods(const tflite::Model* model,
+                    std::vector<std::string>* methods) {
+  std::vector<std::string> custom;
+  bool ok = true;
+  for (const tflite::OperatorCode* opcode : *model->operator_codes()) {
+    const tflite::BuiltinOperator op = opcode->builtin_code();
+    if (op == tflite::BuiltinOperator_CUSTOM) {
+      const char* name =
+          opcode->custom_code() != nullptr ? opcode->custom_code()->c_str()
+                                           : "";
+      const char* method = CustomMethod(name);
+      if (method == nullptr) {
+        fprintf(stderr, "Custom op '%s' has no Add* method, register it by "
+                        "hand with AddCustom().\n", name);
+        ok = false;
+        continue;
+      }
+      AddMethod(&custom, method);
+    } else if (BuiltinMethod(op) == nullptr) {
+      fprintf(stderr, "Op %s has no micro kernel.\n",
+              tflite::EnumNameBuiltinOperator(op));
+      ok = false;
+    }
+  }
+  for (const OpMethod& entry : kBuiltinMethods) {
+    for (const tflite::OperatorCode* opcode : *model->operator_codes()) {
+      if (opcode->builtin_code() == entry.op) {
+        AddMethod(methods, entry.method);
+        break;
+      }
+    }
+  }
+  if (HasConvMaxPool(model)) AddMethod(&custom, "AddConv2DMaxPool2D");
+  for (const std::string& method : custom) {
+    AddMethod(methods, method.c_str());
+  }
+  return ok;
+}
+
+void WriteHeader(FILE* out, const std::string& model_name,
+                 const std::string& class_name, const std::string& guard,
+                 const std::vector<std::string>& methods) {
+  const size_t count = methods.size();
+  fprintf(out,
+          "// Generated by tensorflow/lite/micro/tools/host/"
+          "generate_op_resolver from\n"
+          "// %s, do not edit.\n"
+          "\n"
+          "#ifndef %s\n"
+          "#define %s\n"
+          "\n"
+          "#include \"tensorflow/lite/core/api/error_reporter.h\"\n"
+          "#include \"tensorflow/lite/micro/compatibility.h\"\n"
+          "#include \"tensorflow/lite/micro/micro_mutable_op_resolver.h\"\n"
+          "\n"
+          "namespace tflite {\n"
+          "\n"
+          "// The %zu ops of %s.\n"
+          "class %s : public MicroMutableOpResolver<%zu> {\n"
+          " public:\n"
+          "  explicit %s(ErrorReporter* error_reporter = nullptr)\n"
+          "      : MicroMutableOpResolver<%zu>(error_reporter) {\n",
+          model_name.c_str(), guard.c_str(), guard.c_str(), count,
+          model_name.c_str(), class_name.c_str(), count, class_name.c_str(),
+          count);
+  for (const std::string& method : methods) {
+    fprintf(out, "    %s();\n", method.c_str());
+  }
+  fprintf(out,
+          "  }\n"
+          "\n"
+          " private:\n"
+          "  TF_LITE_REMOVE_VIRTUAL_DELETE\n"
+          "};\n"
+          "\n"
+          "}  // namespace tflite\n"
+          "\n"
+          "#endif  // %s\n",
+          guard.c_str());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const char* model_path = nullptr;
+  const char* output_path = nullptr;
+  std::string class_name = "ModelOpResolver";
+  std::string guard = "MODEL_OP_RESOLVER_H_";
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--class") == 0 && i + 1 < argc) {
+      class_name = argv[++i];
+    } else if (strcmp(argv[i], "--guard") == 0 && i + 1 < argc) {
+      guard = argv[++i];
+    } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+      output_path = argv[++i];
+    } else if (argv[i][0] != '-' && model_path == nullptr) {
+      model_path = argv[i];
+    } else {
+      model_path = nullptr;
+      break;
+    }
+  }
+  if (model_path == nullptr) {
+    fprintf(stderr,
+            "Usage: %s MODEL [--class NAME] [--guard GUARD] [--output FILE]\n",
+            argv[0]);
+    return 2;
+  }
+
+  std::vector<uint8_t> data;
+  const tflite::Model* model = tflite::host::LoadModel(model_path, &data);
+  if (model == nullptr) return 1;
+
+  std::vector<std::string> methods;
+  if (!CollectMethods(model, &methods)) return 1;
+
+  FILE* out = output_path != nullptr ? fopen(output_path, "w") : stdout;
+  if (out == nullptr) {
+    fprintf(stderr, "%s: can not create\n", output_path);
+    return 1;
+  }
+  WriteHeader(out, tflite::host::BaseName(model_path), class_name, guard,
+              methods);
+  if (out != stdout) fclose(out);
+  return 0;
+}
@@ -0,0 +1,754 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Writes the static plan of a model (see micro_static_plan.h) as C++ source:
+// MicroInterpreter allocates the model here with AllOpsResolver, then its
+// tensors, nodes, kernels and scratch buffers are written out, with an Invoke
+// function that calls the Eval functions of the kernels in order.
+//
+// The kernel functions are named through the dynamic symbol table (the tool
+// is linked with -rdynamic), so they must have external linkage. Builtin data
+// is written as the bytes of its struct with a static_assert on its size, the
+// structs hold no pointers and have the same layout on the host and on a
+// 32-bit little-endian target.
+//
+// Usage: generate_static_plan MODEL --model-header HEADER --model-symbol NAME
+//                             --header FILE --source FILE
+//                             [--namespace NAME] [--include PATH]
+// MODEL is a .tflite file or its `xxd -i` array (model.cc), HEADER and NAME
+// give the model array the plan reads the weights from. PATH is how the
+// source includes the generated header (its file name by default).
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/micro/all_ops_resolver.h"
+#include "tensorflow/lite/micro/memory_helpers.h"
+#include "tensorflow/lite/micro/micro_allocator.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+#include "tensorflow/lite/micro/micro_graph_fusion.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/tools/host/model_file.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace {
+
+constexpr size_t kTensorArenaSize = 4 * 1024 * 1024;
+constexpr size_t kBufferAlignment = 16;
+alignas(16) uint8_t tensor_arena[kTensorArenaSize];
+
+// Gives the tool the context of the interpreter, for the eval tensors.
+class PlanInterpreter : public tflite::MicroInterpreter {
+ public:
+  using tflite::MicroInterpreter::MicroInterpreter;
+  const TfLiteContext& plan_context() const { return context(); }
+  const tflite::MicroAllocator& plan_allocator() const { return allocator(); }
+};
+
+struct BuiltinDataType {
+  int builtin_code;
+  const char* custom_name;
+  const char* type;
+  size_t size;
+};
+
+#define BUILTIN_DATA(op, type) \
+  { tflite::BuiltinOperator_##op, nullptr, #type, sizeof(type) }
+
+// The structs of the builtin data of the micro kernels.
+const BuiltinDataType kBuiltinDataTypes[] = {
+    BUILTIN_DATA(ADD, TfLiteAddParams),
+    BUILTIN_DATA(ARG_MAX, TfLiteArgMaxParams),
+    BUILTIN_DATA(ARG_MIN, TfLiteArgMinParams),
+    BUILTIN_DATA(AVERAGE_POOL_2D, TfLitePoolParams),
+    BUILTIN_DATA(CONCATENATION, TfLiteConcatenationParams),
+    BUILTIN_DATA(CONV_2D, TfLiteConvParams),
+    BUILTIN_DATA(DEPTHWISE_CONV_2D, TfLiteDepthwiseConvParams),
+    BUILTIN_DATA(FULLY_CONNECTED, TfLiteFullyConnectedParams),
+    BUILTIN_DATA(L2_NORMALIZATION, TfLiteL2NormParams),
+    BUILTIN_DATA(MAX_POOL_2D, TfLitePoolParams),
+    BUILTIN_DATA(MEAN, TfLiteReducerParams),
+    BUILTIN_DATA(MUL, TfLiteMulParams),
+    BUILTIN_DATA(PACK, TfLitePackParams),
+    BUILTIN_DATA(RESHAPE, TfLiteReshapeParams),
+    BUILTIN_DATA(RESIZE_NEAREST_NEIGHBOR, TfLiteResizeNearestNeighborParams),
+    BUILTIN_DATA(SOFTMAX, TfLiteSoftmaxParams),
+    BUILTIN_DATA(SPLIT, TfLiteSplitParams),
+    BUILTIN_DATA(STRIDED_SLICE, TfLiteStridedSliceParams),
+    BUILTIN_DATA(SUB, TfLiteSubParams),
+    BUILTIN_DATA(SVDF, TfLiteSVDFParams),
+    BUILTIN_DATA(UNPACK, TfLiteUnpackParams),
+    {tflite::BuiltinOperator_CUSTOM, tflite::kConv2DMaxPool2DOpName,
+     "tflite::TfLiteConvPoolParams", sizeof(tflite::TfLiteConvPoolParams)},
+};
+
+#undef BUILTIN_DATA
+
+const char* OpName(const TfLiteRegistration* registration) {
+  if (registration->builtin_code == tflite::BuiltinOperator_CUSTOM) {
+    return registration->custom_name;
+  }
+  return tflite::EnumNameBuiltinOperator(
+      static_cast<tflite::BuiltinOperator>(registration->builtin_code));
+}
+
+const BuiltinDataType* FindBuiltinDataType(
+    const TfLiteRegistration* registration) {
+  for (const BuiltinDataType& entry : kBuiltinDataTypes) {
+    if (entry.builtin_code != registration->builtin_code) continue;
+    if (entry.custom_name == nullptr ||
+        (registration->custom_name != nullptr &&
+         strcmp(entry.custom_name, registration->custom_name) == 0)) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+// A kernel function and the declaration the generated source needs for it.
+struct Function {
+  std::string name_space;
+  std::string name;
+  std::string declaration;
+};
+
+// Names the function at `address` through the dynamic symbol table, e.g.
+// "tflite::ops::micro::conv::Eval". Fails for functions with internal
+// linkage, which the generated source can not call.
+bool NameFunction(const void* address, const char* signature,
+                  Function* function) {
+  Dl_info info;
+  if (dladdr(address, &info) == 0 || info.dli_saddr != address ||
+      info.dli_sname == nullptr) {
+    return false;
+  }
+  int status = 0;
+  char* demangled =
+      abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+  if (status != 0 || demangled == nullptr) return false;
+  std::string full_name = demangled;
+  free(demangled);
+
+  const size_t parameters = full_name.find('(');
+  if (parameters == std::string::npos) return false;
+  full_name.resize(parameters);
+  if (full_name.find("(anonymous") != std::string::npos ||
+      full_name.find('<') != std::string::npos) {
+    return false;
+  }
+  const size_t separator = full_name.rfind("::");
+  if (separator == std::string::npos) return false;
+  function->name_space = full_name.substr(0, separator);
+  function->name = full_name;
+  function->declaration =
+      std::string(signature).replace(strstr(signature, "%s") - signature, 2,
+                                     full_name.substr(separator + 2));
+  return true;
+}
+
+const char* TypeName(TfLiteType type) {
+  switch (type) {
+    case kTfLiteFloat32:
+      return "kTfLiteFloat32";
+    case kTfLiteInt32:
+      return "kTfLiteInt32";
+    case kTfLiteUInt8:
+      return "kTfLiteUInt8";
+    case kTfLiteInt64:
+      return "kTfLiteInt64";
+    case kTfLiteBool:
+      return "kTfLiteBool";
+    case kTfLiteInt16:
+      return "kTfLiteInt16";
+    case kTfLiteInt8:
+      return "kTfLiteInt8";
+    case kTfLiteFloat16:
+      return "kTfLiteFloat16";
+    default:
+      return "kTfLiteNoType";
+  }
+}
+
+std::string IntArray(const TfLiteIntArray* array) {
+  std::string text = "{" + std::to_string(array->size);
+  for (int i = 0; i < array->size; ++i) {
+    text += ", " + std::to_string(array->data[i]);
+  }
+  return text + "}";
+}
+
+std::string FloatLiteral(float value) {
+  char text[32];
+  snprintf(text, sizeof(text), "%.9ef", value);
+  return text;
+}
+
+class PlanWriter {
+ public:
+  PlanWriter(const tflite::Model* model, const std::vector<uint8_t>& data,
+             const PlanInterpreter* interpreter)
+      : data_(data),
+        interpreter_(interpreter),
+        subgraph_(model->subgraphs()->Get(0)),
+        head_(tflite::AlignPointerUp(tensor_arena, kBufferAlignment)) {}
+
+  bool Collect();
+  void WriteHeader(FILE* out, const std::string& model_name,
+                   const std::string& name_space, const std::string& guard);
+  void WriteSource(FILE* out, const std::string& model_name,
+                   const std::string& name_space, const std::string& include,
+                   const std::string& model_header,
+                   const std::string& model_symbol);
+
+ private:
+  struct Tensor {
+    TfLiteType type;
+    const char* kind;
+    size_t offset;
+    size_t bytes;
+    std::string dims;
+    // Quantization, as MicroAllocator reads it.
+    int channels;
+    int quantized_dimension;
+  };
+  struct Node {
+    int index;
+    const TfLiteRegistration* registration;
+    std::string inputs;
+    std::string outputs;
+    const BuiltinDataType* builtin_data_type;
+    std::vector<uint32_t> builtin_data;
+    std::vector<uint8_t> custom_data;
+    std::string eval;
+  };
+
+  bool CollectTensors();
+  bool CollectNodes();
+  bool CollectScratchBuffers();
+  bool AddFunction(const void* address, const char* signature,
+                   std::string* name);
+  std::string RegistrationName(const TfLiteRegistration* registration);
+
+  const std::vector<uint8_t>& data_;
+  const PlanInterpreter* interpreter_;
+  const tflite::SubGraph* subgraph_;
+  uint8_t* head_;
+  size_t head_bytes_ = 0;
+
+  std::vector<Tensor> tensors_;
+  std::vector<Node> nodes_;
+  std::vector<std::pair<size_t, size_t>> scratch_buffers_;
+  std::vector<const TfLiteRegistration*> registrations_;
+  // Declarations of the kernel functions by namespace, in order.
+  std::vector<std::string> namespaces_;
+  std::map<std::string, std::vector<std::string>> declarations_;
+  std::map<const void*, std::string> function_names_;
+};
+
+bool PlanWriter::Collect() {
+  return CollectTensors() && CollectScratchBuffers() && CollectNodes();
+}
+
+bool PlanWriter::CollectTensors() {
+  const TfLiteContext& context = interpreter_->plan_context();
+  const uint8_t* model_begin = data_.data();
+  const uint8_t* model_end = model_begin + data_.size();
+  for (size_t i = 0; i < subgraph_->tensors()->size(); ++i) {
+    const TfLiteEvalTensor* eval_tensor = context.GetEvalTensor(&context, i);
+    const tflite::Tensor* flatbuffer_tensor = subgraph_->tensors()->Get(i);
+    const uint8_t* data = static_cast<const uint8_t*>(eval_tensor->data.data);
+    Tensor tensor;
+    tensor.type = eval_tensor->type;
+    tensor.offset = 0;
+    tensor.dims = IntArray(eval_tensor->dims);
+    tensor.channels = 0;
+    tensor.quantized_dimension = 0;
+    const tflite::QuantizationParameters* quantization =
+        flatbuffer_tensor->quantization();
+    if (quantization != nullptr && quantization->scale() != nullptr &&
+        quantization->scale()->size() > 0 &&
+        quantization->zero_point() != nullptr &&
+        quantization->zero_point()->size() > 0) {
+      tensor.channels = quantization->scale()->size();
+      tensor.quantized_dimension = quantization->quantized_dimension();
+    }
+    if (tflite::TfLiteEvalTensorByteLength(eval_tensor, &tensor.bytes) !=
+        kTfLiteOk) {
+      fprintf(stderr, "Tensor %zu has an unknown type.\n", i);
+      return false;
+    }
+    if (data == nullptr) {
+      tensor.kind = "tflite::kStaticPlanNoData";
+    } else if (flatbuffer_tensor->is_variable()) {
+      tensor.kind = "tflite::kStaticPlanVariable";
+    } else if (data >= model_begin && data < model_end) {
+      tensor.kind = "tflite::kStaticPlanModel";
+      tensor.offset = data - model_begin;
+    } else if (data >= head_ && data < tensor_arena + kTensorArenaSize) {
+      tensor.kind = "tflite::kStaticPlanArena";
+      tensor.offset = data - head_;
+      head_bytes_ = std::max(
+          head_bytes_, tensor.offset + tflite::AlignSizeUp(tensor.bytes,
+                                                           kBufferAlignment));
+    } else {
+      fprintf(stderr, "Tensor %zu is neither in the model nor in the arena.\n",
+              i);
+      return false;
+    }
+    tensors_.push_back(tensor);
+  }
+  return true;
+}
+
+bool PlanWriter::CollectScratchBuffers() {
+  const tflite::MicroAllocator& allocator = interpreter_->plan_allocator();
+  for (size_t i = 0; i < allocator.scratch_buffer_count(); ++i) {
+    const tflite::internal::ScratchBufferHandle& handle =
+        allocator.scratch_buffer_handle(i);
+    const size_t offset = handle.data - head_;
+    scratch_buffers_.push_back({offset, handle.bytes});
+    head_bytes_ =
+        std::max(head_bytes_, offset + tflite::AlignSizeUp(handle.bytes,
+                                                           kBufferAlignment));
+  }
+  return true;
+}
+
+bool PlanWriter::AddFunction(const void* address, const char* signature,
+                             std::string* name) {
+  auto known = function_names_.find(address);
+  if (known != function_names_.end()) {
+    *name = known->second;
+    return true;
+  }
+  Function function;
+  if (!NameFunction(address, signature, &function)) return false;
+  if (declarations_.count(function.name_space) == 0) {
+    namespaces_.push_back(function.name_space);
+  }
+  declarations_[function.name_space].push_back(function.declaration);
+  function_names_[address] = function.name;
+  *name = function.name;
+  return true;
+}
+
+bool PlanWriter::CollectNodes() {
+  for (size_t i = 0; i < interpreter_->operators_size(); ++i) {
+    const tflite::NodeAndRegistration node_and_registration =
+        interpreter_->node_and_registration(i);
+    const TfLiteNode& node = node_and_registration.node;
+    const TfLiteRegistration* registration =
+        node_and_registration.registration;
+    // Nodes taken into a fused node are left without callbacks.
+    if (registration->init == nullptr && registration->prepare == nullptr &&
+        registration->invoke == nullptr) {
+      continue;
+    }
+
+    Node plan_node;
+    plan_node.index = i;
+    plan_node.registration = registration;
+    plan_node.inputs = IntArray(node.inputs);
+    plan_node.outputs = IntArray(node.outputs);
+    plan_node.builtin_data_type = nullptr;
+    if (node.builtin_data != nullptr) {
+      plan_node.builtin_data_type = FindBuiltinDataType(registration);
+      if (plan_node.builtin_data_type == nullptr) {
+        fprintf(stderr, "Node %zu (%s): unknown builtin data.\n", i,
+                OpName(registration));
+        return false;
+      }
+      const size_t size = plan_node.builtin_data_type->size;
+      plan_node.builtin_data.resize((size + 3) / 4);
+      memcpy(plan_node.builtin_data.data(), node.builtin_data, size);
+    }
+    if (node.custom_initial_data != nullptr) {
+      const uint8_t* custom_data =
+          static_cast<const uint8_t*>(node.custom_initial_data);
+      plan_node.custom_data.assign(
+          custom_data, custom_data + node.custom_initial_data_size);
+    }
+
+    std::string unused;
+    const bool named =
+        (registration->init == nullptr ||
+         AddFunction(reinterpret_cast<const void*>(registration->init),
+                     "void* %s(TfLiteContext* context, const char* buffer, "
+                     "size_t length);",
+                     &unused)) &&
+        (registration->free == nullptr ||
+         AddFunction(reinterpret_cast<const void*>(registration->free),
+                     "void %s(TfLiteContext* context, void* buffer);",
+                     &unused)) &&
+        (registration->prepare == nullptr ||
+         AddFunction(reinterpret_cast<const void*>(registration->prepare),
+                     "TfLiteStatus %s(TfLiteContext* context, TfLiteNode* "
+                     "node);",
+                     &unused)) &&
+        (registration->invoke == nullptr ||
+         AddFunction(reinterpret_cast<const void*>(registration->invoke),
+                     "TfLiteStatus %s(TfLiteContext* context, TfLiteNode* "
+                     "node);",
+                     &plan_node.eval));
+    if (!named) {
+      fprintf(stderr,
+              "Node %zu (%s): a kernel function has internal linkage.\n", i,
+              OpName(registration));
+      return false;
+    }
+    RegistrationName(registration);
+    nodes_.push_back(plan_node);
+  }
+  return true;
+}
+
+std::string PlanWriter::RegistrationName(
+    const TfLiteRegistration* registration) {
+  size_t index = 0;
+  while (index < registrations_.size() && registrations_[index] != registration)
+    ++index;
+  if (index == registrations_.size()) registrations_.push_back(registration);
+  return "kRegistration" + std::to_string(index);
+}
+
+void PlanWriter::WriteHeader(FILE* out, const std::string& model_name,
+                             const std::string& name_space,
+                             const std::string& guard) {
+  fprintf(out,
+          "// Generated by tensorflow/lite/micro/tools/host/"
+          "generate_static_plan from\n"
+          "// %s, do not edit.\n"
+          "\n"
+          "#ifndef %s\n"
+          "#define %s\n"
+          "\n"
+          "#include \"tensorflow/lite/c/common.h\"\n"
+          "#include \"tensorflow/lite/micro/micro_static_plan.h\"\n"
+          "\n"
+          "namespace %s {\n"
+          "\n"
+          "// The static plan of %s. The arena holds %zu bytes of planned\n"
+          "// buffers and the persistent data of the kernels, %zu bytes on "
+          "the host.\n"
+          "extern const tflite::StaticPlan kPlan;\n"
+          "\n"
+          "// Runs the nodes of the plan in order, after runner->Setup().\n"
+          "TfLiteStatus Invoke(tflite::StaticPlanRunner* runner);\n"
+          "\n"
+          "}  // namespace %s\n"
+          "\n"
+          "#endif  // %s\n",
+          model_name.c_str(), guard.c_str(), guard.c_str(), name_space.c_str(),
+          model_name.c_str(), head_bytes_,
+          interpreter_->arena_used_bytes() - head_bytes_, name_space.c_str(),
+          guard.c_str());
+}
+
+void PlanWriter::WriteSource(FILE* out, const std::string& model_name,
+                             const std::string& name_space,
+                             const std::string& include,
+                             const std::string& model_header,
+                             const std::string& model_symbol) {
+  fprintf(out,
+          "// Generated by tensorflow/lite/micro/tools/host/"
+          "generate_static_plan from\n"
+          "// %s, do not edit.\n"
+          "\n"
+          "#include \"%s\"\n"
+          "\n"
+          "#include \"tensorflow/lite/c/builtin_op_data.h\"\n"
+          "#include \"tensorflow/lite/micro/micro_graph_fusion.h\"\n"
+          "#include \"tensorflow/lite/schema/schema_generated.h\"\n"
+          "#include \"%s\"\n"
+          "\n",
+          model_name.c_str(), include.c_str(), model_header.c_str());
+
+  // The kernel functions.
+  for (const std::string& function_namespace : namespaces_) {
+    std::vector<std::string> names;
+    for (size_t start = 0; start != std::string::npos;) {
+      const size_t end = function_namespace.find("::", start);
+      names.push_back(function_namespace.substr(
+          start, end == std::string::npos ? end : end - start));
+      start = end == std::string::npos ? end : end + 2;
+    }
+    for (const std::string& name : names) {
+      fprintf(out, "namespace %s {\n", name.c_str());
+    }
+    for (const std::string& declaration : declarations_[function_namespace]) {
+      fprintf(out, "%s\n", declaration.c_str());
+    }
+    for (auto name = names.rbegin(); name != names.rend(); ++name) {
+      fprintf(out, "}  // namespace %s\n", name->c_str());
+    }
+    fprintf(out, "\n");
+  }
+
+  fprintf(out, "namespace %s {\nnamespace {\n\n", name_space.c_str());
+
+  // Tensors.
+  for (size_t i = 0; i < tensors_.size(); ++i) {
+    fprintf(out, "const int32_t kDims%zu[] = %s;\n", i,
+            tensors_[i].dims.c_str());
+    if (tensors_[i].channels == 0) continue;
+    const tflite::QuantizationParameters* quantization =
+        subgraph_->tensors()->Get(i)->quantization();
+    fprintf(out, "const float kScales%zu[] = {", i);
+    for (int c = 0; c < tensors_[i].channels; ++c) {
+      fprintf(out, "%s%s", c > 0 ? ", " : "",
+              FloatLiteral(quantization->scale()->Get(c)).c_str());
+    }
+    // A single zero point is used for all the channels, as MicroAllocator.
+    fprintf(out, "};\nconst int32_t kZeroPoints%zu[] = {", i);
+    for (int c = 0; c < tensors_[i].channels; ++c) {
+      const size_t z = quantization->zero_point()->size() == 1 ? 0 : c;
+      fprintf(out, "%s%d", c > 0 ? ", " : "",
+              static_cast<int>(quantization->zero_point()->Get(z)));
+    }
+    fprintf(out, "};\n");
+  }
+  fprintf(out, "\nconst tflite::StaticPlanTensor kTensors[] = {\n");
+  for (size_t i = 0; i < tensors_.size(); ++i) {
+    const Tensor& tensor = tensors_[i];
+    fprintf(out, "    {%s, %s, %zu, %zu, kDims%zu, ", TypeName(tensor.type),
+            tensor.kind, tensor.offset, tensor.bytes, i);
+    if (tensor.channels > 0) {
+      fprintf(out, "%d, %d, kScales%zu, kZeroPoints%zu},\n", tensor.channels,
+              tensor.quantized_dimension, i, i);
+    } else {
+      fprintf(out, "0, 0, nullptr, nullptr},\n");
+    }
+  }
+  fprintf(out, "};\n\n");
+
+  // Kernels.
+  for (size_t r = 0; r < registrations_.size(); ++r) {
+    const TfLiteRegistration* registration = registrations_[r];
+    const void* functions[] = {
+        reinterpret_cast<const void*>(registration->init),
+        reinterpret_cast<const void*>(registration->free),
+        reinterpret_cast<const void*>(registration->prepare),
+        reinterpret_cast<const void*>(registration->invoke)};
+    fprintf(out, "const TfLiteRegistration kRegistration%zu = {\n", r);
+    for (const void* function : functions) {
+      fprintf(out, "    %s,\n",
+              function == nullptr ? "nullptr"
+                                  : function_names_.at(function).c_str());
+    }
+    if (registration->builtin_code == tflite::BuiltinOperator_CUSTOM) {
+      fprintf(out,
+              "    nullptr, tflite::BuiltinOperator_CUSTOM, \"%s\", %d};\n",
+              registration->custom_name, registration->version);
+    } else {
+      fprintf(out, "    nullptr, tflite::BuiltinOperator_%s, nullptr, %d};\n",
+              OpName(registration), registration->version);
+    }
+  }
+  fprintf(out, "\n");
+
+  // Nodes.
+  for (const Node& node : nodes_) {
+    fprintf(out, "const int32_t kInputs%d[] = %s;\n", node.index,
+            node.inputs.c_str());
+    fprintf(out, "const int32_t kOutputs%d[] = %s;\n", node.index,
+            node.outputs.c_str());
+    if (node.builtin_data_type != nullptr) {
+      fprintf(out, "const int32_t kBuiltinData%d[] = {", node.index);
+      for (size_t w = 0; w < node.builtin_data.size(); ++w) {
+        fprintf(out, "%s%d", w > 0 ? ", " : "",
+                static_cast<int32_t>(node.builtin_data[w]));
+      }
+      fprintf(out, "};\nstatic_assert(sizeof(%s) == sizeof(kBuiltinData%d),\n"
+                   "              \"The builtin data of node %d changed.\");\n",
+              node.builtin_data_type->type, node.index, node.index);
+    }
+    if (!node.custom_data.empty()) {
+      fprintf(out, "const char kCustomData%d[] = {", node.index);
+      for (size_t b = 0; b < node.custom_data.size(); ++b) {
+        fprintf(out, "%s%d", b > 0 ? ", " : "",
+                static_cast<int8_t>(node.custom_data[b]));
+      }
+      fprintf(out, "};\n");
+    }
+  }
+  fprintf(out, "\nconst tflite::StaticPlanNode kNodes[] = {\n");
+  for (const Node& node : nodes_) {
+    fprintf(out, "    {&%s, kInputs%d, kOutputs%d, ",
+            RegistrationName(node.registration).c_str(), node.index,
+            node.index);
+    if (node.builtin_data_type != nullptr) {
+      fprintf(out, "kBuiltinData%d, ", node.index);
+    } else {
+      fprintf(out, "nullptr, ");
+    }
+    if (!node.custom_data.empty()) {
+      fprintf(out, "kCustomData%d, %zu},\n", node.index,
+              node.custom_data.size());
+    } else {
+      fprintf(out, "nullptr, 0},\n");
+    }
+  }
+  fprintf(out, "};\n\n");
+
+  // Scratch buffers, by buffer_idx.
+  if (!scratch_buffers_.empty()) {
+    fprintf(out,
+            "const tflite::StaticPlanScratchBuffer kScratchBuffers[] = {\n");
+    for (const auto& buffer : scratch_buffers_) {
+      fprintf(out, "    {%zu, %zu},\n", buffer.first, buffer.second);
+    }
+    fprintf(out, "};\n\n");
+  }
+
+  fprintf(out, "const int32_t kInputs[] = {%u", subgraph_->inputs()->size());
+  for (size_t i = 0; i < subgraph_->inputs()->size(); ++i) {
+    fprintf(out, ", %d", subgraph_->inputs()->Get(i));
+  }
+  fprintf(out, "};\nconst int32_t kOutputs[] = {%u",
+          subgraph_->outputs()->size());
+  for (size_t i = 0; i < subgraph_->outputs()->size(); ++i) {
+    fprintf(out, ", %d", subgraph_->outputs()->Get(i));
+  }
+  fprintf(out, "};\n\n}  // namespace\n\n");
+
+  fprintf(out,
+          "const tflite::StaticPlan kPlan = {\n"
+          "    %s,\n"
+          "    kTensors,\n    %zu,\n"
+          "    kNodes,\n    %zu,\n"
+          "    %s,\n    %zu,\n"
+          "    kInputs,\n    kOutputs,\n    %zu};\n\n",
+          model_symbol.c_str(), tensors_.size(), nodes_.size(),
+          scratch_buffers_.empty() ? "nullptr" : "kScratchBuffers",
+          scratch_buffers_.size(), head_bytes_);
+
+  fprintf(out,
+          "TfLiteStatus Invoke(tflite::StaticPlanRunner* runner) {\n"
+          "  TfLiteContext* context = runner->context();\n"
+          "  TfLiteNode* nodes = runner->nodes();\n");
+  for (size_t n = 0; n < nodes_.size(); ++n) {
+    if (nodes_[n].eval.empty()) continue;
+    fprintf(out,
+            "  // Node %d, %s.\n"
+            "  TF_LITE_ENSURE_STATUS(%s(context, &nodes[%zu]));\n",
+            nodes_[n].index, OpName(nodes_[n].registration),
+            nodes_[n].eval.c_str(), n);
+  }
+  fprintf(out, "  return kTfLiteOk;\n}\n\n}  // namespace %s\n",
+          name_space.c_str());
+}
+
+std::string GuardOf(const std::string& path) {
+  std::string guard;
+  for (char c : path) {
+    guard += isalnum(static_cast<unsigned char>(c))
+                 ? static_cast<char>(toupper(static_cast<unsigned char>(c)))
+                 : '_';
+  }
+  return guard + "_";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const char* model_path = nullptr;
+  std::string model_header;
+  std::string model_symbol;
+  std::string header_path;
+  std::string source_path;
+  std::string name_space = "model_plan";
+  std::string include;
+  std::string guard;
+  for (int i = 1; i < argc; ++i) {
+    const bool has_value = i + 1 < argc;
+    if (strcmp(argv[i], "--model-header") == 0 && has_value) {
+      model_header = argv[++i];
+    } else if (strcmp(argv[i], "--model-symbol") == 0 && has_value) {
+      model_symbol = argv[++i];
+    } else if (strcmp(argv[i], "--header") == 0 && has_value) {
+      header_path = argv[++i];
+    } else if (strcmp(argv[i], "--source") == 0 && has_value) {
+      source_path = argv[++i];
+    } else if (strcmp(argv[i], "--namespace") == 0 && has_value) {
+      name_space = argv[++i];
+    } else if (strcmp(argv[i], "--include") == 0 && has_value) {
+      include = argv[++i];
+    } else if (strcmp(argv[i], "--guard") == 0 && has_value) {
+      guard = argv[++i];
+    } else if (argv[i][0] != '-' && model_path == nullptr) {
+      model_path = argv[i];
+    } else {
+      model_path = nullptr;
+      break;
+    }
+  }
+  if (model_path == nullptr || model_header.empty() || model_symbol.empty() ||
+      header_path.empty() || source_path.empty()) {
+    fprintf(stderr,
+            "Usage: %s MODEL --model-header HEADER --model-symbol NAME "
+            "--header FILE --source FILE [--namespace NAME] [--include PATH] "
+            "[--guard GUARD]\n",
+            argv[0]);
+    return 1;
+  }
+  if (include.empty()) include = tflite::host::BaseName(header_path.c_str());
+  if (guard.empty()) guard = GuardOf(include);
+
+  std::vector<uint8_t> data;
+  const tflite::Model* model = tflite::host::LoadModel(model_path, &data);
+  if (model == nullptr) return 1;
+  if (model->subgraphs()->size() != 1) {
+    fprintf(stderr, "%s: only models with one subgraph are supported\n",
+            model_path);
+    return 1;
+  }
+
+  tflite::MicroErrorReporter micro_error_reporter;
+  tflite::AllOpsResolver resolver;
+  PlanInterpreter interpreter(model, resolver, tensor_arena, kTensorArenaSize,
+                              &micro_error_reporter);
+  if (interpreter.AllocateTensors() != kTfLiteOk) {
+    fprintf(stderr, "%s: AllocateTensors() failed\n", model_path);
+    return 1;
+  }
+
+  PlanWriter writer(model, data, &interpreter);
+  if (!writer.Collect()) return 1;
+
+  const std::string model_name = tflite::host::BaseName(model_path);
+  FILE* header = fopen(header_path.c_str(), "w");
+  FILE* source = fopen(source_path.c_str(), "w");
+  if (header == nullptr || source == nullptr) {
+    fprintf(stderr, "Can not write %s and %s\n", header_path.c_str(),
+            source_path.c_str());
+    return 1;
+  }
+  writer.WriteHeader(header, model_name, name_space, guard);
+  writer.WriteSource(source, model_name, name_space, include, model_header,
+                     model_symbol);
+  fclose(header);
+  fclose(source);
+  return 0;
+}
@@ -0,0 +1,159 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/micro/tools/host/kernel_check.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "tensorflow/lite/kernels/internal/quantization_util.h"
+#include "tensorflow/lite/micro/test_helpers.h"
+
+namespace tflite {
+namespace host {
+
+constexpr int ChannelQuantization::kMaxChannels;
+
+uint32_t Random::Next() {
+  // xorshift32
+  state_ ^= state_ << 13;
+  state_ ^= state_ >> 17;
+  state_ ^= state_ << 5;
+  return state_;
+}
+
+int32_t Random::Int(int32_t min, int32_t max) {
+  const uint32_t range = static_cast<uint32_t>(max - min) + 1;
+  return min + static_cast<int32_t>(range == 0 ? Next() : Next() % range);
+}
+
+float Random::Float(float min, float max) {
+  return min + (max - min) * (Next() >> 8) / static_cast<float>(1 << 24);
+}
+
+TfLiteTensor Int8Tensor(int8_t* data, int* dims, float scale, int zero_point,
+                        bool constant) {
+  TfLiteTensor tensor = testing::CreateQuantizedTensor(
+      data, testing::IntArrayFromInts(dims), scale, zero_point);
+  if (constant) tensor.allocation_type = kTfLiteMmapRo;
+  return tensor;
+}
+
+TfLiteTensor Int16Tensor(int16_t* data, int* dims, float scale,
+                         int zero_point) {
+  return testing::CreateQuantizedTensor(data, testing::IntArrayFromInts(dims),
+                                        scale, zero_point);
+}
+
+TfLiteTensor Int32Tensor(int32_t* data, int* dims, float scale,
+                         bool constant) {
+  TfLiteTensor tensor =
+      testing::CreateInt32Tensor(data, testing::IntArrayFromInts(dims));
+  tensor.params = {scale, 0};
+  if (constant) tensor.allocation_type = kTfLiteMmapRo;
+  return tensor;
+}
+
+void SetChannelQuantization(TfLiteTensor* tensor, int dimension,
+                            const float* scales,
+                            ChannelQuantization* storage) {
+  const int channels = tensor->dims->data[dimension];
+  TFLITE_DCHECK(channels <= ChannelQuantization::kMaxChannels);
+  storage->scales[0] = channels;
+  storage->zero_points[0] = channels;
+  for (int i = 0; i < channels; ++i) {
+    storage->scales[i + 1] = scales[i];
+    storage->zero_points[i + 1] = 0;
+  }
+  storage->params.scale = testing::FloatArrayFromFloats(storage->scales);
+  storage->params.zero_point = testing::IntArrayFromInts(storage->zero_points);
+  storage->params.quantized_dimension = dimension;
+  tensor->params = {scales[0], 0};
+  tensor->quantization = {kTfLiteAffineQuantization, &storage->params};
+}
+
+void Int8ActivationRange(TfLiteFusedActivation activation, float scale,
+                         int zero_point, int32_t* min, int32_t* max) {
+  auto quantize = [scale, zero_point](float value) {
+    return zero_point + static_cast<int32_t>(std::round(value / scale));
+  };
+  *min = std::numeric_limits<int8_t>::min();
+  *max = std::numeric_limits<int8_t>::max();
+  if (activation == kTfLiteActRelu) {
+    *min = std::max(*min, quantize(0.0f));
+  } else if (activation == kTfLiteActRelu6) {
+    *min = std::max(*min, quantize(0.0f));
+    *max = std::min(*max, quantize(6.0f));
+  } else if (activation == kTfLiteActRelu1) {
+    *min = std::max(*min, quantize(-1.0f));
+    *max = std::min(*max, quantize(1.0f));
+  }
+}
+
+void ChannelMultipliers(float input_scale, const float* filter_scales,
+                        float output_scale, int channels, int32_t* multipliers,
+                        int32_t* shifts) {
+  for (int i = 0; i < channels; ++i) {
+    int shift;
+    QuantizeMultiplier(static_cast<double>(input_scale) *
+                           static_cast<double>(filter_scales[i]) /
+                           static_cast<double>(output_scale),
+                       &multipliers[i], &shift);
+    shifts[i] = shift;
+  }
+}
+
+KernelCheck::KernelCheck(const TfLiteRegistration& registration,
+                         TfLiteTensor* tensors, int tensors_size, int* inputs,
+                         int* outputs, void* builtin_data)
+    : runner_(registration, tensors, tensors_size,
+              testing::IntArrayFromInts(inputs),
+              testing::IntArrayFromInts(outputs), builtin_data,
+              &error_reporter_) {}
+
+bool KernelCheck::Prepare() {
+  if (runner_.InitAndPrepare() != kTfLiteOk) {
+    printf("Init or Prepare failed\n");
+    return false;
+  }
+  return true;
+}
+
+bool KernelCheck::Invoke() {
+  if (runner_.Invoke() != kTfLiteOk) {
+    printf("Invoke failed\n");
+    return false;
+  }
+  return true;
+}
+
+double KernelCheck::InvokeNanoseconds() {
+  return Nanoseconds([this]() { runner_.Invoke(); });
+}
+
+void PrintHeader() {
+  printf("%-44s %12s %12s %8s  %s\n", "case", "kernel ns", "reference ns",
+         "speedup", "output");
+}
+
+void PrintResult(const char* name, double kernel_ns, double reference_ns,
+                 bool same) {
+  printf("%-44s %12.0f %12.0f %7.2fx  %s\n", name, kernel_ns, reference_ns,
+         reference_ns / kernel_ns, same ? "bit-exact" : "MISMATCH");
+}
+
+}  // namespace host
+}  // namespace tflite
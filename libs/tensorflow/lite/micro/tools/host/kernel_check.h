@@ -0,0 +1,148 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_MICRO_TOOLS_HOST_KERNEL_CHECK_H_
+#define TENSORFLOW_LITE_MICRO_TOOLS_HOST_KERNEL_CHECK_H_
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#include "tensorflow/lite/c/builtin_op_data.h"
+#include "tensorflow/lite/c/common.h"
+#include "tensorflow/lite/micro/kernels/kernel_runner.h"
+#include "tensorflow/lite/micro/micro_error_reporter.h"
+
+namespace tflite {
+namespace host {
+
+// Shared by the check_<kernel> programs: each one runs a micro kernel through
+// KernelRunner on random data, runs the reference kernel it replaces on the
+// same data and compares the outputs byte for byte. Both are timed on the
+// host, which shows the relative cost, not the cycles of the target.
+
+// Deterministic pseudo-random values, the same on every run.
+class Random {
+ public:
+  explicit Random(uint32_t seed = 1) : state_(seed) {}
+
+  // In [min, max].
+  int32_t Int(int32_t min, int32_t max);
+  float Float(float min, float max);
+  template <typename T>
+  void Fill(T* data, int size, int32_t min, int32_t max) {
+    for (int i = 0; i < size; ++i) data[i] = static_cast<T>(Int(min, max));
+  }
+
+ private:
+  uint32_t Next();
+  uint32_t state_;
+};
+
+// A TfLiteTensor over `data`, laid out like the tensors of a model. `dims`
+// is the TfLiteIntArray layout of test_helpers.h, size first, and must
+// outlive the tensor. Constant tensors (weights) are kTfLiteMmapRo, which is
+// what the kernels that fold their weights at Prepare time check for.
+TfLiteTensor Int8Tensor(int8_t* data, int* dims, float scale, int zero_point,
+                        bool constant = false);
+TfLiteTensor Int16Tensor(int16_t* data, int* dims, float scale,
+                         int zero_point);
+TfLiteTensor Int32Tensor(int32_t* data, int* dims, float scale,
+                         bool constant = false);
+
+// Per-channel quantization of a tensor, with the storage it points to.
+struct ChannelQuantization {
+  static constexpr int kMaxChannels = 256;
+  float scales[kMaxChannels + 1];
+  int zero_points[kMaxChannels + 1];
+  TfLiteAffineQuantization params;
+};
+
+// Makes `tensor` per-channel quantized along `dimension` with `scales`, one
+// per channel, and zero points 0 as the converter writes for int8 weights.
+void SetChannelQuantization(TfLiteTensor* tensor, int dimension,
+                            const float* scales, ChannelQuantization* storage);
+
+// The output range of `activation` for an int8 output, as
+// CalculateActivationRangeQuantized() computes it.
+void Int8ActivationRange(TfLiteFusedActivation activation, float scale,
+                         int zero_point, int32_t* min, int32_t* max);
+
+// The per-channel output multipliers and shifts of a convolution, as
+// PopulateConvolutionQuantizationParams() computes them.
+void ChannelMultipliers(float input_scale, const float* filter_scales,
+                        float output_scale, int channels, int32_t* multipliers,
+                        int32_t* shifts);
+
+// Runs `registration` as one node over `tensors`: Init and Prepare once, then
+// Invoke. `inputs` and `outputs` are TfLiteIntArray layouts of indices into
+// `tensors`. The steps print the reason and return false if they fail.
+// KernelRunner allocates from one static buffer, so only one KernelCheck may
+// exist at a time.
+class KernelCheck {
+ public:
+  KernelCheck(const TfLiteRegistration& registration, TfLiteTensor* tensors,
+              int tensors_size, int* inputs, int* outputs, void* builtin_data);
+
+  bool Prepare();
+  bool Invoke();
+  // Nanoseconds per Invoke(), over enough calls to measure.
+  double InvokeNanoseconds();
+
+ private:
+  MicroErrorReporter error_reporter_;
+  micro::KernelRunner runner_;
+};
+
+using Clock = std::chrono::steady_clock;
+
+// Nanoseconds per call of `function`, over at least kMinDuration.
+template <typename Function>
+double Nanoseconds(Function function) {
+  constexpr auto kMinDuration = std::chrono::milliseconds(50);
+  long calls = 0;
+  const Clock::time_point start = Clock::now();
+  Clock::duration elapsed;
+  do {
+    function();
+    ++calls;
+    elapsed = Clock::now() - start;
+  } while (elapsed < kMinDuration || calls < 3);
+  return std::chrono::duration<double, std::nano>(elapsed).count() / calls;
+}
+
+// Compares `size` outputs, prints the first difference. Returns true if all
+// are the same.
+template <typename T>
+bool SameOutput(const char* name, const T* actual, const T* expected,
+                int size) {
+  for (int i = 0; i < size; ++i) {
+    if (actual[i] != expected[i]) {
+      printf("%s: output %d is %d, the reference gives %d\n", name, i,
+             static_cast<int>(actual[i]), static_cast<int>(expected[i]));
+      return false;
+    }
+  }
+  return true;
+}
+
+// One line of the result table of a check program.
+void PrintHeader();
+void PrintResult(const char* name, double kernel_ns, double reference_ns,
+                 bool same);
+
+}  // namespace host
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_MICRO_TOOLS_HOST_KERNEL_CHECK_H_
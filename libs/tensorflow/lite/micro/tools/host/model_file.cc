@@ -0,0 +1,126 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/micro/tools/host/model_file.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace tflite {
+namespace host {
+namespace {
+
+bool EndsWith(const char* text, const char* suffix) {
+  const size_t text_len = strlen(text);
+  const size_t suffix_len = strlen(suffix);
+  return text_len >= suffix_len &&
+         strcmp(text + text_len - suffix_len, suffix) == 0;
+}
+
+bool ReadFile(const char* path, std::vector<uint8_t>* data) {
+  FILE* file = fopen(path, "rb");
+  if (file == nullptr) {
+    fprintf(stderr, "%s: can not open\n", path);
+    return false;
+  }
+  data->clear();
+  uint8_t chunk[4096];
+  size_t read;
+  while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    data->insert(data->end(), chunk, chunk + read);
+  }
+  fclose(file);
+  return true;
+}
+
+// The bytes of the first {...} array of an `xxd -i` style source.
+bool ParseArray(const char* path, std::vector<uint8_t>* data) {
+  std::vector<uint8_t> text;
+  if (!ReadFile(path, &text)) return false;
+  text.push_back('\0');
+
+  const char* p = strchr(reinterpret_cast<const char*>(text.data()), '{');
+  if (p == nullptr) {
+    fprintf(stderr, "%s: no array found\n", path);
+    return false;
+  }
+  data->clear();
+  for (++p; *p != '\0' && *p != '}'; ++p) {
+    if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+      char* end;
+      data->push_back(static_cast<uint8_t>(strtoul(p, &end, 16)));
+      p = end - 1;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+const Model* LoadModel(const char* path, std::vector<uint8_t>* data) {
+  const bool is_source = EndsWith(path, ".cc") || EndsWith(path, ".c");
+  if (!(is_source ? ParseArray(path, data) : ReadFile(path, data))) {
+    return nullptr;
+  }
+  // Without the file identifier check, some test models have none.
+  flatbuffers::Verifier verifier(data->data(), data->size());
+  if (!verifier.VerifyBuffer<Model>(nullptr)) {
+    fprintf(stderr, "%s: not a valid TensorFlow Lite model\n", path);
+    return nullptr;
+  }
+  return GetModel(data->data());
+}
+
+bool SaveModel(const char* path, const uint8_t* data, size_t size,
+               const char* symbol, const char* header) {
+  const bool is_source = EndsWith(path, ".cc");
+  if (is_source && (symbol == nullptr || header == nullptr)) {
+    fprintf(stderr, "%s: a model source needs a symbol and a header\n", path);
+    return false;
+  }
+  FILE* file = fopen(path, is_source ? "w" : "wb");
+  if (file == nullptr) {
+    fprintf(stderr, "%s: can not create\n", path);
+    return false;
+  }
+  if (!is_source) {
+    fwrite(data, 1, size, file);
+    return fclose(file) == 0;
+  }
+  fprintf(file,
+          "// Written by a tool of tensorflow/lite/micro/tools/host, do not "
+          "edit.\n"
+          "\n"
+          "#include \"%s\"\n"
+          "\n"
+          "// Keep model aligned to 8 bytes to guarantee aligned 64-bit "
+          "accesses.\n"
+          "alignas(8) const unsigned char %s[] = {",
+          header, symbol);
+  for (size_t i = 0; i < size; ++i) {
+    fprintf(file, "%s0x%02x", i % 12 == 0 ? (i > 0 ? ",\n  " : "\n  ") : ", ",
+            data[i]);
+  }
+  fprintf(file, "\n};\nconst int %s_len = %zu;\n", symbol, size);
+  return fclose(file) == 0;
+}
+
+std::string BaseName(const char* path) {
+  const char* slash = strrchr(path, '/');
+  return slash != nullptr ? slash + 1 : path;
+}
+
+}  // namespace host
+}  // namespace tflite
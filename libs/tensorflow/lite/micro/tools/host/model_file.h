@@ -0,0 +1,48 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_MICRO_TOOLS_HOST_MODEL_FILE_H_
+#define TENSORFLOW_LITE_MICRO_TOOLS_HOST_MODEL_FILE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace tflite {
+namespace host {
+
+// Reads a model for the host tools, either a .tflite flatbuffer or a C array
+// made from one by `xxd -i` (the model.cc files of the examples): for a file
+// ending in .cc or .c every 0x.. byte after the first '{' is taken. The
+// buffer is kept in `data`, which must outlive the returned model. Returns
+// nullptr and prints the reason to stderr on failure.
+const Model* LoadModel(const char* path, std::vector<uint8_t>* data);
+
+// Writes a model as LoadModel() reads it: a .tflite flatbuffer, or for a path
+// ending in .cc an `xxd -i` style array named `symbol` (with a `symbol`_len),
+// laid out as the model.cc files of the examples and including `header`.
+// Returns false and prints the reason to stderr on failure.
+bool SaveModel(const char* path, const uint8_t* data, size_t size,
+               const char* symbol, const char* header);
+
+// The file name of `path` without the directory, for the headers of the
+// generated files.
+std::string BaseName(const char* path);
+
+}  // namespace host
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_MICRO_TOOLS_HOST_MODEL_FILE_H_
@@ -0,0 +1,100 @@
+/* Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+// Host stand-in for the CMSIS header of the same name: the DSP intrinsics
+// used by the micro kernels, in portable C++ with the semantics of the
+// Cortex-M4 instructions. The kernels are built with -D__ARM_FEATURE_DSP=1
+// and this directory first on the include path, so that the check_kernels
+// programs run their DSP paths on the host (the _dsp checks).
+#ifndef TENSORFLOW_LITE_MICRO_TOOLS_HOST_STUBS_CMSIS_COMPILER_H_
+#define TENSORFLOW_LITE_MICRO_TOOLS_HOST_STUBS_CMSIS_COMPILER_H_
+
+#include <stdint.h>
+
+// The GE flags of the APSR, one bit per byte lane, set by __SSUB8 and
+// __SADD16 and read by __SEL.
+static inline uint32_t& HostApsrGe() {
+  static uint32_t ge = 0;
+  return ge;
+}
+
+// Sign extends bytes 0 and 2 into the two 16-bit lanes.
+static inline uint32_t __SXTB16(uint32_t op1) {
+  const uint32_t low = static_cast<uint16_t>(static_cast<int8_t>(op1));
+  const uint32_t high = static_cast<uint16_t>(static_cast<int8_t>(op1 >> 16));
+  return low | (high << 16);
+}
+
+// Rotate right.
+static inline uint32_t __ROR(uint32_t op1, uint32_t op2) {
+  op2 %= 32;
+  return op2 == 0 ? op1 : (op1 >> op2) | (op1 << (32 - op2));
+}
+
+// Both signed 16-bit lane products added to op3.
+static inline uint32_t __SMLAD(uint32_t op1, uint32_t op2, uint32_t op3) {
+  const int32_t low = static_cast<int16_t>(op1) * static_cast<int16_t>(op2);
+  const int32_t high =
+      static_cast<int16_t>(op1 >> 16) * static_cast<int16_t>(op2 >> 16);
+  return op3 + static_cast<uint32_t>(low) + static_cast<uint32_t>(high);
+}
+
+// Lane-wise difference of four signed bytes, GE set where op1 >= op2.
+static inline uint32_t __SSUB8(uint32_t op1, uint32_t op2) {
+  uint32_t result = 0;
+  uint32_t ge = 0;
+  for (int lane = 0; lane < 4; ++lane) {
+    const int32_t diff = static_cast<int8_t>(op1 >> (8 * lane)) -
+                         static_cast<int8_t>(op2 >> (8 * lane));
+    if (diff >= 0) ge |= 1u << lane;
+    result |= (static_cast<uint32_t>(diff) & 0xFF) << (8 * lane);
+  }
+  HostApsrGe() = ge;
+  return result;
+}
+
+// Bytes of op1 where the GE flag of the lane is set, of op2 elsewhere.
+static inline uint32_t __SEL(uint32_t op1, uint32_t op2) {
+  uint32_t result = 0;
+  for (int lane = 0; lane < 4; ++lane) {
+    const uint32_t mask = 0xFFu << (8 * lane);
+    result |= ((HostApsrGe() >> lane) & 1 ? op1 : op2) & mask;
+  }
+  return result;
+}
+
+// Lane-wise sum of two signed halfwords, wrapping, GE set per halfword
+// where the sum is >= 0.
+static inline uint32_t __SADD16(uint32_t op1, uint32_t op2) {
+  const int32_t low = static_cast<int16_t>(op1) + static_cast<int16_t>(op2);
+  const int32_t high =
+      static_cast<int16_t>(op1 >> 16) + static_cast<int16_t>(op2 >> 16);
+  HostApsrGe() = (low >= 0 ? 0x3u : 0u) | (high >= 0 ? 0xCu : 0u);
+  return (static_cast<uint32_t>(low) & 0xFFFF) |
+         (static_cast<uint32_t>(high) << 16);
+}
+
+// Bottom halfword of op1, top halfword of op2 shifted left by op3.
+static inline uint32_t __PKHBT(uint32_t op1, uint32_t op2, uint32_t op3) {
+  return (op1 & 0xFFFF) | ((op2 << op3) & 0xFFFF0000);
+}
+
+// Top halfword of op1, bottom halfword of op2 shifted right (arithmetic)
+// by op3.
+static inline uint32_t __PKHTB(uint32_t op1, uint32_t op2, uint32_t op3) {
+  return (op1 & 0xFFFF0000) |
+         (static_cast<uint32_t>(static_cast<int32_t>(op2) >> op3) & 0xFFFF);
+}
+
+#endif  // TENSORFLOW_LITE_MICRO_TOOLS_HOST_STUBS_CMSIS_COMPILER_H_
@@ -45,14 +45,66 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "led.h"
 #include "audio.h"
 #include "fft.h"
+#include "spectrogram.h"
+#include "mel.h"
+#include "mfcc.h"
+#include "vad.h"
 #include "error.h"
 #include "words.h"
+#include "main_functions.h"
+
+/* 1 - listen all the time, 0 - record 2 sec after the user button is pressed */
+#define ALWAYS_ON_MODE		1
+
+/* Streaming capture ring: samples per block and number of blocks */
+#define STREAM_BLOCK_SIZE	1024u
+#define STREAM_BLOCK_NUM	4u
+
+/* Number of sound bits for FFT */
+#define FFT_FRAME_SIZE		128u
+
+/* Sound bits between the starts of two frames (FFT_FRAME_SIZE - no overlap).
+ * E.g. 256/128 or 128/64 give a finer time step for more compute; the model
+ * input has to match FFT_FRAME_NUM(), the shipped one is 128/128. */
+#define FFT_HOP_SIZE		128u
+
+/* Window of the FFT frames, the shipped model was trained without one */
+#define FFT_WINDOW			FFT_WINDOW_NONE
+
+/* New FFT frames (hops) between two inferences in the always-on mode */
+#define STREAM_STRIDE		24u
+
+/* Features of a frame given to the model:
+ * 	FEATURE_LINEAR	-	upper half of the FFT magnitudes (the shipped model);
+ * 	FEATURE_LOG_MEL	-	MEL_CHANNELS log-mel energies (needs a model trained on them);
+ * 	FEATURE_MFCC	-	first MFCC_COEFFICIENTS MFCC of them (same). */
+#define FEATURE_MODE		FEATURE_LINEAR
+
+/* 1 - skip the FFT and the model on silence (voice activity gate, see vad.h) */
+#define VAD_GATE			1
+
+/* Log-mel filterbank */
+#define MEL_CHANNELS		40u
+#define MEL_LOW_FREQ		125.0f
+#define MEL_HIGH_FREQ		7500.0f
+
+/* MFCC per frame */
+#define MFCC_COEFFICIENTS	13u
+
+/* Features per frame */
+#define FEATURE_WIDTH		(FEATURE_MODE == FEATURE_MFCC ? MFCC_COEFFICIENTS : \
+							 FEATURE_MODE == FEATURE_LOG_MEL ? MEL_CHANNELS : FFT_FRAME_SIZE/2)
 
 void init(int16_t* data);
+static void setup_features(struct fft_context *fft, struct fft_quant *quant,
+						   struct mel_filterbank *mel, struct mfcc *mfcc);
+static const char *decide(const struct model_score *score);
+static void show_word(const char *word);
 static  void print_array(int8_t active_button, const int16_t *data, uint16_t frame_num, uint16_t frame_size);
 
 /*******************************************************************************
@@ -63,7 +115,14 @@ static  void print_array(int8_t active_button, const int16_t *data, uint16_t fra
 *    	1. Initialize the hardware and configure the audio codec.
 *    	2. Initialize TF model.
 *
-*    	Do Forever loop:
+*    	Always-on mode, do forever loop:
+*    		3. Wait for the next block of the streaming capture.
+*    		4. Make FFT of its new frames only, straight into the rolling
+*    			spectrogram.
+*    		5. The spectrogram is checked by NN every STREAM_STRIDE frames.
+*    		6. Show the word if it has changed.
+*
+*    	Button mode, do forever loop:
 *    		3. Check the user button.
 *    			If it not pressed the next iteration is started, else
 *    				4. Audio recording start within 2 sec.
@@ -79,19 +138,93 @@ static  void print_array(int8_t active_button, const int16_t *data, uint16_t fra
 *******************************************************************************/
 int main(void)
 {
-	int8_t answer[words_count];
+	struct model_score score;
 	// FFT
-	uint16_t frame_size = 128;
-	uint16_t frame_num = BUFFER_SIZE/frame_size;
+	uint16_t frame_size = FFT_FRAME_SIZE;
+	uint16_t frame_num = FFT_FRAME_NUM(BUFFER_SIZE, FFT_FRAME_SIZE, FFT_HOP_SIZE);
+	// Features to the model input
+	struct fft_context fft;
+	struct fft_quant quant;
+	struct mel_filterbank mel;
+	struct mfcc mfcc;
+	// Voice activity gate
+	const struct vad_config vad_config = VAD_CONFIG_DEFAULT;
+	struct vad vad;
+
+#if ALWAYS_ON_MODE
+	// Ring filled by the PDM DMA and the rolling spectrogram of the last
+	// frame_num frames (features of FEATURE_MODE, as model inputs).
+	static int16_t stream_buffer[STREAM_BLOCK_NUM][STREAM_BLOCK_SIZE];
+	static int8_t spectrogram_store[FFT_FRAME_NUM(BUFFER_SIZE, FFT_FRAME_SIZE, FFT_HOP_SIZE) * FEATURE_WIDTH];
+	static q15_t spectrogram_scratch[SPECTROGRAM_SCRATCH_SIZE(FFT_FRAME_SIZE)];
+	struct audio_stream stream;
+	struct spectrogram spectrogram;
+	const char *last_word = NULL;
+
+	init(NULL);
+
+	// Initialize TF model
+	setup(frame_num, FEATURE_WIDTH);
+	// Only the best word is needed, the final SOFTMAX is not run.
+	setup_argmax();
+	setup_stream(STREAM_STRIDE);
+	setup_features(&fft, &quant, &mel, &mfcc);
+	spectrogram_init(&spectrogram, &fft, frame_num, frame_size/2, frame_size/2,
+					 &quant, spectrogram_store, spectrogram_scratch);
+	if (FEATURE_MODE == FEATURE_LOG_MEL)
+		spectrogram_use_mel(&spectrogram, &mel, &quant);
+	else if (FEATURE_MODE == FEATURE_MFCC)
+		spectrogram_use_mfcc(&spectrogram, &mfcc, &quant);
+	vad_init(&vad, FFT_FRAME_SIZE, &vad_config);
+	if (VAD_GATE)
+		spectrogram_use_vad(&spectrogram, &vad);
+
+	change_led_duty_cycle(BUTTON3, led[BUTTON3].brightness_passive);
 
+	audio_stream_init(&stream, stream_buffer[0], STREAM_BLOCK_SIZE, STREAM_BLOCK_NUM, NULL);
+	start_audio_stream(&stream);
+
+	for(;;){
+		// Frames are read in place from the ring, blocks are released
+		// when no overlapping frame needs them any more.
+		uint16_t new_frames = spectrogram_push_stream(&spectrogram, &stream);
+		if (new_frames == 0){
+			// Sleep until the DMA fills the next block.
+			__WFI();
+			continue;
+		}
+
+		// The model only runs if the gate let something into its window.
+		int ran = push_frames(spectrogram.store, spectrogram.head, new_frames,
+							  VAD_GATE ? vad_active(&vad, frame_num) : 1, &score);
+		if (ran != 0){
+			const char *word = ran > 0 ? decide(&score) : "Silence";
+			// Equal literals need not share an address, compare the text.
+			if (last_word == NULL || strcmp(word, last_word) != 0){
+				change_led_duty_cycle(BUTTON0, 100);
+				change_led_duty_cycle(BUTTON1, 100);
+				change_led_duty_cycle(BUTTON2, 100);
+				show_word(word);
+				last_word = word;
+			}
+		}
+	}
+#else
 	// Array containing the recorded data (stereo)
 	// 	must be two-dimensional.
 	int16_t recorded_data[NUM_CHANNELS][BUFFER_SIZE];
+	static q15_t fft_scratch[FFT_Q15_SCRATCH_SIZE(FFT_FRAME_SIZE)];
+	int8_t *features;
 
 	init(recorded_data[0]);
 
 	// Initialize TF model
-	setup(frame_num, frame_size/2);
+	setup(frame_num, FEATURE_WIDTH);
+	// Only the best word is needed, the final SOFTMAX is not run.
+	setup_argmax();
+	setup_features(&fft, &quant, &mel, &mfcc);
+	features = model_input(NULL, NULL);
+	vad_init(&vad, FFT_FRAME_SIZE, &vad_config);
 
 	change_led_duty_cycle(BUTTON3, led[BUTTON3].brightness_passive);
 	for(;;){
@@ -114,53 +247,128 @@ int main(void)
 			change_led_duty_cycle(BUTTON4, 100);
 			change_led_duty_cycle(BUTTON3, led[3].brightness_passive);
 
-			fft_q15(recorded_data[0], recorded_data[1], frame_num, frame_size);
-			//print_array(0, recorded_data[1], frame_num, frame_size);
+			// Nothing but silence: no features and no model run.
+			if (VAD_GATE && !vad_detect(&vad, recorded_data[0], frame_num, FFT_HOP_SIZE)){
+				skip_model();
+				show_word("Silence");
+			}
+			else{
+				// Features straight into the model input.
+				if (FEATURE_MODE == FEATURE_LOG_MEL)
+					mel_q15_features(&fft, recorded_data[0], features, frame_num, &mel, &quant, fft_scratch);
+				else if (FEATURE_MODE == FEATURE_MFCC)
+					mfcc_q15_features(&fft, recorded_data[0], features, frame_num, &mfcc, &quant, fft_scratch);
+				else
+					fft_q15_features(&fft, recorded_data[0], features, frame_num,
+									 frame_size/2, frame_size/2, &quant, fft_scratch);
+				// No word if Invoke() failed, score would be from a previous run.
+				if (run_model(&score)){
+					/*printf("Prediction: %d (%d)\n\r", score.best, score.probability);*/
+
+					show_word(decide(&score));
+				}
+			}
 
-			check(recorded_data[1], frame_num, frame_size, answer, words_count);
+			play_record();
+		}
+	}
+#endif
+}
 
-			/*printf("Prediction: [");
 
-			for (size_t i = 0; i < words_count; i++) {
-				printf(" %d", answer[i]);
-			}
+/******************************************************************************
+ * 	Function name: setup_features
+ **************************************
+ *	Summary:
+ *		Prepare the features of FEATURE_MODE for the model input made by
+ *		setup(): the FFT plan and window, the conversion to its scale and
+ *		zero point and, for FEATURE_LOG_MEL and FEATURE_MFCC, the filterbank
+ *		and the DCT. Everything is computed once, nothing per frame.
+ *
+ *	Parameters:
+ *		*fft	-	FFT context of FFT_FRAME_SIZE, FFT_HOP_SIZE and FFT_WINDOW;
+ *		*quant	-	conversion of the features to the model input;
+ *		*mel	-	filterbank, made only for FEATURE_LOG_MEL and FEATURE_MFCC;
+ *		*mfcc	-	DCT, made only for FEATURE_MFCC.
+ */
+static void setup_features(struct fft_context *fft, struct fft_quant *quant,
+						   struct mel_filterbank *mel, struct mfcc *mfcc){
+	static q15_t fft_window[FFT_FRAME_SIZE];
+	static q15_t mel_weights[MEL_WEIGHTS_SIZE(FFT_FRAME_SIZE)];
+	static q15_t mfcc_dct[MFCC_DCT_SIZE(MFCC_COEFFICIENTS, MEL_CHANNELS)];
+	float input_scale;
+	int32_t input_zero_point;
 
-			printf(" ]\n\r");*/
+	model_input(&input_scale, &input_zero_point);
 
-			int c = -1;
-			int max = 0;
-			int lower = 0;
-			for (size_t i = 0; i < words_count; i++) {
-				if (answer[i] > 64 && answer[i] > max) {
-					c = i;
-					max = answer[i];
-				} else if (answer[i] < -32) lower++;
-			}
-			char *word = "Nothing";
-			for (size_t i = 0; i < words_count; i++) {
-				if (words[i].pos == c) word = words[i].word;
-			}
+	fft_context_init(fft, FFT_FRAME_SIZE, FFT_HOP_SIZE, FFT_WINDOW, fft_window);
 
-			// printf("%s\n\r", word);
-
-			if (words_count == lower) {
-				printf("Silence\n\r");
-				change_led_duty_cycle(BUTTON2, led[BUTTON2].brightness_passive);
-			} else if (!strcmp(word, "Ni")) {
-				printf("Ni\n\r");
-				change_led_duty_cycle(BUTTON0, led[BUTTON0].brightness_active);
-			} else if (!strcmp(word, "Tak")) {
-				printf("Tak\n\r");
-				change_led_duty_cycle(BUTTON1, led[BUTTON1].brightness_active);
-			} else {
-				printf("Inshe\n\r");
-				change_led_duty_cycle(BUTTON2, led[BUTTON2].brightness_passive);
-			}
-			printf("\n\r");
+	if (FEATURE_MODE == FEATURE_LOG_MEL || FEATURE_MODE == FEATURE_MFCC)
+		mel_init(mel, FFT_FRAME_SIZE, AUDIO_SAMPLE_RATE, MEL_CHANNELS,
+				 MEL_LOW_FREQ, MEL_HIGH_FREQ, mel_weights);
 
-			play_record();
-		}
+	if (FEATURE_MODE == FEATURE_MFCC){
+		mfcc_init(mfcc, mel, MFCC_COEFFICIENTS, mfcc_dct);
+		fft_quant_init(quant, MFCC_FEATURE_SCALE, input_scale, input_zero_point);
 	}
+	else if (FEATURE_MODE == FEATURE_LOG_MEL)
+		fft_quant_init(quant, MEL_FEATURE_SCALE, input_scale, input_zero_point);
+	else
+		fft_quant_init(quant, FFT_FEATURE_SCALE, input_scale, input_zero_point);
+}
+
+
+/******************************************************************************
+ * 	Function name: decide
+ **************************************
+ *	Summary:
+ *		Turn the NN output into a word: the most probable word if its
+ *		probability is above 0.75, "Silence" if all of them are below 0.375
+ *		(see score_word()).
+ *
+ *	Parameters:
+ *		*score	-	best class of the NN output.
+ *
+ *	Return:
+ *		"Silence", "Ni", "Tak" or "Inshe".
+ */
+static const char *decide(const struct model_score *score){
+	int c = score_word(score);
+	char *word = "Nothing";
+	for (size_t i = 0; i < words_count; i++) {
+		if (words[i].pos == c) word = words[i].word;
+	}
+
+	// printf("%s\n\r", word);
+
+	if (c == SCORE_SILENCE)
+		return "Silence";
+	else if (!strcmp(word, "Ni"))
+		return "Ni";
+	else if (!strcmp(word, "Tak"))
+		return "Tak";
+	return "Inshe";
+}
+
+
+/******************************************************************************
+ * 	Function name: show_word
+ **************************************
+ *	Summary:
+ *		Print the word returned by decide() and light its led.
+ *
+ *	Parameters:
+ *		*word	-	result of decide().
+ */
+static void show_word(const char *word){
+	printf("%s\n\r", word);
+	if (!strcmp(word, "Ni"))
+		change_led_duty_cycle(BUTTON0, led[BUTTON0].brightness_active);
+	else if (!strcmp(word, "Tak"))
+		change_led_duty_cycle(BUTTON1, led[BUTTON1].brightness_active);
+	else
+		change_led_duty_cycle(BUTTON2, led[BUTTON2].brightness_passive);
+	printf("\n\r");
 }
 
 